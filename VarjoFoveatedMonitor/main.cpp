@@ -0,0 +1,208 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Command line tool printing the telemetry published by the Varjo Foveated API layer.
+//
+// Usage: VarjoFoveatedMonitor [--interval <ms>] [--once]
+//
+// Keeps printing when the application restarts. Reports when the application stops publishing (it exited) or stops
+// submitting frames.
+
+#include <windows.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include <VarjoFoveatedTelemetry.h>
+
+namespace {
+
+    using namespace varjo_foveated::telemetry;
+
+    // How long without a new frame before reporting that the application stopped submitting frames.
+    constexpr auto StaleTimeout = std::chrono::seconds(2);
+
+    // A process we are not allowed to query is assumed to be alive.
+    bool IsProcessAlive(DWORD processId) {
+        const HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, processId);
+        if (!process) {
+            return GetLastError() == ERROR_ACCESS_DENIED;
+        }
+        const bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+        CloseHandle(process);
+        return alive;
+    }
+
+    const char* TurboStateToString(uint32_t turboState) {
+        switch (turboState) {
+        case TurboStateDisabled:
+            return "off";
+        case TurboStateSynchronous:
+            return "sync";
+        case TurboStatePipelined:
+            return "pipelined";
+        default:
+            return "?";
+        }
+    }
+
+    void PrintSnapshot(const FrameSnapshot& frame) {
+        printf("frame %8llu  period %6.2f ms  interval %6.2f ms  wait-to-end %6.2f ms  foveation %-3s  turbo %-9s  "
+               "gaze %5.1f%%  config %08x (%.2f/%.2f %.2fx%.2f)\n",
+               static_cast<unsigned long long>(frame.frameIndex),
+               frame.predictedDisplayPeriod / 1e6,
+               frame.frameIntervalUs / 1e3,
+               frame.waitToEndUs / 1e3,
+               frame.foveationActive ? "on" : "off",
+               TurboStateToString(frame.turboState),
+               frame.gazeTrackedRatio * 100.f,
+               frame.configSnapshotId,
+               frame.peripheralMultiplier,
+               frame.focusMultiplier,
+               frame.horizontalFocusScale,
+               frame.verticalFocusScale);
+
+        if (frame.gazeSampleCount) {
+            printf("  eye tracking: %u samples  tracked %5.1f%%  dropouts %u (",
+                   frame.gazeSampleCount,
+                   frame.gazeSampleTrackedRatio * 100.f,
+                   frame.gazeDropoutCount);
+            for (uint32_t i = 0; i < GazeDropoutBucketCount; i++) {
+                if (i < std::size(GazeDropoutBucketLimitsMs)) {
+                    printf("%s<%ums: %u", i ? " " : "", GazeDropoutBucketLimitsMs[i], frame.gazeDropoutHistogram[i]);
+                } else {
+                    printf(" longer: %u", frame.gazeDropoutHistogram[i]);
+                }
+            }
+            printf(")  blinks %u  longest %.0f ms  jitter p50 %.2f deg p95 %.2f deg\n",
+                   frame.gazeBlinkCount,
+                   frame.gazeLongestDropoutMs,
+                   frame.gazeJitterP50Deg,
+                   frame.gazeJitterP95Deg);
+        }
+
+        if (frame.gazeAgeFrameCount) {
+            printf("  gaze age: %u frames (%u unmatched)  p50 %.1f ms p95 %.1f ms p99 %.1f ms max %.1f ms  "
+                   "display time slip p50 %.1f ms p95 %.1f ms\n",
+                   frame.gazeAgeFrameCount,
+                   frame.gazeAgeUnmatchedCount,
+                   frame.gazeAgeP50Ms,
+                   frame.gazeAgeP95Ms,
+                   frame.gazeAgeP99Ms,
+                   frame.gazeAgeMaxMs,
+                   frame.displayTimeSlipP50Ms,
+                   frame.displayTimeSlipP95Ms);
+        }
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    unsigned int intervalMs = 1000;
+    bool once = false;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--interval") && i + 1 < argc) {
+            intervalMs = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (!strcmp(argv[i], "--once")) {
+            once = true;
+        } else {
+            fprintf(stderr, "Usage: %s [--interval <ms>] [--once]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, SegmentName);
+    if (!mapping) {
+        fprintf(stderr, "No application is running with the Varjo Foveated layer (error %lu)\n", GetLastError());
+        return 1;
+    }
+
+    const auto segment = reinterpret_cast<const Segment*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(Segment)));
+    if (!segment) {
+        fprintf(stderr, "Failed to map the telemetry segment (error %lu)\n", GetLastError());
+        CloseHandle(mapping);
+        return 1;
+    }
+
+    int exitCode = 0;
+    if (segment->magic != Magic || segment->version != Version) {
+        fprintf(stderr, "Unsupported telemetry segment (magic %08x, version %u)\n", segment->magic, segment->version);
+        exitCode = 1;
+    } else {
+        uint32_t lastProcessId = 0;
+        uint64_t lastFrameIndex = ~0ull;
+        auto lastFrameTime = std::chrono::steady_clock::now();
+        bool reportedStale = false;
+        while (true) {
+            // The segment remains after the application exits, until the next application takes it over.
+            const uint32_t owner = segment->owner.load();
+            const bool isPublished = owner && IsProcessAlive(owner);
+
+            FrameSnapshot frame;
+            Publisher publisher;
+            if (!ReadSnapshot(*segment, frame, publisher)) {
+                fprintf(stderr, "Timed out reading the telemetry segment\n");
+            } else {
+                const auto now = std::chrono::steady_clock::now();
+                if (publisher.processId != lastProcessId) {
+                    char applicationName[sizeof(publisher.applicationName) + 1]{};
+                    memcpy(applicationName, publisher.applicationName, sizeof(publisher.applicationName));
+                    printf("Application: %s (pid %u)\n", applicationName, publisher.processId);
+                    lastProcessId = publisher.processId;
+                    lastFrameIndex = ~0ull;
+                    reportedStale = false;
+                }
+
+                if (frame.frameIndex != lastFrameIndex) {
+                    PrintSnapshot(frame);
+                    lastFrameIndex = frame.frameIndex;
+                    lastFrameTime = now;
+                    reportedStale = false;
+                }
+
+                if (!reportedStale && !isPublished) {
+                    printf("The application (pid %u) stopped publishing, waiting for the next one\n",
+                           publisher.processId);
+                    reportedStale = true;
+                } else if (!reportedStale && now - lastFrameTime >= StaleTimeout) {
+                    printf("No new frame for %.1f s, the application (pid %u) is not submitting frames\n",
+                           std::chrono::duration<double>(now - lastFrameTime).count(),
+                           publisher.processId);
+                    reportedStale = true;
+                }
+            }
+
+            if (once) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+        }
+    }
+
+    UnmapViewOfFile(segment);
+    CloseHandle(mapping);
+
+    return exitCode;
+}
@@ -0,0 +1,576 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Command line tool estimating the rendering cost of the Varjo Foveated API layer settings, without a headset. It
+// applies the same resolution and focus region scaling as the layer to the views recommended by the runtime.
+//
+// Usage: VarjoFoveatedPlanner --peripheral <width>x<height> --focus <width>x<height>
+//                             --peripheral-fov <horizontal>x<vertical> --focus-fov <horizontal>x<vertical>
+//                             [--config <settings.cfg>] [--samples <count>] [--budget <megapixels>]
+//                             [--csv <output.csv>]
+//        VarjoFoveatedPlanner --capture <capture.vfcap> [...]
+//
+// The sizes are the ones recommended by the runtime for the quad views, and the fields of view are in degrees. They can
+// instead be taken from a capture (capture=1 in settings.cfg): the fields of view are the ones returned by the runtime,
+// and the sizes are estimated from the first frame submitted, scaled back by the multipliers of the capture.
+//
+// Prints the resolution, pixel count and swapchain memory of each view for the settings (the defaults, or the given
+// settings.cfg), compared to stereo rendering at the same pixel density as the focus views.
+//
+// With --budget, also sweeps the settings and prints the Pareto frontier of the ones rendering at most that many pixels
+// per frame: for each, there is no other setting within budget with at least the same peripheral pixel density, focus
+// pixel density and focus area.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <openxr/openxr.h>
+
+#include <VarjoFoveatedCapture.h>
+#include <VarjoFoveatedScaling.h>
+
+namespace {
+
+    using namespace varjo_foveated;
+
+    // Swapchain memory is estimated for 4 bytes per sample, since the size of the format depends on the graphics API.
+    constexpr double BytesPerSample = 4;
+
+    // The sweep for --budget.
+    constexpr float PeripheralMultiplierMin = 0.25f;
+    constexpr float PeripheralMultiplierMax = 1.f;
+    constexpr float FocusMultiplierMin = 0.5f;
+    constexpr float FocusMultiplierMax = 1.5f;
+    constexpr float FocusScaleMin = 0.5f;
+    constexpr float FocusScaleMax = 1.f;
+    constexpr float SweepStep = 0.05f;
+
+    struct Extent {
+        uint32_t width{0};
+        uint32_t height{0};
+    };
+
+    // Field of view extent, in radians.
+    struct Fov {
+        float horizontal{0};
+        float vertical{0};
+    };
+
+    // What the runtime recommends for the quad views. Both eyes are assumed symmetrical.
+    struct Headset {
+        Extent peripheral;
+        Extent focus;
+        Fov peripheralFov;
+        Fov focusFov;
+    };
+
+    // The subset of settings.cfg affecting the resolution.
+    struct Settings {
+        float peripheralMultiplier{1};
+        float focusMultiplier{1};
+        float horizontalFocusScale{1};
+        float verticalFocusScale{1};
+        float peripheralPixelDensity{0};
+        float focusPixelDensity{0};
+        uint32_t peripheralSampleCount{0};
+        uint32_t focusSampleCount{0};
+    };
+
+    struct View {
+        Extent resolution;
+        // Average pixel density, in pixels per degree.
+        float horizontalPixelDensity;
+        float verticalPixelDensity;
+        uint32_t sampleCount;
+
+        uint64_t Pixels() const {
+            return static_cast<uint64_t>(resolution.width) * resolution.height;
+        }
+
+        double Memory() const {
+            return Pixels() * sampleCount * BytesPerSample;
+        }
+    };
+
+    struct Plan {
+        Settings settings;
+        View peripheral;
+        View focus;
+        // Area of the focus region, in square degrees.
+        float focusArea;
+        // Stereo rendering of the peripheral field of view, at the pixel density of the focus views.
+        View stereo;
+
+        // For both eyes.
+        uint64_t Pixels() const {
+            return 2 * (peripheral.Pixels() + focus.Pixels());
+        }
+
+        double Memory() const {
+            return 2 * (peripheral.Memory() + focus.Memory());
+        }
+    };
+
+    // Same as xrEnumerateViewConfigurationViews() in the layer.
+    uint32_t Resolution(uint32_t runtimeResolution, float fov, float multiplier, float scale, float pixelDensity) {
+        if (pixelDensity > 0) {
+            return scaling::ResolutionForPixelDensity(-fov / 2, fov / 2, scale, pixelDensity);
+        }
+        return scaling::ScaleResolution(runtimeResolution, multiplier * scale);
+    }
+
+    View MakeView(const Extent& resolution, const Fov& fov, uint32_t sampleCount) {
+        View view{};
+        view.resolution = resolution;
+        view.horizontalPixelDensity = scaling::PixelDensity(resolution.width, -fov.horizontal / 2, fov.horizontal / 2);
+        view.verticalPixelDensity = scaling::PixelDensity(resolution.height, -fov.vertical / 2, fov.vertical / 2);
+        view.sampleCount = sampleCount;
+        return view;
+    }
+
+    Plan MakePlan(const Headset& headset, const Settings& settings, uint32_t defaultSampleCount) {
+        Plan plan{};
+        plan.settings = settings;
+
+        const Extent peripheral{Resolution(headset.peripheral.width,
+                                           headset.peripheralFov.horizontal,
+                                           settings.peripheralMultiplier,
+                                           1.f,
+                                           settings.peripheralPixelDensity),
+                                Resolution(headset.peripheral.height,
+                                           headset.peripheralFov.vertical,
+                                           settings.peripheralMultiplier,
+                                           1.f,
+                                           settings.peripheralPixelDensity)};
+        const uint32_t peripheralSampleCount =
+            settings.peripheralSampleCount ? settings.peripheralSampleCount : defaultSampleCount;
+        plan.peripheral = MakeView(peripheral, headset.peripheralFov, peripheralSampleCount);
+
+        // Same as xrLocateViews() in the layer.
+        const auto focusHorizontal = scaling::ScaleFov(
+            -headset.focusFov.horizontal / 2, headset.focusFov.horizontal / 2, settings.horizontalFocusScale);
+        const auto focusVertical = scaling::ScaleFov(
+            -headset.focusFov.vertical / 2, headset.focusFov.vertical / 2, settings.verticalFocusScale);
+        const Fov focusFov{focusHorizontal.second - focusHorizontal.first, focusVertical.second - focusVertical.first};
+
+        const Extent focus{Resolution(headset.focus.width,
+                                      headset.focusFov.horizontal,
+                                      settings.focusMultiplier,
+                                      settings.horizontalFocusScale,
+                                      settings.focusPixelDensity),
+                           Resolution(headset.focus.height,
+                                      headset.focusFov.vertical,
+                                      settings.focusMultiplier,
+                                      settings.verticalFocusScale,
+                                      settings.focusPixelDensity)};
+        plan.focus =
+            MakeView(focus, focusFov, settings.focusSampleCount ? settings.focusSampleCount : defaultSampleCount);
+        plan.focusArea =
+            focusFov.horizontal * focusFov.vertical * scaling::DegreesPerRadian * scaling::DegreesPerRadian;
+
+        const float horizontal = headset.peripheralFov.horizontal;
+        const float vertical = headset.peripheralFov.vertical;
+        const Extent stereo{
+            scaling::ResolutionForPixelDensity(-horizontal / 2, horizontal / 2, 1.f, plan.focus.horizontalPixelDensity),
+            scaling::ResolutionForPixelDensity(-vertical / 2, vertical / 2, 1.f, plan.focus.verticalPixelDensity)};
+        plan.stereo = MakeView(stereo, headset.peripheralFov, plan.focus.sampleCount);
+
+        return plan;
+    }
+
+    void PrintView(const char* name, const View& view) {
+        printf("%-12s %5ux%-5u %8.2f MP %9.1f MB %6.1f/%-6.1f %7u\n",
+               name,
+               view.resolution.width,
+               view.resolution.height,
+               view.Pixels() / 1e6,
+               view.Memory() / 1048576.0,
+               view.horizontalPixelDensity,
+               view.verticalPixelDensity,
+               view.sampleCount);
+    }
+
+    void PrintPlan(const Plan& plan) {
+        printf("%-12s %11s %11s %12s %13s %7s\n", "View", "Resolution", "Pixels", "Memory", "Density (ppd)", "Samples");
+        PrintView("Left", plan.peripheral);
+        PrintView("Right", plan.peripheral);
+        PrintView("Left focus", plan.focus);
+        PrintView("Right focus", plan.focus);
+        printf("%-12s %11s %8.2f MP %9.1f MB\n", "Total", "", plan.Pixels() / 1e6, plan.Memory() / 1048576.0);
+        printf("\n");
+
+        const uint64_t stereoPixels = 2 * plan.stereo.Pixels();
+        const double stereoMemory = 2 * plan.stereo.Memory();
+        printf("Stereo at the focus pixel density: %ux%u per eye, %.2f MP, %.1f MB\n",
+               plan.stereo.resolution.width,
+               plan.stereo.resolution.height,
+               stereoPixels / 1e6,
+               stereoMemory / 1048576.0);
+        printf("Savings: %.1f%% pixels, %.1f%% memory\n",
+               100.0 * (1.0 - static_cast<double>(plan.Pixels()) / stereoPixels),
+               100.0 * (1.0 - plan.Memory() / stereoMemory));
+    }
+
+    bool Dominates(const Plan& a, const Plan& b) {
+        const float aValues[] = {a.peripheral.horizontalPixelDensity, a.focus.horizontalPixelDensity, a.focusArea};
+        const float bValues[] = {b.peripheral.horizontalPixelDensity, b.focus.horizontalPixelDensity, b.focusArea};
+        bool better = false;
+        for (size_t i = 0; i < std::size(aValues); i++) {
+            if (aValues[i] < bValues[i]) {
+                return false;
+            }
+            better = better || aValues[i] > bValues[i];
+        }
+        return better || a.Pixels() < b.Pixels();
+    }
+
+    // The focus region keeps the aspect ratio of the runtime's, so both focus scales are swept together.
+    std::vector<Plan> ParetoFrontier(const Headset& headset, uint32_t sampleCount, double budget) {
+        const auto steps = [](float min, float max) { return static_cast<int>((max - min) / SweepStep + 0.5f); };
+
+        std::vector<Plan> candidates;
+        for (int p = 0; p <= steps(PeripheralMultiplierMin, PeripheralMultiplierMax); p++) {
+            for (int f = 0; f <= steps(FocusMultiplierMin, FocusMultiplierMax); f++) {
+                for (int s = 0; s <= steps(FocusScaleMin, FocusScaleMax); s++) {
+                    Settings settings;
+                    settings.peripheralMultiplier = PeripheralMultiplierMin + p * SweepStep;
+                    settings.focusMultiplier = FocusMultiplierMin + f * SweepStep;
+                    settings.horizontalFocusScale = settings.verticalFocusScale = FocusScaleMin + s * SweepStep;
+
+                    const Plan plan = MakePlan(headset, settings, sampleCount);
+                    if (plan.Pixels() <= budget) {
+                        candidates.push_back(plan);
+                    }
+                }
+            }
+        }
+
+        std::vector<Plan> frontier;
+        for (const auto& candidate : candidates) {
+            if (std::none_of(candidates.cbegin(), candidates.cend(), [&](const Plan& other) {
+                    return &other != &candidate && Dominates(other, candidate);
+                })) {
+                frontier.push_back(candidate);
+            }
+        }
+        std::sort(frontier.begin(), frontier.end(), [](const Plan& a, const Plan& b) {
+            if (a.focus.horizontalPixelDensity != b.focus.horizontalPixelDensity) {
+                return a.focus.horizontalPixelDensity > b.focus.horizontalPixelDensity;
+            }
+            return a.peripheral.horizontalPixelDensity > b.peripheral.horizontalPixelDensity;
+        });
+        return frontier;
+    }
+
+    void PrintFrontier(const std::vector<Plan>& frontier, double budget) {
+        printf("%zu settings on the Pareto frontier for %.2f MP per frame:\n\n", frontier.size(), budget / 1e6);
+        printf("%-10s %-10s %-10s %9s %9s %12s %9s %9s\n",
+               "Peripheral",
+               "Focus",
+               "Focus",
+               "Periph.",
+               "Focus",
+               "Focus area",
+               "Pixels",
+               "Savings");
+        printf("%-10s %-10s %-10s %9s %9s %12s %9s %9s\n",
+               "multiplier",
+               "multiplier",
+               "scale",
+               "(ppd)",
+               "(ppd)",
+               "(deg^2)",
+               "(MP)",
+               "");
+        for (const auto& plan : frontier) {
+            printf("%-10.2f %-10.2f %-10.2f %9.1f %9.1f %12.0f %9.2f %8.1f%%\n",
+                   plan.settings.peripheralMultiplier,
+                   plan.settings.focusMultiplier,
+                   plan.settings.horizontalFocusScale,
+                   plan.peripheral.horizontalPixelDensity,
+                   plan.focus.horizontalPixelDensity,
+                   plan.focusArea,
+                   plan.Pixels() / 1e6,
+                   100.0 * (1.0 - static_cast<double>(plan.Pixels()) / (2 * plan.stereo.Pixels())));
+        }
+    }
+
+    void WriteCsv(const std::filesystem::path& path, const std::vector<Plan>& plans) {
+        std::ofstream csv(path);
+        if (!csv.is_open()) {
+            throw std::runtime_error("Failed to open " + path.string());
+        }
+
+        csv << "peripheral_multiplier,focus_multiplier,horizontal_focus_scale,vertical_focus_scale,peripheral_width,"
+               "peripheral_height,focus_width,focus_height,peripheral_ppd,focus_ppd,focus_area_deg2,pixels,memory_mb,"
+               "stereo_pixels\n";
+        for (const auto& plan : plans) {
+            csv << plan.settings.peripheralMultiplier << "," << plan.settings.focusMultiplier << ","
+                << plan.settings.horizontalFocusScale << "," << plan.settings.verticalFocusScale << ","
+                << plan.peripheral.resolution.width << "," << plan.peripheral.resolution.height << ","
+                << plan.focus.resolution.width << "," << plan.focus.resolution.height << ","
+                << plan.peripheral.horizontalPixelDensity << "," << plan.focus.horizontalPixelDensity << ","
+                << plan.focusArea << "," << plan.Pixels() << "," << plan.Memory() / 1048576.0 << ","
+                << 2 * plan.stereo.Pixels() << "\n";
+        }
+    }
+
+    // Same syntax as the layer. Other settings are ignored.
+    Settings LoadSettings(const std::filesystem::path& path) {
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open " + path.string());
+        }
+
+        Settings settings;
+        std::string line;
+        while (std::getline(file, line)) {
+            const auto offset = line.find('=');
+            if (offset == std::string::npos) {
+                continue;
+            }
+            const std::string name = line.substr(0, offset);
+            const std::string value = line.substr(offset + 1);
+
+            if (name == "peripheral_multiplier") {
+                settings.peripheralMultiplier = std::stof(value);
+            } else if (name == "focus_multiplier") {
+                settings.focusMultiplier = std::stof(value);
+            } else if (name == "horizontal_focus_scale") {
+                settings.horizontalFocusScale = std::stof(value);
+            } else if (name == "vertical_focus_scale") {
+                settings.verticalFocusScale = std::stof(value);
+            } else if (name == "peripheral_ppd") {
+                settings.peripheralPixelDensity = std::stof(value);
+            } else if (name == "focus_ppd") {
+                settings.focusPixelDensity = std::stof(value);
+            } else if (name == "peripheral_samples") {
+                settings.peripheralSampleCount = std::stoi(value);
+            } else if (name == "focus_samples") {
+                settings.focusSampleCount = std::stoi(value);
+            }
+        }
+        return settings;
+    }
+
+    // Fills in what the capture knows about the headset.
+    void LoadCapture(const std::filesystem::path& path, Headset& headset) {
+        std::ifstream file(path, std::ios_base::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open " + path.string());
+        }
+
+        capture::FileHeader header{};
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!file || header.magic != capture::Magic) {
+            throw std::runtime_error(path.string() + " is not a capture file");
+        }
+        if (header.version != capture::Version) {
+            throw std::runtime_error("Unsupported capture version " + std::to_string(header.version));
+        }
+
+        bool hasFov = false;
+        bool hasResolution = false;
+        capture::RecordHeader record;
+        std::vector<uint8_t> payload;
+        while (!(hasFov && hasResolution) && file.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+            payload.resize(record.size);
+            if (!file.read(reinterpret_cast<char*>(payload.data()), payload.size())) {
+                break;
+            }
+
+            if (!hasFov && record.type == capture::RecordType::LocateViews && XR_SUCCEEDED(record.result) &&
+                payload.size() >= sizeof(capture::LocateViewsRecord)) {
+                const auto& locateViews = *reinterpret_cast<const capture::LocateViewsRecord*>(payload.data());
+                if (locateViews.viewConfigurationType == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO &&
+                    locateViews.viewCount == 4) {
+                    const XrFovf& peripheral = locateViews.views[0].fov;
+                    const XrFovf& focus = locateViews.views[2].fov;
+                    headset.peripheralFov = {peripheral.angleRight - peripheral.angleLeft,
+                                             peripheral.angleUp - peripheral.angleDown};
+                    headset.focusFov = {focus.angleRight - focus.angleLeft, focus.angleUp - focus.angleDown};
+                    hasFov = true;
+                }
+            } else if (!hasResolution && record.type == capture::RecordType::EndFrame &&
+                       payload.size() >= sizeof(capture::EndFrameRecord)) {
+                // Look for the quad views projection layer.
+                const auto& endFrame = *reinterpret_cast<const capture::EndFrameRecord*>(payload.data());
+                size_t offset = sizeof(capture::EndFrameRecord);
+                for (uint32_t i = 0; i < endFrame.layerCount; i++) {
+                    if (offset + sizeof(capture::CompositionLayerRecord) > payload.size()) {
+                        break;
+                    }
+                    const auto& layer = *reinterpret_cast<const capture::CompositionLayerRecord*>(&payload[offset]);
+                    offset += sizeof(capture::CompositionLayerRecord);
+                    if (offset + layer.viewCount * sizeof(capture::ProjectionViewRecord) > payload.size()) {
+                        break;
+                    }
+                    const auto views = reinterpret_cast<const capture::ProjectionViewRecord*>(&payload[offset]);
+                    offset += layer.viewCount * sizeof(capture::ProjectionViewRecord);
+
+                    if (layer.type == XR_TYPE_COMPOSITION_LAYER_PROJECTION && layer.viewCount == 4) {
+                        // Undo the layer's scaling.
+                        const auto unscale = [](int32_t size, float multiplier) {
+                            return static_cast<uint32_t>(size / multiplier + 0.5f);
+                        };
+                        headset.peripheral = {unscale(views[0].imageRect.extent.width, header.peripheralMultiplier),
+                                              unscale(views[0].imageRect.extent.height, header.peripheralMultiplier)};
+                        const float focusHorizontalMultiplier = header.focusMultiplier * header.horizontalFocusScale;
+                        const float focusVerticalMultiplier = header.focusMultiplier * header.verticalFocusScale;
+                        headset.focus = {unscale(views[2].imageRect.extent.width, focusHorizontalMultiplier),
+                                         unscale(views[2].imageRect.extent.height, focusVerticalMultiplier)};
+                        hasResolution = headset.peripheral.width && headset.focus.width;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (!hasFov || !hasResolution) {
+            throw std::runtime_error(path.string() + " does not contain a quad views frame");
+        }
+        printf("From %s (%s, %s):\n", path.filename().string().c_str(), header.applicationName, header.runtimeName);
+    }
+
+    // Parse "<first>x<second>".
+    template <typename T>
+    bool ParseExtent(const char* value, T& first, T& second) {
+        char* end;
+        const double firstValue = strtod(value, &end);
+        if (end == value || *end != 'x') {
+            return false;
+        }
+        const char* secondStart = end + 1;
+        const double secondValue = strtod(secondStart, &end);
+        if (end == secondStart || *end != '\0' || firstValue <= 0 || secondValue <= 0) {
+            return false;
+        }
+        first = static_cast<T>(firstValue);
+        second = static_cast<T>(secondValue);
+        return true;
+    }
+
+    bool ParseFov(const char* value, Fov& fov) {
+        if (!ParseExtent(value, fov.horizontal, fov.vertical)) {
+            return false;
+        }
+        fov.horizontal /= scaling::DegreesPerRadian;
+        fov.vertical /= scaling::DegreesPerRadian;
+        return true;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Headset headset;
+    std::filesystem::path capturePath;
+    std::filesystem::path configPath;
+    std::filesystem::path csvPath;
+    uint32_t sampleCount = 1;
+    double budget = 0;
+
+    bool valid = true;
+    for (int i = 1; i < argc && valid; i++) {
+        const std::string_view arg(argv[i]);
+        if (i + 1 >= argc) {
+            valid = false;
+        } else if (arg == "--peripheral") {
+            valid = ParseExtent(argv[++i], headset.peripheral.width, headset.peripheral.height);
+        } else if (arg == "--focus") {
+            valid = ParseExtent(argv[++i], headset.focus.width, headset.focus.height);
+        } else if (arg == "--peripheral-fov") {
+            valid = ParseFov(argv[++i], headset.peripheralFov);
+        } else if (arg == "--focus-fov") {
+            valid = ParseFov(argv[++i], headset.focusFov);
+        } else if (arg == "--capture") {
+            capturePath = argv[++i];
+        } else if (arg == "--config") {
+            configPath = argv[++i];
+        } else if (arg == "--csv") {
+            csvPath = argv[++i];
+        } else if (arg == "--samples") {
+            sampleCount = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+            valid = sampleCount > 0;
+        } else if (arg == "--budget") {
+            budget = atof(argv[++i]) * 1e6;
+            valid = budget > 0;
+        } else {
+            valid = false;
+        }
+    }
+    const bool hasHeadset = headset.peripheral.width && headset.focus.width && headset.peripheralFov.horizontal > 0 &&
+                            headset.focusFov.horizontal > 0;
+    if (!valid || (capturePath.empty() && !hasHeadset)) {
+        fprintf(stderr,
+                "Usage: %s --peripheral <width>x<height> --focus <width>x<height>\n"
+                "           --peripheral-fov <horizontal>x<vertical> --focus-fov <horizontal>x<vertical>\n"
+                "           [--config <settings.cfg>] [--samples <count>] [--budget <megapixels>]\n"
+                "           [--csv <output.csv>]\n"
+                "       %s --capture <capture.vfcap> [...]\n",
+                argv[0],
+                argv[0]);
+        return 1;
+    }
+
+    try {
+        if (!capturePath.empty()) {
+            LoadCapture(capturePath, headset);
+        }
+        printf("Runtime: %ux%u peripheral (%.1fx%.1f deg), %ux%u focus (%.1fx%.1f deg)\n\n",
+               headset.peripheral.width,
+               headset.peripheral.height,
+               headset.peripheralFov.horizontal * scaling::DegreesPerRadian,
+               headset.peripheralFov.vertical * scaling::DegreesPerRadian,
+               headset.focus.width,
+               headset.focus.height,
+               headset.focusFov.horizontal * scaling::DegreesPerRadian,
+               headset.focusFov.vertical * scaling::DegreesPerRadian);
+
+        const Settings settings = configPath.empty() ? Settings{} : LoadSettings(configPath);
+        const Plan plan = MakePlan(headset, settings, sampleCount);
+        PrintPlan(plan);
+
+        if (budget > 0) {
+            printf("\n");
+            const std::vector<Plan> frontier = ParetoFrontier(headset, sampleCount, budget);
+            PrintFrontier(frontier, budget);
+            if (!csvPath.empty()) {
+                WriteCsv(csvPath, frontier);
+            }
+        } else if (!csvPath.empty()) {
+            WriteCsv(csvPath, {plan});
+        }
+    } catch (const std::exception& exc) {
+        fprintf(stderr, "%s\n", exc.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "layer_loader.h"
+
+namespace varjo_foveated::replay {
+
+    // The entry points used by the replay, resolved through the layer.
+    struct Api {
+        PFN_xrCreateSession xrCreateSession;
+        PFN_xrDestroySession xrDestroySession;
+        PFN_xrBeginSession xrBeginSession;
+        PFN_xrEndSession xrEndSession;
+        PFN_xrEnumerateViewConfigurationViews xrEnumerateViewConfigurationViews;
+        PFN_xrCreateReferenceSpace xrCreateReferenceSpace;
+        PFN_xrDestroySpace xrDestroySpace;
+        PFN_xrCreateSwapchain xrCreateSwapchain;
+        PFN_xrDestroySwapchain xrDestroySwapchain;
+        PFN_xrLocateViews xrLocateViews;
+        PFN_xrWaitFrame xrWaitFrame;
+        PFN_xrBeginFrame xrBeginFrame;
+        PFN_xrEndFrame xrEndFrame;
+        PFN_xrAcquireSwapchainImage xrAcquireSwapchainImage;
+        PFN_xrWaitSwapchainImage xrWaitSwapchainImage;
+        PFN_xrReleaseSwapchainImage xrReleaseSwapchainImage;
+        PFN_xrGetFoveatedStatsMBUCCHIA xrGetFoveatedStatsMBUCCHIA;
+    };
+
+    inline Api ResolveApi(const Layer& layer) {
+        Api api{};
+        api.xrCreateSession = layer.Resolve<PFN_xrCreateSession>("xrCreateSession");
+        api.xrDestroySession = layer.Resolve<PFN_xrDestroySession>("xrDestroySession");
+        api.xrBeginSession = layer.Resolve<PFN_xrBeginSession>("xrBeginSession");
+        api.xrEndSession = layer.Resolve<PFN_xrEndSession>("xrEndSession");
+        api.xrEnumerateViewConfigurationViews =
+            layer.Resolve<PFN_xrEnumerateViewConfigurationViews>("xrEnumerateViewConfigurationViews");
+        api.xrCreateReferenceSpace = layer.Resolve<PFN_xrCreateReferenceSpace>("xrCreateReferenceSpace");
+        api.xrDestroySpace = layer.Resolve<PFN_xrDestroySpace>("xrDestroySpace");
+        api.xrCreateSwapchain = layer.Resolve<PFN_xrCreateSwapchain>("xrCreateSwapchain");
+        api.xrDestroySwapchain = layer.Resolve<PFN_xrDestroySwapchain>("xrDestroySwapchain");
+        api.xrLocateViews = layer.Resolve<PFN_xrLocateViews>("xrLocateViews");
+        api.xrWaitFrame = layer.Resolve<PFN_xrWaitFrame>("xrWaitFrame");
+        api.xrBeginFrame = layer.Resolve<PFN_xrBeginFrame>("xrBeginFrame");
+        api.xrEndFrame = layer.Resolve<PFN_xrEndFrame>("xrEndFrame");
+        api.xrAcquireSwapchainImage = layer.Resolve<PFN_xrAcquireSwapchainImage>("xrAcquireSwapchainImage");
+        api.xrWaitSwapchainImage = layer.Resolve<PFN_xrWaitSwapchainImage>("xrWaitSwapchainImage");
+        api.xrReleaseSwapchainImage = layer.Resolve<PFN_xrReleaseSwapchainImage>("xrReleaseSwapchainImage");
+        api.xrGetFoveatedStatsMBUCCHIA = layer.Resolve<PFN_xrGetFoveatedStatsMBUCCHIA>("xrGetFoveatedStatsMBUCCHIA");
+        return api;
+    }
+
+} // namespace varjo_foveated::replay
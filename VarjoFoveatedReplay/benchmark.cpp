@@ -0,0 +1,867 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "api.h"
+#include "benchmark.h"
+#include "runtime.h"
+#include "statistics.h"
+#include "timing.h"
+
+namespace {
+
+    using namespace varjo_foveated;
+    using namespace varjo_foveated::replay;
+
+    // Frames at the beginning of each run that are not accounted for, while the pacing settles.
+    constexpr size_t WarmupFrameCount = 10;
+
+    // The simulated gaze fixates on points up to this angle from the center, in degrees.
+    constexpr double MaxFixationAngle = 10.0;
+
+    // How the layer paces the simulated application.
+    enum class Mode { Synchronous, Turbo, LowLatency, AsyncSubmit, AutoTune, FocusQuantization };
+
+    const char* ToString(Mode mode) {
+        switch (mode) {
+        case Mode::Synchronous:
+            return "Turbo Mode off";
+        case Mode::Turbo:
+            return "Turbo Mode on";
+        case Mode::LowLatency:
+            return "low latency mode";
+        case Mode::AsyncSubmit:
+            return "asynchronous submission";
+        case Mode::AutoTune:
+            return "auto-tune";
+        case Mode::FocusQuantization:
+            return "focus quantization";
+        }
+        return "";
+    }
+
+    // For the results table.
+    const char* ToShortString(Mode mode) {
+        switch (mode) {
+        case Mode::Synchronous:
+            return "sync";
+        case Mode::Turbo:
+            return "turbo";
+        case Mode::LowLatency:
+            return "lowlat";
+        case Mode::AsyncSubmit:
+            return "async";
+        case Mode::AutoTune:
+            return "tune";
+        case Mode::FocusQuantization:
+            return "quant";
+        }
+        return "";
+    }
+
+    // A frame of the simulated application.
+    struct FrameSample {
+        std::chrono::nanoseconds cpuTime;
+        std::chrono::nanoseconds gpuTime;
+        // When the application located the views.
+        XrTime poseTime;
+        XrTime predictedDisplayTime;
+        // Time blocked in xrWaitFrame(), xrBeginFrame(), xrReleaseSwapchainImage() and xrEndFrame(), in milliseconds.
+        double stallTime;
+        // Time blocked in xrAcquireSwapchainImage() and xrWaitSwapchainImage(), in milliseconds.
+        double imageWaitTime;
+        // Whether the focus views FOV differs from the previous frame, which makes the application rebuild what it
+        // caches per frustum.
+        bool focusFovChanged;
+        // From the gaze to the center of the left focus view, in degrees.
+        double focusOffset;
+    };
+
+    struct RunResult {
+        double refreshRate;
+        Mode mode;
+        std::vector<FrameSample> frames;
+        // When each frame was displayed by the simulated compositor.
+        std::vector<XrTime> displayTimes;
+        uint64_t madeUpFrameCount;
+        // The settings used by the layer.
+        float peripheralMultiplier;
+        float focusMultiplier;
+        float horizontalFocusScale;
+        float verticalFocusScale;
+        // Heap allocations made by the layer in the frame loop after the warmup, if the layer counts them.
+        bool allocationsTracked;
+        uint64_t frameLoopAllocationCount;
+    };
+
+    struct RunMetrics {
+        size_t frameCount;
+        double deliveredFrameRate;
+        // Vsyncs where the compositor had no new frame to display.
+        uint64_t missedVsyncCount;
+        // Frames replaced by a newer frame before being displayed.
+        uint64_t droppedFrameCount;
+        // From locating the views to displaying the frame.
+        Distribution poseToDisplayLatency;
+        // Actual display time minus the predicted display time.
+        Distribution predictionError;
+        Distribution stallTime;
+        Distribution imageWaitTime;
+        // Percentage of the frames with a focus views FOV that is not bit-identical to the previous frame.
+        double focusFovChangeRate;
+        Distribution focusOffset;
+    };
+
+    std::chrono::nanoseconds Sample(const Workload& workload, std::mt19937& rng) {
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+        double duration = uniform(rng) < workload.alternateProbability ? workload.alternateMean : workload.mean;
+        if (workload.standardDeviation > 0) {
+            duration = std::normal_distribution<double>(duration, workload.standardDeviation)(rng);
+        }
+        if (uniform(rng) < workload.spikeProbability) {
+            duration += workload.spikeDuration;
+        }
+        return std::chrono::nanoseconds(static_cast<int64_t>(std::max(duration, 0.0) * 1e6));
+    }
+
+    void PrintWorkload(const char* name, const Workload& workload) {
+        printf("%s: %.2fms (stddev %.2fms)", name, workload.mean, workload.standardDeviation);
+        if (workload.alternateProbability > 0) {
+            printf(", %.2fms %.1f%% of the time", workload.alternateMean, workload.alternateProbability * 100);
+        }
+        if (workload.spikeProbability > 0) {
+            printf(", +%.2fms spikes %.1f%% of the time", workload.spikeDuration, workload.spikeProbability * 100);
+        }
+        printf("\n");
+    }
+
+    // Parse "first[,second]".
+    bool ParsePair(const char* value, double& first, double& second) {
+        char* end;
+        first = strtod(value, &end);
+        if (end == value) {
+            return false;
+        }
+        if (*end == ',') {
+            const char* secondValue = end + 1;
+            second = strtod(secondValue, &end);
+            if (end == secondValue) {
+                return false;
+            }
+        }
+        return *end == '\0';
+    }
+
+    // Returns false if the layer does not count its heap allocations.
+    bool GetFrameLoopAllocationCount(const Api& api, XrSession session, uint64_t& count) {
+        if (!api.xrGetFoveatedStatsMBUCCHIA) {
+            return false;
+        }
+
+        XrFoveatedHeapStatsMBUCCHIA heapStats{XR_TYPE_FOVEATED_HEAP_STATS_MBUCCHIA};
+        XrFoveatedStatsMBUCCHIA stats{XR_TYPE_FOVEATED_STATS_MBUCCHIA, &heapStats};
+        if (XR_FAILED(api.xrGetFoveatedStatsMBUCCHIA(session, &stats)) || !heapStats.trackingEnabled) {
+            return false;
+        }
+        count = heapStats.frameLoopAllocationCount;
+        return true;
+    }
+
+    // Where the layer writes the settings of the replay application, next to the configuration of the runs.
+    std::filesystem::path GetApplicationConfigPath() {
+        return std::filesystem::temp_directory_path() / "VarjoFoveatedReplay.cfg";
+    }
+
+    // Write the configuration for a run, and point the layer to it.
+    void UseConfiguration(const BenchmarkOptions& options, Mode mode) {
+        const auto path = std::filesystem::temp_directory_path() / "VarjoFoveatedBenchmark.cfg";
+        {
+            std::ofstream config(path, std::ios::trunc);
+            if (!options.configPath.empty()) {
+                std::ifstream base(options.configPath);
+                if (!base.is_open()) {
+                    throw std::runtime_error("Failed to open " + options.configPath.string());
+                }
+                config << base.rdbuf() << "\n";
+            }
+
+            // Later statements override the base configuration. The auto-tuner runs with the pacing of the base
+            // configuration.
+            if (mode == Mode::AutoTune) {
+                config << "auto_tune=1\n";
+                config << "auto_tune_window=" << options.autoTuneWindow << "\n";
+            } else {
+                config << "turbo_mode=" << (mode == Mode::Turbo || mode == Mode::AsyncSubmit ? 1 : 0) << "\n";
+                config << "low_latency=" << (mode == Mode::LowLatency ? 1 : 0) << "\n";
+                config << "async_submit=" << (mode == Mode::AsyncSubmit ? 1 : 0) << "\n";
+                config << "auto_tune=0\n";
+                config << "focus_quantization=" << (mode == Mode::FocusQuantization ? options.focusQuantization : 0)
+                       << "\n";
+                config << "focus_dead_zone=" << options.focusDeadZone << "\n";
+            }
+            config << "telemetry=0\n";
+            config << "capture=0\n";
+            if (!config) {
+                throw std::runtime_error("Failed to write " + path.string());
+            }
+        }
+
+        _putenv_s("VARJO_FOVEATED_CONFIG", path.string().c_str());
+    }
+
+    // The gaze of the simulated user for each frame, in degrees right and up from the center: fixations on random
+    // points, with normally distributed jitter, separated by saccades. Empty if the gaze does not move.
+    std::vector<std::pair<double, double>>
+    SimulateGaze(const BenchmarkOptions& options, double refreshRate, size_t frameCount) {
+        std::vector<std::pair<double, double>> gaze;
+        if (options.gazeJitter <= 0 && options.saccadeRate <= 0) {
+            return gaze;
+        }
+
+        // The same gaze for each run at a given refresh rate.
+        std::mt19937 rng(options.seed);
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        std::uniform_real_distribution<double> fixation(-MaxFixationAngle, MaxFixationAngle);
+        std::normal_distribution<double> jitter(0.0, std::max(options.gazeJitter, 1e-9));
+        std::pair<double, double> target{0, 0};
+        for (size_t i = 0; i < frameCount; i++) {
+            if (uniform(rng) < options.saccadeRate / refreshRate) {
+                target = {fixation(rng), fixation(rng)};
+            }
+            gaze.push_back({target.first + jitter(rng), target.second + jitter(rng)});
+        }
+        return gaze;
+    }
+
+    RunResult RunSimulation(Layer& layer,
+                            const BenchmarkOptions& options,
+                            double refreshRate,
+                            Mode mode,
+                            const std::vector<std::chrono::nanoseconds>& cpuTimes,
+                            const std::vector<std::chrono::nanoseconds>& gpuTimes) {
+        UseConfiguration(options, mode);
+
+        runtime::Reset(std::chrono::steady_clock::now());
+        runtime::StartSimulation(static_cast<XrDuration>(1e9 / refreshRate));
+        runtime::SetSimulatedImageWaitTime(std::chrono::nanoseconds(static_cast<int64_t>(options.imageWait * 1e6)));
+        runtime::SetSimulatedEndFrameTime(std::chrono::nanoseconds(static_cast<int64_t>(options.endFrame * 1e6)));
+        runtime::SetResolutionScaledGpuTime(mode == Mode::AutoTune);
+
+        std::vector<const char*> extensions = {XR_VARJO_QUAD_VIEWS_EXTENSION_NAME};
+        if (!options.noStats) {
+            extensions.push_back(XR_MBUCCHIA_VARJO_FOVEATED_STATS_EXTENSION_NAME);
+        }
+        const XrInstance instance = layer.CreateInstance(extensions);
+        const Api api = ResolveApi(layer);
+
+        uint32_t viewCount = 0;
+        CheckXrResult(api.xrEnumerateViewConfigurationViews(
+                          instance, 1, XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO, 0, &viewCount, nullptr),
+                      "xrEnumerateViewConfigurationViews");
+        std::vector<XrViewConfigurationView> configurationViews(viewCount, {XR_TYPE_VIEW_CONFIGURATION_VIEW});
+        CheckXrResult(api.xrEnumerateViewConfigurationViews(instance,
+                                                            1,
+                                                            XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO,
+                                                            viewCount,
+                                                            &viewCount,
+                                                            configurationViews.data()),
+                      "xrEnumerateViewConfigurationViews");
+
+        XrSession session;
+        XrSessionCreateInfo createInfo{XR_TYPE_SESSION_CREATE_INFO};
+        createInfo.systemId = 1;
+        CheckXrResult(api.xrCreateSession(instance, &createInfo, &session), "xrCreateSession");
+
+        XrSpace localSpace;
+        XrReferenceSpaceCreateInfo spaceInfo{XR_TYPE_REFERENCE_SPACE_CREATE_INFO};
+        spaceInfo.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_LOCAL;
+        spaceInfo.poseInReferenceSpace.orientation.w = 1.f;
+        CheckXrResult(api.xrCreateReferenceSpace(session, &spaceInfo, &localSpace), "xrCreateReferenceSpace");
+
+        // One swapchain per view, at the recommended resolution.
+        std::vector<XrSwapchain> swapchains(viewCount, XR_NULL_HANDLE);
+        for (uint32_t i = 0; i < viewCount; i++) {
+            XrSwapchainCreateInfo swapchainInfo{XR_TYPE_SWAPCHAIN_CREATE_INFO};
+            swapchainInfo.usageFlags = XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
+            swapchainInfo.width = configurationViews[i].recommendedImageRectWidth;
+            swapchainInfo.height = configurationViews[i].recommendedImageRectHeight;
+            swapchainInfo.sampleCount = configurationViews[i].recommendedSwapchainSampleCount;
+            swapchainInfo.arraySize = swapchainInfo.faceCount = swapchainInfo.mipCount = 1;
+            CheckXrResult(api.xrCreateSwapchain(session, &swapchainInfo, &swapchains[i]), "xrCreateSwapchain");
+        }
+
+        XrSessionBeginInfo beginInfo{XR_TYPE_SESSION_BEGIN_INFO};
+        beginInfo.primaryViewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO;
+        CheckXrResult(api.xrBeginSession(session, &beginInfo), "xrBeginSession");
+
+        RunResult result{};
+        result.refreshRate = refreshRate;
+        result.mode = mode;
+        result.frames.reserve(cpuTimes.size());
+
+        std::vector<XrView> views(viewCount, {XR_TYPE_VIEW});
+        std::vector<XrCompositionLayerProjectionView> projectionViews(viewCount,
+                                                                      {XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW});
+        for (uint32_t i = 0; i < viewCount; i++) {
+            projectionViews[i].subImage.swapchain = swapchains[i];
+            projectionViews[i].subImage.imageRect.extent.width = configurationViews[i].recommendedImageRectWidth;
+            projectionViews[i].subImage.imageRect.extent.height = configurationViews[i].recommendedImageRectHeight;
+        }
+
+        const auto gaze = SimulateGaze(options, refreshRate, cpuTimes.size());
+        XrFovf previousFocusFovs[2]{};
+
+        uint64_t warmupAllocationCount = 0;
+        for (size_t frameIndex = 0; frameIndex < cpuTimes.size(); frameIndex++) {
+            if (frameIndex == WarmupFrameCount) {
+                result.allocationsTracked = GetFrameLoopAllocationCount(api, session, warmupAllocationCount);
+            }
+
+            FrameSample frame{};
+            frame.cpuTime = cpuTimes[frameIndex];
+            frame.gpuTime = gpuTimes[frameIndex];
+
+            XrFrameState frameState{XR_TYPE_FRAME_STATE};
+            auto callStart = std::chrono::steady_clock::now();
+            CheckXrResult(api.xrWaitFrame(session, nullptr, &frameState), "xrWaitFrame");
+            CheckXrResult(api.xrBeginFrame(session, nullptr), "xrBeginFrame");
+            frame.stallTime = ToMilliseconds(std::chrono::steady_clock::now() - callStart);
+            frame.predictedDisplayTime = frameState.predictedDisplayTime;
+
+            frame.poseTime = runtime::GetSimulatedTime();
+            const auto [gazeRight, gazeUp] = gaze.empty() ? std::make_pair(0.0, 0.0) : gaze[frameIndex];
+            if (!gaze.empty()) {
+                runtime::SetSimulatedGaze(static_cast<float>(gazeRight / scaling::DegreesPerRadian),
+                                          static_cast<float>(gazeUp / scaling::DegreesPerRadian));
+            }
+            XrViewLocateInfo locateInfo{XR_TYPE_VIEW_LOCATE_INFO};
+            locateInfo.viewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO;
+            locateInfo.displayTime = frameState.predictedDisplayTime;
+            locateInfo.space = localSpace;
+            XrViewState viewState{XR_TYPE_VIEW_STATE};
+            CheckXrResult(api.xrLocateViews(session, &locateInfo, &viewState, viewCount, &viewCount, views.data()),
+                          "xrLocateViews");
+
+            const XrFovf focusFovs[] = {views[2].fov, views[3].fov};
+            frame.focusFovChanged = frameIndex && std::memcmp(focusFovs, previousFocusFovs, sizeof(focusFovs));
+            std::memcpy(previousFocusFovs, focusFovs, sizeof(focusFovs));
+            const double focusRight =
+                (focusFovs[0].angleLeft + focusFovs[0].angleRight) / 2 * scaling::DegreesPerRadian;
+            const double focusUp = (focusFovs[0].angleDown + focusFovs[0].angleUp) / 2 * scaling::DegreesPerRadian;
+            frame.focusOffset = std::hypot(focusRight - gazeRight, focusUp - gazeUp);
+
+            callStart = std::chrono::steady_clock::now();
+            for (const XrSwapchain swapchain : swapchains) {
+                uint32_t imageIndex;
+                CheckXrResult(api.xrAcquireSwapchainImage(swapchain, nullptr, &imageIndex), "xrAcquireSwapchainImage");
+                XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+                waitInfo.timeout = XR_INFINITE_DURATION;
+                CheckXrResult(api.xrWaitSwapchainImage(swapchain, &waitInfo), "xrWaitSwapchainImage");
+            }
+            frame.imageWaitTime = ToMilliseconds(std::chrono::steady_clock::now() - callStart);
+
+            // Simulate the application's CPU work, then its GPU work once the frame is submitted.
+            SleepFor(frame.cpuTime);
+            runtime::SetNextFrameGpuTime(frame.gpuTime);
+            callStart = std::chrono::steady_clock::now();
+            for (const XrSwapchain swapchain : swapchains) {
+                CheckXrResult(api.xrReleaseSwapchainImage(swapchain, nullptr), "xrReleaseSwapchainImage");
+            }
+            frame.stallTime += ToMilliseconds(std::chrono::steady_clock::now() - callStart);
+
+            for (uint32_t i = 0; i < viewCount; i++) {
+                projectionViews[i].pose = views[i].pose;
+                projectionViews[i].fov = views[i].fov;
+            }
+            XrCompositionLayerProjection projectionLayer{XR_TYPE_COMPOSITION_LAYER_PROJECTION};
+            projectionLayer.space = localSpace;
+            projectionLayer.viewCount = viewCount;
+            projectionLayer.views = projectionViews.data();
+            const XrCompositionLayerBaseHeader* layers[] = {
+                reinterpret_cast<const XrCompositionLayerBaseHeader*>(&projectionLayer)};
+
+            XrFrameEndInfo frameEndInfo{XR_TYPE_FRAME_END_INFO};
+            frameEndInfo.displayTime = frameState.predictedDisplayTime;
+            frameEndInfo.environmentBlendMode = XR_ENVIRONMENT_BLEND_MODE_OPAQUE;
+            frameEndInfo.layerCount = 1;
+            frameEndInfo.layers = layers;
+            callStart = std::chrono::steady_clock::now();
+            CheckXrResult(api.xrEndFrame(session, &frameEndInfo), "xrEndFrame");
+            frame.stallTime += ToMilliseconds(std::chrono::steady_clock::now() - callStart);
+
+            result.frames.push_back(frame);
+        }
+
+        if (result.allocationsTracked &&
+            GetFrameLoopAllocationCount(api, session, result.frameLoopAllocationCount)) {
+            result.frameLoopAllocationCount -= warmupAllocationCount;
+        }
+        if (api.xrGetFoveatedStatsMBUCCHIA) {
+            XrFoveatedStatsMBUCCHIA stats{XR_TYPE_FOVEATED_STATS_MBUCCHIA};
+            if (XR_SUCCEEDED(api.xrGetFoveatedStatsMBUCCHIA(session, &stats))) {
+                result.madeUpFrameCount = stats.madeUpFrameCount;
+                result.peripheralMultiplier = stats.peripheralMultiplier;
+                result.focusMultiplier = stats.focusMultiplier;
+                result.horizontalFocusScale = stats.horizontalFocusScale;
+                result.verticalFocusScale = stats.verticalFocusScale;
+            }
+        }
+        for (const XrSwapchain swapchain : swapchains) {
+            CheckXrResult(api.xrDestroySwapchain(swapchain), "xrDestroySwapchain");
+        }
+        CheckXrResult(api.xrDestroySession(session), "xrDestroySession");
+        layer.DestroyInstance();
+
+        result.displayTimes = runtime::GetSimulatedDisplayTimes();
+        return result;
+    }
+
+    RunMetrics Analyze(const RunResult& run) {
+        const XrDuration period = static_cast<XrDuration>(1e9 / run.refreshRate);
+
+        std::vector<double> latencies;
+        std::vector<double> predictionErrors;
+        std::vector<double> stallTimes;
+        std::vector<double> imageWaitTimes;
+        std::vector<double> focusOffsets;
+        size_t focusFovChangeCount = 0;
+        std::vector<XrTime> displayTimes;
+        for (size_t i = WarmupFrameCount; i < std::min(run.frames.size(), run.displayTimes.size()); i++) {
+            latencies.push_back((run.displayTimes[i] - run.frames[i].poseTime) / 1e6);
+            predictionErrors.push_back((run.displayTimes[i] - run.frames[i].predictedDisplayTime) / 1e6);
+            stallTimes.push_back(run.frames[i].stallTime);
+            imageWaitTimes.push_back(run.frames[i].imageWaitTime);
+            focusOffsets.push_back(run.frames[i].focusOffset);
+            focusFovChangeCount += run.frames[i].focusFovChanged ? 1 : 0;
+            displayTimes.push_back(run.displayTimes[i]);
+        }
+
+        RunMetrics metrics{};
+        metrics.frameCount = displayTimes.size();
+        metrics.poseToDisplayLatency = Summarize(latencies);
+        metrics.predictionError = Summarize(predictionErrors);
+        metrics.stallTime = Summarize(stallTimes);
+        metrics.imageWaitTime = Summarize(imageWaitTimes);
+        metrics.focusOffset = Summarize(focusOffsets);
+        if (displayTimes.empty()) {
+            return metrics;
+        }
+
+        std::sort(displayTimes.begin(), displayTimes.end());
+        const size_t displayedFrameCount =
+            std::unique(displayTimes.begin(), displayTimes.end()) - displayTimes.begin();
+        const uint64_t vsyncCount = (displayTimes.back() - displayTimes.front() + period / 2) / period + 1;
+        metrics.missedVsyncCount = vsyncCount - displayedFrameCount;
+        metrics.droppedFrameCount = metrics.frameCount - displayedFrameCount;
+        metrics.deliveredFrameRate = displayedFrameCount / (vsyncCount * period / 1e9);
+        metrics.focusFovChangeRate = 100.0 * focusFovChangeCount / metrics.frameCount;
+        return metrics;
+    }
+
+    void PrintResults(const std::vector<RunResult>& results) {
+        printf("%-7s %-6s %6s %7s %6s %7s %9s   %15s   %15s   %15s   %15s   %11s\n",
+               "Refresh",
+               "Mode",
+               "Frames",
+               "FPS",
+               "Missed",
+               "Dropped",
+               "Made-up",
+               "Pose-to-display",
+               "Pred. error",
+               "Stall",
+               "Image wait",
+               "Focus FOV");
+        printf("%-7s %-6s %6s %7s %6s %7s %9s   %15s   %15s   %15s   %15s   %11s\n",
+               "(Hz)",
+               "",
+               "",
+               "",
+               "vsyncs",
+               "frames",
+               "times",
+               "avg/p99 (ms)",
+               "avg/p99 (ms)",
+               "avg/p99 (ms)",
+               "avg/p99 (ms)",
+               "changes (%)");
+        for (const auto& run : results) {
+            const RunMetrics metrics = Analyze(run);
+            printf("%-7.0f %-6s %6zu %7.2f %6llu %7llu %9llu   %7.2f/%-7.2f   %7.2f/%-7.2f   %7.2f/%-7.2f   "
+                   "%7.2f/%-7.2f   %11.1f\n",
+                   run.refreshRate,
+                   ToShortString(run.mode),
+                   metrics.frameCount,
+                   metrics.deliveredFrameRate,
+                   static_cast<unsigned long long>(metrics.missedVsyncCount),
+                   static_cast<unsigned long long>(metrics.droppedFrameCount),
+                   static_cast<unsigned long long>(run.madeUpFrameCount),
+                   metrics.poseToDisplayLatency.average,
+                   metrics.poseToDisplayLatency.p99,
+                   metrics.predictionError.average,
+                   metrics.predictionError.p99,
+                   metrics.stallTime.average,
+                   metrics.stallTime.p99,
+                   metrics.imageWaitTime.average,
+                   metrics.imageWaitTime.p99,
+                   metrics.focusFovChangeRate);
+        }
+    }
+
+    // Compare each low latency run to the run with Turbo Mode off at the same refresh rate.
+    void PrintLowLatencyGains(const std::vector<RunResult>& results) {
+        for (const auto& run : results) {
+            if (run.mode != Mode::LowLatency) {
+                continue;
+            }
+            const auto reference = std::find_if(results.cbegin(), results.cend(), [&](const RunResult& candidate) {
+                return candidate.refreshRate == run.refreshRate && candidate.mode == Mode::Synchronous;
+            });
+            if (reference == results.cend()) {
+                continue;
+            }
+
+            const RunMetrics metrics = Analyze(run);
+            const RunMetrics referenceMetrics = Analyze(*reference);
+            printf("%.0f Hz, low latency mode: %.2fms (avg) %.2fms (p99) less pose-to-display latency, for %lld more "
+                   "missed vsyncs\n",
+                   run.refreshRate,
+                   referenceMetrics.poseToDisplayLatency.average - metrics.poseToDisplayLatency.average,
+                   referenceMetrics.poseToDisplayLatency.p99 - metrics.poseToDisplayLatency.p99,
+                   static_cast<long long>(metrics.missedVsyncCount) -
+                       static_cast<long long>(referenceMetrics.missedVsyncCount));
+        }
+    }
+
+    // Compare each run with asynchronous submission to the run with Turbo Mode on at the same refresh rate.
+    void PrintAsyncSubmitGains(const std::vector<RunResult>& results) {
+        for (const auto& run : results) {
+            if (run.mode != Mode::AsyncSubmit) {
+                continue;
+            }
+            const auto reference = std::find_if(results.cbegin(), results.cend(), [&](const RunResult& candidate) {
+                return candidate.refreshRate == run.refreshRate && candidate.mode == Mode::Turbo;
+            });
+            if (reference == results.cend()) {
+                continue;
+            }
+
+            const RunMetrics metrics = Analyze(run);
+            const RunMetrics referenceMetrics = Analyze(*reference);
+            printf("%.0f Hz, asynchronous submission: %.2fms (avg) %.2fms (p99) less stall on the render thread, for "
+                   "%.2fms (avg) %.2fms (p99) more pose-to-display latency\n",
+                   run.refreshRate,
+                   referenceMetrics.stallTime.average - metrics.stallTime.average,
+                   referenceMetrics.stallTime.p99 - metrics.stallTime.p99,
+                   metrics.poseToDisplayLatency.average - referenceMetrics.poseToDisplayLatency.average,
+                   metrics.poseToDisplayLatency.p99 - referenceMetrics.poseToDisplayLatency.p99);
+        }
+    }
+
+    // Compare each run with focus quantization to the run with Turbo Mode off at the same refresh rate.
+    void PrintFocusQuantizationGains(const std::vector<RunResult>& results) {
+        for (const auto& run : results) {
+            if (run.mode != Mode::FocusQuantization) {
+                continue;
+            }
+            const auto reference = std::find_if(results.cbegin(), results.cend(), [&](const RunResult& candidate) {
+                return candidate.refreshRate == run.refreshRate && candidate.mode == Mode::Synchronous;
+            });
+            if (reference == results.cend()) {
+                continue;
+            }
+
+            const RunMetrics metrics = Analyze(run);
+            const RunMetrics referenceMetrics = Analyze(*reference);
+            printf("%.0f Hz, focus quantization: the focus views changed in %.1f%% of the frames instead of %.1f%%, "
+                   "for a focus region %.2fdeg (avg) %.2fdeg (p99) away from the gaze instead of %.2fdeg (avg) "
+                   "%.2fdeg (p99)\n",
+                   run.refreshRate,
+                   metrics.focusFovChangeRate,
+                   referenceMetrics.focusFovChangeRate,
+                   metrics.focusOffset.average,
+                   metrics.focusOffset.p99,
+                   referenceMetrics.focusOffset.average,
+                   referenceMetrics.focusOffset.p99);
+        }
+    }
+
+    // Returns whether the auto-tuner wrote its progress, and whether the search is complete.
+    bool ReadAutoTuneProgress(bool& complete) {
+        std::ifstream file(GetApplicationConfigPath());
+        std::string line;
+        while (std::getline(file, line)) {
+            int passingLevel, failingLevel;
+            if (sscanf_s(line.c_str(), "auto_tune_progress=%d,%d", &passingLevel, &failingLevel) == 2) {
+                complete = failingLevel - passingLevel <= 1;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Run the simulated application until the layer's auto-tuner completes, one candidate per run, and print the
+    // settings it wrote. Returns false if it did not complete.
+    bool RunAutoTune(Layer& layer,
+                     const BenchmarkOptions& options,
+                     const std::vector<std::chrono::nanoseconds>& cpuTimes,
+                     const std::vector<std::chrono::nanoseconds>& gpuTimes) {
+        const double refreshRate = options.refreshRates.front();
+
+        // Start a new search.
+        std::filesystem::remove(GetApplicationConfigPath());
+
+        printf("%-4s %-27s %7s %6s %7s\n", "Run", "Multipliers", "FPS", "Missed", "Dropped");
+        printf("%-4s %-27s %7s %6s %7s\n", "", "periph./focus/focus scale", "", "vsyncs", "frames");
+        bool complete = false;
+        for (uint32_t i = 0; i < options.autoTuneRunCount && !complete; i++) {
+            const RunResult run = RunSimulation(layer, options, refreshRate, Mode::AutoTune, cpuTimes, gpuTimes);
+            const RunMetrics metrics = Analyze(run);
+            printf("%-4u %5.3f/%5.3f/%5.3fx%-5.3f %7.2f %6llu %7llu\n",
+                   i + 1,
+                   run.peripheralMultiplier,
+                   run.focusMultiplier,
+                   run.horizontalFocusScale,
+                   run.verticalFocusScale,
+                   metrics.deliveredFrameRate,
+                   static_cast<unsigned long long>(metrics.missedVsyncCount),
+                   static_cast<unsigned long long>(metrics.droppedFrameCount));
+
+            if (!ReadAutoTuneProgress(complete)) {
+                printf("The auto-tuner did not judge the run, more frames are needed\n");
+                return false;
+            }
+        }
+        printf("\n");
+
+        if (!complete) {
+            printf("The auto-tuner did not complete after %u runs\n", options.autoTuneRunCount);
+            return false;
+        }
+        printf("Settings written to %s:\n", GetApplicationConfigPath().string().c_str());
+        std::ifstream file(GetApplicationConfigPath());
+        std::string line;
+        while (std::getline(file, line)) {
+            printf("  %s\n", line.c_str());
+        }
+        return true;
+    }
+
+    // Returns false if any run allocated, or if the layer does not count its allocations.
+    bool CheckAllocations(const std::vector<RunResult>& results) {
+        bool success = true;
+        for (const auto& run : results) {
+            if (!run.allocationsTracked) {
+                printf("The layer does not count its heap allocations, a Debug build of the layer is needed\n");
+                return false;
+            }
+            if (run.frameLoopAllocationCount) {
+                printf("%.0f Hz, %s: %llu heap allocations in the frame loop\n",
+                       run.refreshRate,
+                       ToString(run.mode),
+                       static_cast<unsigned long long>(run.frameLoopAllocationCount));
+                success = false;
+            }
+        }
+        if (success) {
+            printf("No heap allocations in the frame loop\n");
+        }
+        return success;
+    }
+
+    void WriteCsv(const std::filesystem::path& path, const std::vector<RunResult>& results) {
+        std::ofstream csv(path);
+        if (!csv.is_open()) {
+            throw std::runtime_error("Failed to open " + path.string());
+        }
+
+        csv << "refresh_rate,mode,frame,cpu_ms,gpu_ms,stall_ms,image_wait_ms,pose_to_display_ms,"
+               "prediction_error_ms,focus_fov_changed,focus_offset_deg\n";
+        for (const auto& run : results) {
+            for (size_t i = 0; i < std::min(run.frames.size(), run.displayTimes.size()); i++) {
+                const auto& frame = run.frames[i];
+                csv << run.refreshRate << "," << ToShortString(run.mode) << "," << i << ","
+                    << ToMilliseconds(frame.cpuTime) << "," << ToMilliseconds(frame.gpuTime) << "," << frame.stallTime
+                    << "," << frame.imageWaitTime << "," << (run.displayTimes[i] - frame.poseTime) / 1e6 << ","
+                    << (run.displayTimes[i] - frame.predictedDisplayTime) / 1e6 << "," << frame.focusFovChanged << ","
+                    << frame.focusOffset << "\n";
+            }
+        }
+    }
+
+} // namespace
+
+namespace varjo_foveated::replay {
+
+    bool ParseBenchmarkOption(int argc, char** argv, int& i, BenchmarkOptions& options) {
+        const std::string_view arg(argv[i]);
+        if (arg == "--check-allocations") {
+            options.checkAllocations = true;
+            return true;
+        }
+        if (arg == "--low-latency") {
+            options.lowLatency = true;
+            return true;
+        }
+        if (arg == "--async-submit") {
+            options.asyncSubmit = true;
+            return true;
+        }
+        if (arg == "--no-stats") {
+            options.noStats = true;
+            return true;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const char* value = argv[i + 1];
+
+        bool valid = true;
+        if (arg == "--autotune") {
+            options.autoTuneRunCount = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+            valid = options.autoTuneRunCount > 0;
+        } else if (arg == "--autotune-window") {
+            char* end;
+            options.autoTuneWindow = strtod(value, &end);
+            valid = end != value && *end == '\0' && options.autoTuneWindow > 0;
+        } else if (arg == "--cpu") {
+            valid = ParsePair(value, options.cpu.mean, options.cpu.standardDeviation);
+        } else if (arg == "--gpu") {
+            valid = ParsePair(value, options.gpu.mean, options.gpu.standardDeviation);
+        } else if (arg == "--cpu-bimodal") {
+            valid = ParsePair(value, options.cpu.alternateMean, options.cpu.alternateProbability);
+        } else if (arg == "--gpu-bimodal") {
+            valid = ParsePair(value, options.gpu.alternateMean, options.gpu.alternateProbability);
+        } else if (arg == "--cpu-spikes") {
+            valid = ParsePair(value, options.cpu.spikeDuration, options.cpu.spikeProbability);
+        } else if (arg == "--gpu-spikes") {
+            valid = ParsePair(value, options.gpu.spikeDuration, options.gpu.spikeProbability);
+        } else if (arg == "--image-wait") {
+            char* end;
+            options.imageWait = strtod(value, &end);
+            valid = end != value && *end == '\0' && options.imageWait >= 0;
+        } else if (arg == "--end-frame") {
+            char* end;
+            options.endFrame = strtod(value, &end);
+            valid = end != value && *end == '\0' && options.endFrame >= 0;
+        } else if (arg == "--gaze") {
+            valid = ParsePair(value, options.gazeJitter, options.saccadeRate) && options.gazeJitter >= 0 &&
+                    options.saccadeRate >= 0;
+        } else if (arg == "--focus-quantization") {
+            valid = ParsePair(value, options.focusQuantization, options.focusDeadZone) &&
+                    options.focusQuantization > 0 && options.focusDeadZone >= 0;
+        } else if (arg == "--frames") {
+            options.frameCount = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+            valid = options.frameCount > WarmupFrameCount;
+        } else if (arg == "--seed") {
+            options.seed = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        } else if (arg == "--refresh") {
+            options.refreshRates.clear();
+            std::string_view list(value);
+            while (valid && !list.empty()) {
+                const size_t comma = list.find(',');
+                const std::string rate(list.substr(0, comma));
+                const double refreshRate = atof(rate.c_str());
+                valid = refreshRate > 0;
+                options.refreshRates.push_back(refreshRate);
+                list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+            }
+            valid = valid && !options.refreshRates.empty();
+        } else {
+            return false;
+        }
+
+        i++;
+        return valid;
+    }
+
+    bool RunBenchmark(Layer& layer, const BenchmarkOptions& options) {
+        if (options.checkAllocations && options.noStats) {
+            printf("The allocations are counted through the XR_MBUCCHIA_varjo_foveated_stats extension, --no-stats "
+                   "cannot be used with --check-allocations\n");
+            return false;
+        }
+
+        // All runs use the same workload.
+        std::mt19937 rng(options.seed);
+        std::vector<std::chrono::nanoseconds> cpuTimes;
+        std::vector<std::chrono::nanoseconds> gpuTimes;
+        for (uint32_t i = 0; i < options.frameCount; i++) {
+            cpuTimes.push_back(Sample(options.cpu, rng));
+            gpuTimes.push_back(Sample(options.gpu, rng));
+        }
+
+        PrintWorkload("CPU", options.cpu);
+        PrintWorkload("GPU", options.gpu);
+        printf("\n");
+
+        if (options.autoTuneRunCount) {
+            return RunAutoTune(layer, options, cpuTimes, gpuTimes);
+        }
+
+        std::vector<Mode> modes = {Mode::Synchronous, Mode::Turbo};
+        if (options.lowLatency) {
+            modes.push_back(Mode::LowLatency);
+        }
+        if (options.asyncSubmit) {
+            modes.push_back(Mode::AsyncSubmit);
+        }
+        if (options.focusQuantization > 0) {
+            modes.push_back(Mode::FocusQuantization);
+        }
+
+        std::vector<RunResult> results;
+        for (const double refreshRate : options.refreshRates) {
+            for (const Mode mode : modes) {
+                printf("Running at %.0f Hz, %s...\n", refreshRate, ToString(mode));
+                results.push_back(RunSimulation(layer, options, refreshRate, mode, cpuTimes, gpuTimes));
+            }
+        }
+        printf("\n");
+
+        PrintResults(results);
+        if (options.lowLatency) {
+            printf("\n");
+            PrintLowLatencyGains(results);
+        }
+        if (options.asyncSubmit) {
+            printf("\n");
+            PrintAsyncSubmitGains(results);
+        }
+        if (options.focusQuantization > 0) {
+            printf("\n");
+            PrintFocusQuantizationGains(results);
+        }
+        if (!options.csvPath.empty()) {
+            WriteCsv(options.csvPath, results);
+        }
+
+        if (options.checkAllocations) {
+            printf("\n");
+            return CheckAllocations(results);
+        }
+        return true;
+    }
+
+} // namespace varjo_foveated::replay
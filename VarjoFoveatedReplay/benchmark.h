@@ -0,0 +1,87 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "layer_loader.h"
+
+namespace varjo_foveated::replay {
+
+    // The distribution of the time spent by the simulated application on the CPU or the GPU for each frame, in
+    // milliseconds. Each frame draws from a normal distribution around the mean, or around the alternate mean with the
+    // given probability (bimodal load), and occasionally gets a spike added on top.
+    struct Workload {
+        double mean{0};
+        double standardDeviation{0};
+        double alternateMean{0};
+        double alternateProbability{0};
+        double spikeProbability{0};
+        double spikeDuration{0};
+    };
+
+    struct BenchmarkOptions {
+        Workload cpu{5.0, 0.5};
+        Workload gpu{7.0, 0.5};
+        // How long the compositor holds each swapchain image in xrWaitSwapchainImage(), in milliseconds.
+        double imageWait{0};
+        // How long the compositor blocks in xrEndFrame(), in milliseconds.
+        double endFrame{0};
+        std::vector<double> refreshRates{60, 90, 120};
+        uint32_t frameCount{600};
+        uint32_t seed{1};
+        // Settings for the layer, on top of which turbo_mode is toggled.
+        std::filesystem::path configPath;
+        std::filesystem::path csvPath;
+        // Also run with the layer's low latency mode, and compare it to Turbo Mode off.
+        bool lowLatency{false};
+        // Also run with the layer's asynchronous frame submission, and compare it to Turbo Mode on.
+        bool asyncSubmit{false};
+        // The simulated gaze: jitter during fixations (standard deviation, in degrees), and saccades per second. The
+        // gaze stays at the center by default.
+        double gazeJitter{0};
+        double saccadeRate{0};
+        // Also run with the layer's focus quantization on this grid and dead zone (in degrees), and compare it to
+        // Turbo Mode off.
+        double focusQuantization{0};
+        double focusDeadZone{0.25};
+        // Instead, run the layer's auto-tuner for up to this many runs at the first refresh rate, with the GPU time
+        // scaled by the resolution. The auto-tuner measures each run over the window, in seconds.
+        uint32_t autoTuneRunCount{0};
+        double autoTuneWindow{2.0};
+        // Fail if the layer allocates on the heap during the frame loop (Debug builds of the layer only).
+        bool checkAllocations{false};
+        // Run without the XR_MBUCCHIA_varjo_foveated_stats extension, like most applications, so that the layer skips
+        // the hooks only needed for the statistics. The made-up frames and the multipliers are then not reported.
+        bool noStats{false};
+    };
+
+    // Parse the benchmark option at argv[i], advancing i past its value. Returns false for an unknown or invalid
+    // option.
+    bool ParseBenchmarkOption(int argc, char** argv, int& i, BenchmarkOptions& options);
+
+    // Run a simulated application on top of the layer and a simulated compositor, for each refresh rate with Turbo
+    // Mode off then on (then in low latency mode, with asynchronous submission and with focus quantization if
+    // requested), and print the frame pacing of each run. Returns false if the allocation check failed, or if the
+    // auto-tuner did not complete.
+    bool RunBenchmark(Layer& layer, const BenchmarkOptions& options);
+
+} // namespace varjo_foveated::replay
@@ -0,0 +1,61 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "capture_file.h"
+
+namespace varjo_foveated::replay {
+
+    CaptureFile::CaptureFile(const std::filesystem::path& path) {
+        std::ifstream file(path, std::ios_base::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open " + path.string());
+        }
+
+        file.read(reinterpret_cast<char*>(&m_header), sizeof(m_header));
+        if (!file || m_header.magic != capture::Magic) {
+            throw std::runtime_error(path.string() + " is not a capture file");
+        }
+        if (m_header.version != capture::Version) {
+            throw std::runtime_error("Unsupported capture version " + std::to_string(m_header.version));
+        }
+
+        m_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+        // Index the records. A truncated record at the end (eg: the application crashed) is ignored.
+        size_t offset = 0;
+        while (offset + sizeof(capture::RecordHeader) <= m_data.size()) {
+            Record record;
+            std::memcpy(&record.header, m_data.data() + offset, sizeof(record.header));
+            const size_t payloadOffset = offset + sizeof(record.header);
+            if (payloadOffset + record.header.size > m_data.size()) {
+                break;
+            }
+
+            record.payload = m_data.data() + payloadOffset;
+            m_records.push_back(record);
+            offset = payloadOffset + record.header.size;
+        }
+    }
+
+} // namespace varjo_foveated::replay
@@ -0,0 +1,63 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+namespace varjo_foveated::replay {
+
+    struct Record {
+        capture::RecordHeader header;
+        const uint8_t* payload;
+
+        // Records are packed in the file, so the payloads are not necessarily aligned.
+        template <typename Payload>
+        Payload Read(size_t offset = 0) const {
+            Payload value{};
+            if (offset + sizeof(value) <= header.size) {
+                std::memcpy(&value, payload + offset, sizeof(value));
+            }
+            return value;
+        }
+    };
+
+    // A capture file loaded in memory. Replay needs to look ahead (the runtime waits issued by Turbo Mode complete
+    // after the application calls that follow them), so the whole file is loaded upfront.
+    class CaptureFile {
+      public:
+        // Throws std::runtime_error if the file cannot be read.
+        CaptureFile(const std::filesystem::path& path);
+
+        const capture::FileHeader& Header() const {
+            return m_header;
+        }
+
+        const std::vector<Record>& Records() const {
+            return m_records;
+        }
+
+      private:
+        capture::FileHeader m_header{};
+        std::vector<uint8_t> m_data;
+        std::vector<Record> m_records;
+    };
+
+} // namespace varjo_foveated::replay
@@ -0,0 +1,112 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "layer_loader.h"
+#include "runtime.h"
+
+namespace varjo_foveated::replay {
+
+    // Must match XR_APILAYER_MBUCCHIA_varjo_foveated.json.
+    constexpr const char* LayerName = "XR_APILAYER_MBUCCHIA_varjo_foveated";
+
+    void CheckXrResult(XrResult result, const char* call) {
+        if (XR_FAILED(result)) {
+            throw std::runtime_error(std::string(call) + " failed with " + std::to_string(result));
+        }
+    }
+
+    Layer::Layer(const std::filesystem::path& path) {
+        m_module = LoadLibraryW(path.wstring().c_str());
+        if (!m_module) {
+            throw std::runtime_error("Failed to load " + path.string());
+        }
+
+        const auto xrNegotiateLoaderApiLayerInterface = reinterpret_cast<PFN_xrNegotiateLoaderApiLayerInterface>(
+            GetProcAddress(m_module, "xrNegotiateLoaderApiLayerInterface"));
+        if (!xrNegotiateLoaderApiLayerInterface) {
+            throw std::runtime_error(path.string() + " is not an OpenXR API layer");
+        }
+
+        XrNegotiateLoaderInfo loaderInfo{};
+        loaderInfo.structType = XR_LOADER_INTERFACE_STRUCT_LOADER_INFO;
+        loaderInfo.structVersion = XR_LOADER_INFO_STRUCT_VERSION;
+        loaderInfo.structSize = sizeof(loaderInfo);
+        loaderInfo.minInterfaceVersion = XR_CURRENT_LOADER_API_LAYER_VERSION;
+        loaderInfo.maxInterfaceVersion = XR_CURRENT_LOADER_API_LAYER_VERSION;
+        loaderInfo.minApiVersion = XR_CURRENT_API_VERSION;
+        loaderInfo.maxApiVersion = XR_CURRENT_API_VERSION;
+
+        XrNegotiateApiLayerRequest apiLayerRequest{};
+        apiLayerRequest.structType = XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST;
+        apiLayerRequest.structVersion = XR_API_LAYER_INFO_STRUCT_VERSION;
+        apiLayerRequest.structSize = sizeof(apiLayerRequest);
+
+        CheckXrResult(xrNegotiateLoaderApiLayerInterface(&loaderInfo, LayerName, &apiLayerRequest),
+                      "xrNegotiateLoaderApiLayerInterface");
+        m_xrGetInstanceProcAddr = apiLayerRequest.getInstanceProcAddr;
+        m_xrCreateApiLayerInstance = apiLayerRequest.createApiLayerInstance;
+    }
+
+    Layer::~Layer() {
+        DestroyInstance();
+        FreeLibrary(m_module);
+    }
+
+    XrInstance Layer::CreateInstance(const std::vector<const char*>& extensions) {
+        XrApiLayerNextInfo nextInfo{};
+        nextInfo.structType = XR_LOADER_INTERFACE_STRUCT_API_LAYER_NEXT_INFO;
+        nextInfo.structVersion = XR_API_LAYER_NEXT_INFO_STRUCT_VERSION;
+        nextInfo.structSize = sizeof(nextInfo);
+        strncpy_s(nextInfo.layerName, LayerName, _TRUNCATE);
+        nextInfo.nextGetInstanceProcAddr = runtime::xrGetInstanceProcAddr;
+        nextInfo.nextCreateApiLayerInstance = runtime::xrCreateApiLayerInstance;
+
+        XrApiLayerCreateInfo apiLayerInfo{};
+        apiLayerInfo.structType = XR_LOADER_INTERFACE_STRUCT_API_LAYER_CREATE_INFO;
+        apiLayerInfo.structVersion = XR_API_LAYER_CREATE_INFO_STRUCT_VERSION;
+        apiLayerInfo.structSize = sizeof(apiLayerInfo);
+        apiLayerInfo.nextInfo = &nextInfo;
+
+        XrInstanceCreateInfo createInfo{XR_TYPE_INSTANCE_CREATE_INFO};
+        strncpy_s(createInfo.applicationInfo.applicationName, "VarjoFoveatedReplay", _TRUNCATE);
+        createInfo.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+        createInfo.enabledExtensionNames = extensions.data();
+
+        CheckXrResult(m_xrCreateApiLayerInstance(&createInfo, &apiLayerInfo, &m_instance), "xrCreateApiLayerInstance");
+
+        return m_instance;
+    }
+
+    void Layer::DestroyInstance() {
+        if (m_instance != XR_NULL_HANDLE) {
+            const auto xrDestroyInstance = Resolve<PFN_xrDestroyInstance>("xrDestroyInstance");
+            if (xrDestroyInstance) {
+                xrDestroyInstance(m_instance);
+            }
+            m_instance = XR_NULL_HANDLE;
+        }
+    }
+
+} // namespace varjo_foveated::replay
@@ -0,0 +1,56 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+namespace varjo_foveated::replay {
+
+    // The API layer DLL, loaded and initialized the way the OpenXR loader would, on top of the stand-in runtime.
+    class Layer {
+      public:
+        // Throws std::runtime_error if the layer cannot be loaded.
+        Layer(const std::filesystem::path& path);
+        ~Layer();
+
+        XrInstance CreateInstance(const std::vector<const char*>& extensions);
+        void DestroyInstance();
+
+        template <typename Function>
+        Function Resolve(const char* name) const {
+            PFN_xrVoidFunction function = nullptr;
+            if (XR_FAILED(m_xrGetInstanceProcAddr(m_instance, name, &function))) {
+                return nullptr;
+            }
+            return reinterpret_cast<Function>(function);
+        }
+
+      private:
+        HMODULE m_module{nullptr};
+        PFN_xrGetInstanceProcAddr m_xrGetInstanceProcAddr{nullptr};
+        PFN_xrCreateApiLayerInstance m_xrCreateApiLayerInstance{nullptr};
+        XrInstance m_instance{XR_NULL_HANDLE};
+    };
+
+    // Throws std::runtime_error if the call failed.
+    void CheckXrResult(XrResult result, const char* call);
+
+} // namespace varjo_foveated::replay
@@ -0,0 +1,604 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Replays a capture made by the Varjo Foveated API layer (capture=1 in settings.cfg) against the layer, with a stand-in
+// runtime returning the recorded results with the recorded timing. This lets us compare builds or settings of the
+// layer offline, on a real session.
+//
+// Usage: VarjoFoveatedReplay <capture.vfcap> [--layer <path to DLL>] [--config <settings.cfg>] [--csv <output.csv>]
+//
+// The calls are replayed in order on a single thread. The time the application spent between two calls is preserved,
+// and the runtime's xrWaitFrame() returns on the recorded vsync timeline.
+//
+// Usage: VarjoFoveatedReplay --benchmark [--refresh 60,90,120] [--frames <count>] [--seed <seed>]
+//                            [--cpu <ms>[,<stddev>]] [--gpu <ms>[,<stddev>]]
+//                            [--cpu-bimodal <ms>,<probability>] [--gpu-bimodal <ms>,<probability>]
+//                            [--cpu-spikes <ms>,<probability>] [--gpu-spikes <ms>,<probability>]
+//                            [--image-wait <ms>] [--end-frame <ms>] [--gaze <jitter deg>[,<saccades/s>]]
+//                            [--layer <path to DLL>] [--config <settings.cfg>] [--csv <output.csv>]
+//                            [--low-latency] [--async-submit] [--check-allocations] [--no-stats]
+//                            [--autotune <runs> [--autotune-window <seconds>]]
+//                            [--focus-quantization <deg>[,<dead zone deg>]]
+//
+// Instead of a capture, drives the layer with a simulated application on top of a simulated compositor, at each refresh
+// rate with Turbo Mode off then on. Reports the delivered frame rate, the missed vsyncs, the latency from locating the
+// views to displaying the frame, and the time the application was stalled in the frame calls and in the swapchain image
+// calls. With --image-wait, the compositor holds each swapchain image for the given time in xrWaitSwapchainImage().
+// With --end-frame, the compositor blocks for the given time in xrEndFrame(). With --gaze, the compositor's gaze and
+// focus views move: fixations on random points with the given jitter, separated by saccades at the given rate. The
+// results include how often the focus views FOV changed from one frame to the next.
+//
+// With --low-latency, also runs each refresh rate in the layer's low latency mode, and reports the latency gained and
+// the vsyncs missed compared to Turbo Mode off.
+//
+// With --async-submit, also runs each refresh rate with the layer's asynchronous frame submission, and reports the
+// stall time recovered on the render thread and the latency added compared to Turbo Mode on.
+//
+// With --focus-quantization, also runs each refresh rate with the layer's focus views quantized to the given grid and
+// dead zone, and reports how much less often the focus views changed and how far they moved from the gaze compared to
+// Turbo Mode off.
+//
+// With --autotune, instead runs the layer's auto-tuner at the first refresh rate until it completes, with the GPU time
+// scaled by the resolution picked by the layer, and prints the settings it wrote for the application. Each run lasts
+// for --frames, which must cover a quarter of the window for the warmup and the window itself.
+//
+// With --check-allocations, also fails if the layer allocated on the heap in its frame loop (xrPollEvent(),
+// xrLocateViews(), xrWaitFrame(), xrBeginFrame(), xrEndFrame(), the swapchain image functions and the threads serving
+// them) after the warmup frames. This requires a Debug build of the layer, which counts its allocations.
+//
+// With --no-stats, the simulated application does not enable the XR_MBUCCHIA_varjo_foveated_stats extension, like most
+// applications, so that the layer selects its hooks like it does for them.
+//
+// Usage: VarjoFoveatedReplay --soak <cycles> [--layer <path to DLL>] [--config <settings.cfg>]
+//
+// Creates, begins, runs for a few frames, ends and destroys sessions in a loop on a single instance of the layer. Fails
+// if the handles held by the runtime, the handles of the process or its private memory keep growing after the warmup
+// cycles.
+//
+// Usage: VarjoFoveatedReplay --microbenchmark <calls> [--layer <path to DLL>] [--config <settings.cfg>]
+//                            [--baseline-layer <path to DLL>]
+//
+// Calls the per-frame entry points of the layer in a tight loop, then the same entry points of the stand-in runtime
+// directly, and reports the cost added by the layer to each call. The calls are timed in batches, and the percentiles
+// are over the batches. Fails if the XR_MBUCCHIA_varjo_foveated_stats query costs over a microsecond.
+//
+// With --baseline-layer, also runs the same calls on another build of the layer, and reports the cost saved against
+// it. To measure the devirtualized hot path, build the baseline with VARJO_FOVEATED_NO_HOT_PATH=1 set in the
+// environment: all the hooks then go through the generic wrappers.
+
+#include "pch.h"
+
+#include "api.h"
+#include "benchmark.h"
+#include "capture_file.h"
+#include "layer_loader.h"
+#include "microbenchmark.h"
+#include "runtime.h"
+#include "soak.h"
+#include "statistics.h"
+#include "timing.h"
+
+namespace {
+
+    using namespace varjo_foveated;
+    using namespace varjo_foveated::replay;
+
+    struct Options {
+        std::filesystem::path capturePath;
+        std::filesystem::path layerPath;
+        std::filesystem::path configPath;
+        std::filesystem::path csvPath;
+        bool benchmark{false};
+        BenchmarkOptions benchmarkOptions;
+        bool soak{false};
+        SoakOptions soakOptions;
+        bool microbenchmark{false};
+        MicrobenchmarkOptions microbenchmarkOptions;
+    };
+
+    // Timing of one frame, in milliseconds.
+    struct FrameTiming {
+        double endFrameTime;
+        double frameInterval;
+        double waitFrameDuration;
+    };
+
+    void PrintDistribution(const char* name, const Distribution& recorded, const Distribution& replayed) {
+        printf("%-24s %8.3f %8.3f %8.3f %8.3f   %8.3f %8.3f %8.3f %8.3f\n",
+               name,
+               recorded.average,
+               recorded.p50,
+               recorded.p99,
+               recorded.max,
+               replayed.average,
+               replayed.p50,
+               replayed.p99,
+               replayed.max);
+    }
+
+    class Replay {
+      public:
+        Replay(const CaptureFile& capture, Layer& layer) : m_capture(capture), m_layer(layer) {
+        }
+
+        void Run() {
+            std::vector<const char*> extensions = {XR_VARJO_QUAD_VIEWS_EXTENSION_NAME,
+                                                   XR_MBUCCHIA_VARJO_FOVEATED_STATS_EXTENSION_NAME};
+            m_instance = m_layer.CreateInstance(extensions);
+            m_api = ResolveApi(m_layer);
+
+            // Like the application, query the views (the layer applies its resolution settings there).
+            uint32_t viewCount = 0;
+            CheckXrResult(m_api.xrEnumerateViewConfigurationViews(
+                              m_instance, 1, XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO, 0, &viewCount, nullptr),
+                          "xrEnumerateViewConfigurationViews");
+            std::vector<XrViewConfigurationView> views(viewCount, {XR_TYPE_VIEW_CONFIGURATION_VIEW});
+            CheckXrResult(m_api.xrEnumerateViewConfigurationViews(m_instance,
+                                                                  1,
+                                                                  XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO,
+                                                                  viewCount,
+                                                                  &viewCount,
+                                                                  views.data()),
+                          "xrEnumerateViewConfigurationViews");
+
+            const auto& records = m_capture.Records();
+            const auto firstCall = std::find_if(records.cbegin(), records.cend(), [](const Record& record) {
+                return record.header.type != capture::RecordType::RuntimeWaitFrame;
+            });
+            if (firstCall == records.cend()) {
+                throw std::runtime_error("The capture is empty");
+            }
+
+            // Align the recorded timeline with the first call.
+            m_startTime = std::chrono::steady_clock::now() - std::chrono::nanoseconds(firstCall->header.timestamp);
+            runtime::Reset(m_startTime);
+            for (const auto& record : records) {
+                if (record.header.type == capture::RecordType::RuntimeWaitFrame) {
+                    runtime::QueueWaitFrame(record.header, record.Read<capture::WaitFrameRecord>());
+                }
+            }
+
+            int64_t previousCallEnd = firstCall->header.timestamp;
+            for (auto it = firstCall; it != records.cend(); ++it) {
+                const Record& record = *it;
+                if (record.header.type == capture::RecordType::RuntimeWaitFrame) {
+                    continue;
+                }
+
+                // Reproduce the time the application spent between the two calls.
+                const auto applicationTime = std::chrono::nanoseconds(record.header.timestamp - previousCallEnd);
+                if (applicationTime.count() > 0) {
+                    SleepFor(applicationTime);
+                }
+                previousCallEnd = record.header.timestamp + record.header.duration;
+
+                ReplayCall(record);
+            }
+
+            if (m_api.xrGetFoveatedStatsMBUCCHIA) {
+                m_foveatedStats = {XR_TYPE_FOVEATED_STATS_MBUCCHIA};
+                m_api.xrGetFoveatedStatsMBUCCHIA(m_session, &m_foveatedStats);
+            }
+            if (m_session != XR_NULL_HANDLE) {
+                m_api.xrDestroySession(m_session);
+                m_session = XR_NULL_HANDLE;
+            }
+            m_layer.DestroyInstance();
+        }
+
+        void PrintSummary() const {
+            const auto& header = m_capture.Header();
+            printf("Capture: %s on %s\n", header.applicationName, header.runtimeName);
+            printf("Captured with: config %08x, turbo_mode=%u, no_eye_tracking=%u, peripheral_multiplier=%.3f, "
+                   "focus_multiplier=%.3f, horizontal_focus_scale=%.3f, vertical_focus_scale=%.3f\n",
+                   header.configSnapshotId,
+                   header.turboMode,
+                   header.noEyeTracking,
+                   header.peripheralMultiplier,
+                   header.focusMultiplier,
+                   header.horizontalFocusScale,
+                   header.verticalFocusScale);
+            printf("\n");
+
+            // Compute the same metrics on the capture itself, for comparison.
+            std::vector<double> recordedFrameIntervals;
+            std::vector<double> recordedWaitFrameDurations;
+            int64_t lastEndFrame = -1;
+            for (const auto& record : m_capture.Records()) {
+                if (record.header.type == capture::RecordType::EndFrame && XR_SUCCEEDED(record.header.result)) {
+                    const int64_t endFrame = record.header.timestamp + record.header.duration;
+                    if (lastEndFrame >= 0) {
+                        recordedFrameIntervals.push_back((endFrame - lastEndFrame) / 1e6);
+                    }
+                    lastEndFrame = endFrame;
+                } else if (record.header.type == capture::RecordType::WaitFrame) {
+                    recordedWaitFrameDurations.push_back(record.header.duration / 1e6);
+                }
+            }
+
+            std::vector<double> frameIntervals;
+            std::vector<double> waitFrameDurations;
+            for (size_t i = 0; i < m_frames.size(); i++) {
+                if (i > 0) {
+                    frameIntervals.push_back(m_frames[i].frameInterval);
+                }
+                waitFrameDurations.push_back(m_frames[i].waitFrameDuration);
+            }
+
+            printf("%-24s %8s %8s %8s %8s   %8s %8s %8s %8s\n",
+                   "(ms)",
+                   "rec avg",
+                   "rec p50",
+                   "rec p99",
+                   "rec max",
+                   "avg",
+                   "p50",
+                   "p99",
+                   "max");
+            PrintDistribution("Frame interval", Summarize(recordedFrameIntervals), Summarize(frameIntervals));
+            PrintDistribution("xrWaitFrame", Summarize(recordedWaitFrameDurations), Summarize(waitFrameDurations));
+            printf("\n");
+
+            const auto stats = runtime::GetStats();
+            printf("Frames: %zu recorded, %llu replayed\n",
+                   recordedFrameIntervals.size() + (lastEndFrame >= 0 ? 1 : 0),
+                   static_cast<unsigned long long>(stats.endFrameCount));
+            printf("Runtime waits: %llu (%llu past the end of the capture), %llu missed vsyncs\n",
+                   static_cast<unsigned long long>(stats.waitFrameCount),
+                   static_cast<unsigned long long>(stats.synthesizedWaitFrameCount),
+                   static_cast<unsigned long long>(stats.missedVsyncCount));
+            printf("Frames with corrected focus FOV: %llu\n", static_cast<unsigned long long>(m_patchedFovFrameCount));
+            if (m_foveatedStats.type == XR_TYPE_FOVEATED_STATS_MBUCCHIA) {
+                printf("Made-up predicted display times: %llu\n",
+                       static_cast<unsigned long long>(m_foveatedStats.madeUpFrameCount));
+            }
+        }
+
+        void WriteCsv(const std::filesystem::path& path) const {
+            std::ofstream csv(path);
+            if (!csv.is_open()) {
+                throw std::runtime_error("Failed to open " + path.string());
+            }
+
+            csv << "frame,end_frame_ms,frame_interval_ms,wait_frame_ms\n";
+            for (size_t i = 0; i < m_frames.size(); i++) {
+                csv << i << "," << m_frames[i].endFrameTime << "," << m_frames[i].frameInterval << ","
+                    << m_frames[i].waitFrameDuration << "\n";
+            }
+        }
+
+      private:
+        // The application uses the display times returned by the layer, which may differ from the recorded ones.
+        XrTime MapDisplayTime(XrTime recordedDisplayTime) const {
+            return recordedDisplayTime + m_displayTimeOffset;
+        }
+
+        void ReplayCall(const Record& record) {
+            switch (record.header.type) {
+            case capture::RecordType::BeginSession: {
+                const auto call = record.Read<capture::BeginSessionRecord>();
+                if (m_session == XR_NULL_HANDLE) {
+                    XrSessionCreateInfo createInfo{XR_TYPE_SESSION_CREATE_INFO};
+                    createInfo.systemId = 1;
+                    CheckXrResult(m_api.xrCreateSession(m_instance, &createInfo, &m_session), "xrCreateSession");
+
+                    XrReferenceSpaceCreateInfo spaceInfo{XR_TYPE_REFERENCE_SPACE_CREATE_INFO};
+                    spaceInfo.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_LOCAL;
+                    spaceInfo.poseInReferenceSpace.orientation.w = 1.f;
+                    CheckXrResult(m_api.xrCreateReferenceSpace(m_session, &spaceInfo, &m_localSpace),
+                                  "xrCreateReferenceSpace");
+                }
+
+                XrSessionBeginInfo beginInfo{XR_TYPE_SESSION_BEGIN_INFO};
+                beginInfo.primaryViewConfigurationType =
+                    static_cast<XrViewConfigurationType>(call.primaryViewConfigurationType);
+                CheckXrResult(m_api.xrBeginSession(m_session, &beginInfo), "xrBeginSession");
+                break;
+            }
+
+            case capture::RecordType::DestroySession:
+                if (m_session != XR_NULL_HANDLE) {
+                    CheckXrResult(m_api.xrDestroySession(m_session), "xrDestroySession");
+                    m_session = XR_NULL_HANDLE;
+                }
+                break;
+
+            case capture::RecordType::LocateViews: {
+                const auto call = record.Read<capture::LocateViewsRecord>();
+                runtime::SetLocateViews(call);
+
+                XrViewLocateInfo locateInfo{XR_TYPE_VIEW_LOCATE_INFO};
+                locateInfo.viewConfigurationType = static_cast<XrViewConfigurationType>(call.viewConfigurationType);
+                locateInfo.displayTime = MapDisplayTime(call.displayTime);
+                locateInfo.space = m_localSpace;
+                XrViewState viewState{XR_TYPE_VIEW_STATE};
+                std::vector<XrView> views(call.viewCount, {XR_TYPE_VIEW});
+                uint32_t viewCount = 0;
+                m_api.xrLocateViews(m_session, &locateInfo, &viewState, call.viewCount, &viewCount, views.data());
+                break;
+            }
+
+            case capture::RecordType::WaitFrame: {
+                const auto call = record.Read<capture::WaitFrameRecord>();
+
+                XrFrameState frameState{XR_TYPE_FRAME_STATE};
+                const auto start = std::chrono::steady_clock::now();
+                const XrResult result = m_api.xrWaitFrame(m_session, nullptr, &frameState);
+                m_lastWaitFrameDuration = ToMilliseconds(std::chrono::steady_clock::now() - start);
+                CheckXrResult(result, "xrWaitFrame");
+
+                if (call.predictedDisplayTime) {
+                    m_displayTimeOffset = frameState.predictedDisplayTime - call.predictedDisplayTime;
+                }
+                break;
+            }
+
+            case capture::RecordType::BeginFrame:
+                CheckXrResult(m_api.xrBeginFrame(m_session, nullptr), "xrBeginFrame");
+                break;
+
+            case capture::RecordType::EndFrame:
+                // A call that failed submitted no frame.
+                if (XR_SUCCEEDED(record.header.result)) {
+                    ReplayEndFrame(record);
+                }
+                break;
+
+            case capture::RecordType::AcquireSwapchainImage: {
+                const auto call = record.Read<capture::SwapchainImageRecord>();
+                runtime::SetSwapchainImage(record.header, call);
+
+                uint32_t index;
+                m_api.xrAcquireSwapchainImage(reinterpret_cast<XrSwapchain>(call.swapchain), nullptr, &index);
+                break;
+            }
+
+            case capture::RecordType::WaitSwapchainImage: {
+                const auto call = record.Read<capture::SwapchainImageRecord>();
+                runtime::SetSwapchainImage(record.header, call);
+
+                XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+                waitInfo.timeout = XR_INFINITE_DURATION;
+                m_api.xrWaitSwapchainImage(reinterpret_cast<XrSwapchain>(call.swapchain), &waitInfo);
+                break;
+            }
+
+            case capture::RecordType::ReleaseSwapchainImage: {
+                const auto call = record.Read<capture::SwapchainImageRecord>();
+                runtime::SetSwapchainImage(record.header, call);
+
+                m_api.xrReleaseSwapchainImage(reinterpret_cast<XrSwapchain>(call.swapchain), nullptr);
+                break;
+            }
+
+            default:
+                // Unknown record (from a newer layer).
+                break;
+            }
+        }
+
+        void ReplayEndFrame(const Record& record) {
+            const auto call = record.Read<capture::EndFrameRecord>();
+
+            // Rebuild the projection layers. Other layer types cannot be replayed without their content.
+            std::vector<XrCompositionLayerProjection> projectionLayers;
+            std::vector<std::vector<XrCompositionLayerProjectionView>> projectionViews;
+            projectionLayers.reserve(call.layerCount);
+            projectionViews.reserve(call.layerCount);
+            size_t offset = sizeof(call);
+            for (uint32_t i = 0; i < call.layerCount; i++) {
+                const auto layer = record.Read<capture::CompositionLayerRecord>(offset);
+                offset += sizeof(layer);
+
+                std::vector<XrCompositionLayerProjectionView> views;
+                for (uint32_t eye = 0; eye < layer.viewCount; eye++) {
+                    const auto view = record.Read<capture::ProjectionViewRecord>(offset);
+                    offset += sizeof(view);
+
+                    XrCompositionLayerProjectionView projectionView{XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW};
+                    projectionView.pose = view.pose;
+                    projectionView.fov = view.fov;
+                    projectionView.subImage.swapchain = reinterpret_cast<XrSwapchain>(view.swapchain);
+                    projectionView.subImage.imageRect = view.imageRect;
+                    projectionView.subImage.imageArrayIndex = view.imageArrayIndex;
+                    views.push_back(projectionView);
+                }
+
+                if (layer.type == XR_TYPE_COMPOSITION_LAYER_PROJECTION) {
+                    projectionViews.push_back(std::move(views));
+
+                    XrCompositionLayerProjection projectionLayer{XR_TYPE_COMPOSITION_LAYER_PROJECTION};
+                    projectionLayer.layerFlags = layer.layerFlags;
+                    projectionLayer.space = m_localSpace;
+                    projectionLayer.viewCount = static_cast<uint32_t>(projectionViews.back().size());
+                    projectionLayer.views = projectionViews.back().data();
+                    projectionLayers.push_back(projectionLayer);
+                }
+            }
+
+            std::vector<const XrCompositionLayerBaseHeader*> layers;
+            for (const auto& projectionLayer : projectionLayers) {
+                layers.push_back(reinterpret_cast<const XrCompositionLayerBaseHeader*>(&projectionLayer));
+            }
+
+            // The layer may modify the submitted FOVs.
+            std::vector<XrFovf> submittedFovs;
+            for (const auto& views : projectionViews) {
+                for (const auto& view : views) {
+                    submittedFovs.push_back(view.fov);
+                }
+            }
+
+            XrFrameEndInfo frameEndInfo{XR_TYPE_FRAME_END_INFO};
+            frameEndInfo.displayTime = MapDisplayTime(call.displayTime);
+            frameEndInfo.environmentBlendMode = static_cast<XrEnvironmentBlendMode>(call.environmentBlendMode);
+            frameEndInfo.layerCount = static_cast<uint32_t>(layers.size());
+            frameEndInfo.layers = layers.data();
+            CheckXrResult(m_api.xrEndFrame(m_session, &frameEndInfo), "xrEndFrame");
+
+            const auto now = std::chrono::steady_clock::now();
+            FrameTiming timing{};
+            timing.endFrameTime = ToMilliseconds(now - m_startTime);
+            timing.frameInterval = m_frames.empty() ? 0 : timing.endFrameTime - m_frames.back().endFrameTime;
+            timing.waitFrameDuration = m_lastWaitFrameDuration;
+            m_frames.push_back(timing);
+
+            const auto submitted = runtime::GetLastSubmittedFrame();
+            for (size_t i = 0; i < std::min(submitted.fovs.size(), submittedFovs.size()); i++) {
+                if (std::memcmp(&submitted.fovs[i], &submittedFovs[i], sizeof(XrFovf))) {
+                    m_patchedFovFrameCount++;
+                    break;
+                }
+            }
+        }
+
+        const CaptureFile& m_capture;
+        Layer& m_layer;
+        Api m_api{};
+
+        XrInstance m_instance{XR_NULL_HANDLE};
+        XrSession m_session{XR_NULL_HANDLE};
+        XrSpace m_localSpace{XR_NULL_HANDLE};
+
+        std::chrono::steady_clock::time_point m_startTime;
+        XrDuration m_displayTimeOffset{0};
+        double m_lastWaitFrameDuration{0};
+        std::vector<FrameTiming> m_frames;
+        uint64_t m_patchedFovFrameCount{0};
+        XrFoveatedStatsMBUCCHIA m_foveatedStats{};
+    };
+
+    bool ParseOptions(int argc, char** argv, Options& options) {
+        for (int i = 1; i < argc; i++) {
+            const std::string_view arg(argv[i]);
+            if (arg == "--layer" && i + 1 < argc) {
+                options.layerPath = argv[++i];
+            } else if (arg == "--config" && i + 1 < argc) {
+                options.configPath = argv[++i];
+            } else if (arg == "--csv" && i + 1 < argc) {
+                options.csvPath = argv[++i];
+            } else if (arg == "--benchmark") {
+                options.benchmark = true;
+            } else if (arg == "--soak" && i + 1 < argc) {
+                options.soak = true;
+                options.soakOptions.cycleCount = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+                if (!options.soakOptions.cycleCount) {
+                    return false;
+                }
+            } else if (arg == "--microbenchmark" && i + 1 < argc) {
+                options.microbenchmark = true;
+                options.microbenchmarkOptions.callCount = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+                if (!options.microbenchmarkOptions.callCount) {
+                    return false;
+                }
+            } else if (arg == "--baseline-layer" && i + 1 < argc) {
+                options.microbenchmarkOptions.baselineLayerPath = argv[++i];
+            } else if (options.capturePath.empty() && arg.substr(0, 2) != "--") {
+                options.capturePath = argv[i];
+            } else if (!ParseBenchmarkOption(argc, argv, i, options.benchmarkOptions)) {
+                return false;
+            }
+        }
+        if (options.benchmark + options.soak + options.microbenchmark > 1) {
+            return false;
+        }
+        return options.benchmark || options.soak || options.microbenchmark ? options.capturePath.empty()
+                                                                            : !options.capturePath.empty();
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        fprintf(stderr,
+                "Usage: %s <capture.vfcap> [--layer <path to DLL>] [--config <settings.cfg>] [--csv <output.csv>]\n"
+                "       %s --benchmark [--refresh 60,90,120] [--frames <count>] [--seed <seed>]\n"
+                "           [--cpu <ms>[,<stddev>]] [--gpu <ms>[,<stddev>]]\n"
+                "           [--cpu-bimodal <ms>,<probability>] [--gpu-bimodal <ms>,<probability>]\n"
+                "           [--cpu-spikes <ms>,<probability>] [--gpu-spikes <ms>,<probability>]\n"
+                "           [--image-wait <ms>] [--end-frame <ms>] [--gaze <jitter deg>[,<saccades/s>]]\n"
+                "           [--layer <path to DLL>] [--config <settings.cfg>] [--csv <output.csv>]\n"
+                "           [--low-latency] [--async-submit] [--check-allocations] [--no-stats]\n"
+                "           [--autotune <runs> [--autotune-window <seconds>]]\n"
+                "           [--focus-quantization <deg>[,<dead zone deg>]]\n"
+                "       %s --soak <cycles> [--layer <path to DLL>] [--config <settings.cfg>]\n"
+                "       %s --microbenchmark <calls> [--layer <path to DLL>] [--config <settings.cfg>]\n"
+                "           [--baseline-layer <path to DLL>]\n",
+                argv[0],
+                argv[0],
+                argv[0],
+                argv[0]);
+        return 1;
+    }
+
+    // Improve the accuracy of the sleeps.
+    timeBeginPeriod(1);
+
+    bool success = true;
+    try {
+        // The layer reads its configuration when the instance is created.
+        if (!options.configPath.empty() && !options.benchmark) {
+            _putenv_s("VARJO_FOVEATED_CONFIG", std::filesystem::absolute(options.configPath).string().c_str());
+        }
+
+        // By default, use the layer built alongside the replay.
+        if (options.layerPath.empty()) {
+            char path[_MAX_PATH];
+            GetModuleFileNameA(nullptr, path, sizeof(path));
+            options.layerPath = std::filesystem::path(path).parent_path() / "XR_APILAYER_MBUCCHIA_varjo_foveated.dll";
+        }
+
+        if (options.benchmark) {
+            Layer layer(options.layerPath);
+
+            options.benchmarkOptions.configPath = options.configPath;
+            options.benchmarkOptions.csvPath = options.csvPath;
+            success = RunBenchmark(layer, options.benchmarkOptions);
+        } else if (options.soak) {
+            Layer layer(options.layerPath);
+
+            success = RunSoak(layer, options.soakOptions);
+        } else if (options.microbenchmark) {
+            Layer layer(options.layerPath);
+
+            success = RunMicrobenchmark(layer, options.microbenchmarkOptions);
+        } else {
+            const CaptureFile capture(options.capturePath);
+            Layer layer(options.layerPath);
+
+            Replay replay(capture, layer);
+            replay.Run();
+            replay.PrintSummary();
+            if (!options.csvPath.empty()) {
+                replay.WriteCsv(options.csvPath);
+            }
+        }
+    } catch (const std::exception& exc) {
+        fprintf(stderr, "%s\n", exc.what());
+        timeEndPeriod(1);
+        return 1;
+    }
+
+    timeEndPeriod(1);
+    return success ? 0 : 1;
+}
@@ -0,0 +1,261 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "api.h"
+#include "microbenchmark.h"
+#include "runtime.h"
+#include "statistics.h"
+
+namespace {
+
+    using namespace varjo_foveated;
+    using namespace varjo_foveated::replay;
+
+    // The calls are timed in batches, so that reading the clock does not dominate the cost of a call. The percentiles
+    // are over the average cost of a call in each batch, not over single calls.
+    constexpr uint32_t BatchSize = 1000;
+
+    // The XR_MBUCCHIA_varjo_foveated_stats query is meant to be called every frame.
+    constexpr double StatsQueryBudgetNs = 1000;
+
+    // The cost of one call, in nanoseconds, over the batches.
+    struct CallCost {
+        Distribution layer;
+        Distribution runtime;
+
+        double Added() const {
+            return layer.p50 - runtime.p50;
+        }
+    };
+
+    // The cost of the per-frame entry points of one build of the layer.
+    struct EntryPointCosts {
+        CallCost locateViews;
+        CallCost acquireReleaseImage;
+        bool hasStatsQuery{false};
+        Distribution statsQuery;
+        // Any failure is counted, rather than checked on every call.
+        uint32_t failureCount{0};
+    };
+
+    // Time a call, made in batches of BatchSize. The first batches warm up the caches and the branch predictors.
+    template <typename Call>
+    Distribution TimeCall(uint32_t callCount, Call&& call) {
+        const uint32_t batchCount = std::max(callCount / BatchSize, 1u);
+        const uint32_t warmupBatchCount = std::max(batchCount / 10, 1u);
+
+        std::vector<double> samples;
+        samples.reserve(batchCount);
+        for (uint32_t batch = 0; batch < warmupBatchCount + batchCount; batch++) {
+            const auto start = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < BatchSize; i++) {
+                call();
+            }
+            const auto duration = std::chrono::steady_clock::now() - start;
+            if (batch >= warmupBatchCount) {
+                samples.push_back(std::chrono::duration<double, std::nano>(duration).count() / BatchSize);
+            }
+        }
+        return Summarize(std::move(samples));
+    }
+
+    // Run a session on the layer, and time its per-frame entry points, then the same entry points of the stand-in
+    // runtime called directly.
+    EntryPointCosts TimeEntryPoints(Layer& layer, uint32_t callCount) {
+        runtime::Reset(std::chrono::steady_clock::now());
+        runtime::StartSimulation(11'111'111);
+
+        std::vector<const char*> extensions = {XR_VARJO_QUAD_VIEWS_EXTENSION_NAME,
+                                               XR_MBUCCHIA_VARJO_FOVEATED_STATS_EXTENSION_NAME};
+        const XrInstance instance = layer.CreateInstance(extensions);
+        const Api api = ResolveApi(layer);
+
+        // The same entry points of the stand-in runtime, without the layer.
+        Api direct{};
+        runtime::xrGetInstanceProcAddr(
+            instance, "xrLocateViews", reinterpret_cast<PFN_xrVoidFunction*>(&direct.xrLocateViews));
+        runtime::xrGetInstanceProcAddr(instance,
+                                       "xrAcquireSwapchainImage",
+                                       reinterpret_cast<PFN_xrVoidFunction*>(&direct.xrAcquireSwapchainImage));
+        runtime::xrGetInstanceProcAddr(instance,
+                                       "xrReleaseSwapchainImage",
+                                       reinterpret_cast<PFN_xrVoidFunction*>(&direct.xrReleaseSwapchainImage));
+
+        uint32_t viewCount = 0;
+        CheckXrResult(api.xrEnumerateViewConfigurationViews(
+                          instance, 1, XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO, 0, &viewCount, nullptr),
+                      "xrEnumerateViewConfigurationViews");
+        std::vector<XrViewConfigurationView> configurationViews(viewCount, {XR_TYPE_VIEW_CONFIGURATION_VIEW});
+        CheckXrResult(api.xrEnumerateViewConfigurationViews(instance,
+                                                            1,
+                                                            XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO,
+                                                            viewCount,
+                                                            &viewCount,
+                                                            configurationViews.data()),
+                      "xrEnumerateViewConfigurationViews");
+
+        XrSession session;
+        XrSessionCreateInfo createInfo{XR_TYPE_SESSION_CREATE_INFO};
+        createInfo.systemId = 1;
+        CheckXrResult(api.xrCreateSession(instance, &createInfo, &session), "xrCreateSession");
+
+        XrSpace localSpace;
+        XrReferenceSpaceCreateInfo spaceInfo{XR_TYPE_REFERENCE_SPACE_CREATE_INFO};
+        spaceInfo.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_LOCAL;
+        spaceInfo.poseInReferenceSpace.orientation.w = 1.f;
+        CheckXrResult(api.xrCreateReferenceSpace(session, &spaceInfo, &localSpace), "xrCreateReferenceSpace");
+
+        XrSwapchain swapchain;
+        XrSwapchainCreateInfo swapchainInfo{XR_TYPE_SWAPCHAIN_CREATE_INFO};
+        swapchainInfo.usageFlags = XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
+        swapchainInfo.width = configurationViews[0].recommendedImageRectWidth;
+        swapchainInfo.height = configurationViews[0].recommendedImageRectHeight;
+        swapchainInfo.sampleCount = configurationViews[0].recommendedSwapchainSampleCount;
+        swapchainInfo.arraySize = swapchainInfo.faceCount = swapchainInfo.mipCount = 1;
+        CheckXrResult(api.xrCreateSwapchain(session, &swapchainInfo, &swapchain), "xrCreateSwapchain");
+
+        XrSessionBeginInfo beginInfo{XR_TYPE_SESSION_BEGIN_INFO};
+        beginInfo.primaryViewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO;
+        CheckXrResult(api.xrBeginSession(session, &beginInfo), "xrBeginSession");
+
+        EntryPointCosts costs{};
+
+        XrViewLocateInfo locateInfo{XR_TYPE_VIEW_LOCATE_INFO};
+        locateInfo.viewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO;
+        locateInfo.displayTime = runtime::GetSimulatedTime();
+        locateInfo.space = localSpace;
+        XrViewState viewState{XR_TYPE_VIEW_STATE};
+        std::vector<XrView> views(viewCount, {XR_TYPE_VIEW});
+        const auto locateViews = [&](PFN_xrLocateViews xrLocateViews) {
+            return [&, xrLocateViews] {
+                uint32_t viewCountOutput = 0;
+                costs.failureCount += XR_FAILED(
+                    xrLocateViews(session, &locateInfo, &viewState, viewCount, &viewCountOutput, views.data()));
+            };
+        };
+        costs.locateViews.layer = TimeCall(callCount, locateViews(api.xrLocateViews));
+        costs.locateViews.runtime = TimeCall(callCount, locateViews(direct.xrLocateViews));
+
+        const auto acquireReleaseImage = [&](const Api& entryPoints) {
+            return [&, entryPoints] {
+                uint32_t imageIndex;
+                costs.failureCount +=
+                    XR_FAILED(entryPoints.xrAcquireSwapchainImage(swapchain, nullptr, &imageIndex));
+                costs.failureCount += XR_FAILED(entryPoints.xrReleaseSwapchainImage(swapchain, nullptr));
+            };
+        };
+        costs.acquireReleaseImage.layer = TimeCall(callCount, acquireReleaseImage(api));
+        costs.acquireReleaseImage.runtime = TimeCall(callCount, acquireReleaseImage(direct));
+
+        // The stats query is implemented by the layer alone.
+        if (api.xrGetFoveatedStatsMBUCCHIA) {
+            XrFoveatedStatsMBUCCHIA stats{XR_TYPE_FOVEATED_STATS_MBUCCHIA};
+            costs.hasStatsQuery = true;
+            costs.statsQuery = TimeCall(callCount, [&] {
+                costs.failureCount += XR_FAILED(api.xrGetFoveatedStatsMBUCCHIA(session, &stats));
+            });
+        }
+
+        CheckXrResult(api.xrEndSession(session), "xrEndSession");
+        CheckXrResult(api.xrDestroySwapchain(swapchain), "xrDestroySwapchain");
+        CheckXrResult(api.xrDestroySpace(localSpace), "xrDestroySpace");
+        CheckXrResult(api.xrDestroySession(session), "xrDestroySession");
+        layer.DestroyInstance();
+
+        return costs;
+    }
+
+    void PrintCallCost(const char* name, const CallCost& cost) {
+        printf("%-36s %8.1f %8.1f   %8.1f %8.1f   %8.1f\n",
+               name,
+               cost.layer.p50,
+               cost.layer.p99,
+               cost.runtime.p50,
+               cost.runtime.p99,
+               cost.Added());
+    }
+
+    // The cost added by each build of the layer, and how much of it the build under test saves.
+    void PrintBaselineCallCost(const char* name, const CallCost& cost, const CallCost& baselineCost) {
+        printf("%-36s %8.1f %8.1f   %8.1f\n",
+               name,
+               cost.Added(),
+               baselineCost.Added(),
+               baselineCost.Added() - cost.Added());
+    }
+
+} // namespace
+
+namespace varjo_foveated::replay {
+
+    bool RunMicrobenchmark(Layer& layer, const MicrobenchmarkOptions& options) {
+        printf("Microbenchmark: %u calls per entry point, timed in batches of %u\n", options.callCount, BatchSize);
+        printf("The percentiles are over the average cost of a call in each batch\n\n");
+        printf("%-36s %8s %8s   %8s %8s   %8s\n", "(ns per call)", "p50", "p99", "rt p50", "rt p99", "added");
+
+        const EntryPointCosts costs = TimeEntryPoints(layer, options.callCount);
+        uint32_t failureCount = costs.failureCount;
+
+        PrintCallCost("xrLocateViews", costs.locateViews);
+        PrintCallCost("xrAcquire/ReleaseSwapchainImage", costs.acquireReleaseImage);
+
+        bool withinBudget = true;
+        if (costs.hasStatsQuery) {
+            printf("%-36s %8.1f %8.1f   %8s %8s   %8.1f\n",
+                   "xrGetFoveatedStatsMBUCCHIA",
+                   costs.statsQuery.p50,
+                   costs.statsQuery.p99,
+                   "-",
+                   "-",
+                   costs.statsQuery.p50);
+            if (costs.statsQuery.p99 > StatsQueryBudgetNs) {
+                fprintf(stderr,
+                        "xrGetFoveatedStatsMBUCCHIA is over its budget of %.0fns per call (p99 over the batches)\n",
+                        StatsQueryBudgetNs);
+                withinBudget = false;
+            }
+        }
+
+        // The same session on another build of the layer, typically with the generic wrappers for every hook (see
+        // dispatch_generator.py). Both builds run the same hooks, so the difference is the cost of the dispatch.
+        if (!options.baselineLayerPath.empty()) {
+            Layer baseline(options.baselineLayerPath);
+            const EntryPointCosts baselineCosts = TimeEntryPoints(baseline, options.callCount);
+            failureCount += baselineCosts.failureCount;
+
+            printf("\nAgainst the baseline %s\n\n", options.baselineLayerPath.string().c_str());
+            printf("%-36s %8s %8s   %8s\n", "(ns added per call, p50)", "layer", "baseline", "saved");
+            PrintBaselineCallCost("xrLocateViews", costs.locateViews, baselineCosts.locateViews);
+            PrintBaselineCallCost(
+                "xrAcquire/ReleaseSwapchainImage", costs.acquireReleaseImage, baselineCosts.acquireReleaseImage);
+        }
+
+        if (failureCount) {
+            fprintf(stderr, "%u calls failed\n", failureCount);
+            return false;
+        }
+        return withinBudget;
+    }
+
+} // namespace varjo_foveated::replay
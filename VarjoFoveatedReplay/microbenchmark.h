@@ -0,0 +1,41 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include "layer_loader.h"
+
+namespace varjo_foveated::replay {
+
+    struct MicrobenchmarkOptions {
+        // Calls made to each entry point.
+        uint32_t callCount{1'000'000};
+        // Another build of the layer to compare with, if not empty.
+        std::filesystem::path baselineLayerPath;
+    };
+
+    // Time the per-frame entry points of the layer in a tight loop, against the same entry points of the stand-in
+    // runtime called directly, and print the cost added by the layer to each call. Also time the
+    // XR_MBUCCHIA_varjo_foveated_stats query. With a baseline layer, also print how much of the added cost the layer
+    // saves compared to the baseline. Returns false if a call failed, or if the query took over a microsecond.
+    bool RunMicrobenchmark(Layer& layer, const MicrobenchmarkOptions& options);
+
+} // namespace varjo_foveated::replay
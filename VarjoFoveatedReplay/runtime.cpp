@@ -0,0 +1,640 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "runtime.h"
+#include "timing.h"
+
+namespace {
+
+    using namespace varjo_foveated;
+    using namespace varjo_foveated::replay;
+
+    // The handles handed out by the stand-in runtime. They are never dereferenced.
+    const XrInstance Instance = reinterpret_cast<XrInstance>(uintptr_t(0x1000));
+    const XrSystemId SystemId = 1;
+
+    // Matches the Varjo Aero.
+    const XrDuration DefaultDisplayPeriod = 11'111'111;
+
+    // XrTime of the start of the replay or simulation. XrTime 0 is not a valid time.
+    const XrTime BaseTime = 1'000'000'000;
+
+    // The recommended resolution of the views of the quad views configuration.
+    const uint32_t PeripheralViewSize = 1600;
+    const uint32_t FocusViewSize = 1400;
+    const uint64_t RecommendedPixelCount =
+        2ull * PeripheralViewSize * PeripheralViewSize + 2ull * FocusViewSize * FocusViewSize;
+
+    // Half of the field of view of the views of the quad views configuration, in radians.
+    const float PeripheralViewAngle = 0.9f;
+    const float FocusViewAngle = 0.35f;
+
+    struct WaitFrameResult {
+        capture::RecordHeader header;
+        capture::WaitFrameRecord record;
+    };
+
+    struct {
+        std::mutex mutex;
+        std::chrono::steady_clock::time_point startTime;
+
+        std::deque<WaitFrameResult> waitFrameResults;
+        // How late the replay is running compared to the recorded vsync timeline.
+        std::chrono::nanoseconds timelineOffset{0};
+        XrTime lastPredictedDisplayTime{0};
+        XrDuration lastPredictedDisplayPeriod{DefaultDisplayPeriod};
+        std::chrono::steady_clock::time_point lastWakeTime;
+
+        capture::LocateViewsRecord locateViews{};
+        capture::RecordHeader swapchainImageHeader{};
+        capture::SwapchainImageRecord swapchainImage{};
+
+        // Simulated compositor. Also read without the lock by xrWaitFrame().
+        std::atomic<bool> simulating{false};
+        XrTime lastSimulatedWakeTime{0};
+        XrTime gpuIdleTime{0};
+        std::chrono::nanoseconds nextFrameGpuTime{0};
+        std::chrono::nanoseconds imageWaitTime{0};
+        std::chrono::nanoseconds endFrameTime{0};
+        bool resolutionScaledGpuTime{false};
+        std::map<XrSwapchain, uint64_t> swapchainPixelCounts;
+        std::vector<XrTime> simulatedDisplayTimes;
+
+        uint64_t nextHandle{0x10000};
+        runtime::Stats stats{};
+        runtime::SubmittedFrame lastSubmittedFrame;
+    } g_state;
+
+    XrTime ToXrTime(std::chrono::steady_clock::time_point time) {
+        return BaseTime + std::chrono::duration_cast<std::chrono::nanoseconds>(time - g_state.startTime).count();
+    }
+
+    std::chrono::steady_clock::time_point FromXrTime(XrTime time) {
+        return g_state.startTime + std::chrono::nanoseconds(time - BaseTime);
+    }
+
+    // The first vsync at or after the given time.
+    XrTime NextVsync(XrTime time) {
+        const XrDuration period = g_state.lastPredictedDisplayPeriod;
+        return BaseTime + ((std::max(time, BaseTime) - BaseTime + period - 1) / period) * period;
+    }
+
+    XrResult SimulateWaitFrame(XrFrameState* frameState) {
+        XrTime wakeTime;
+        {
+            std::unique_lock lock(g_state.mutex);
+
+            g_state.stats.waitFrameCount++;
+            const XrTime now = ToXrTime(std::chrono::steady_clock::now());
+            // Throttle to one frame per vsync, and to at most one frame of GPU work queued.
+            wakeTime = NextVsync(std::max({now,
+                                           g_state.lastSimulatedWakeTime + g_state.lastPredictedDisplayPeriod,
+                                           g_state.gpuIdleTime - g_state.lastPredictedDisplayPeriod}));
+            g_state.lastSimulatedWakeTime = wakeTime;
+
+            frameState->predictedDisplayTime = wakeTime + g_state.lastPredictedDisplayPeriod;
+            frameState->predictedDisplayPeriod = g_state.lastPredictedDisplayPeriod;
+            frameState->shouldRender = XR_TRUE;
+        }
+
+        SleepUntil(FromXrTime(wakeTime));
+
+        return XR_SUCCESS;
+    }
+
+    void SimulateEndFrame(const XrFrameEndInfo* frameEndInfo) {
+        const XrTime now = ToXrTime(std::chrono::steady_clock::now());
+        XrDuration gpuTime = g_state.nextFrameGpuTime.count();
+        if (g_state.resolutionScaledGpuTime) {
+            uint64_t pixelCount = 0;
+            for (const auto& [swapchain, swapchainPixelCount] : g_state.swapchainPixelCounts) {
+                pixelCount += swapchainPixelCount;
+            }
+            gpuTime = static_cast<XrDuration>(gpuTime * (double)pixelCount / RecommendedPixelCount);
+        }
+        const XrTime gpuDoneTime = std::max(now, g_state.gpuIdleTime) + gpuTime;
+        g_state.gpuIdleTime = gpuDoneTime;
+
+        // A frame cannot be displayed before its target display time.
+        g_state.simulatedDisplayTimes.push_back(NextVsync(std::max(gpuDoneTime, frameEndInfo->displayTime)));
+    }
+
+    XrResult XRAPI_CALL xrEnumerateInstanceExtensionProperties(const char* layerName,
+                                                                uint32_t propertyCapacityInput,
+                                                                uint32_t* propertyCountOutput,
+                                                                XrExtensionProperties* properties) {
+        static const char* const extensions[] = {XR_VARJO_QUAD_VIEWS_EXTENSION_NAME,
+                                                 XR_VARJO_FOVEATED_RENDERING_EXTENSION_NAME,
+                                                 XR_KHR_WIN32_CONVERT_PERFORMANCE_COUNTER_TIME_EXTENSION_NAME};
+
+        *propertyCountOutput = static_cast<uint32_t>(std::size(extensions));
+        if (propertyCapacityInput) {
+            if (propertyCapacityInput < *propertyCountOutput) {
+                return XR_ERROR_SIZE_INSUFFICIENT;
+            }
+            for (uint32_t i = 0; i < *propertyCountOutput; i++) {
+                strncpy_s(properties[i].extensionName, extensions[i], _TRUNCATE);
+                properties[i].extensionVersion = 1;
+            }
+        }
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrDestroyInstance(XrInstance instance) {
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrGetInstanceProperties(XrInstance instance, XrInstanceProperties* instanceProperties) {
+        strncpy_s(instanceProperties->runtimeName, "VarjoFoveatedReplay", _TRUNCATE);
+        instanceProperties->runtimeVersion = XR_MAKE_VERSION(1, 0, 0);
+        return XR_SUCCESS;
+    }
+
+    // The steady clock counts the performance counter, like on a real system.
+    XrResult XRAPI_CALL xrConvertWin32PerformanceCounterToTimeKHR(XrInstance instance,
+                                                                   const LARGE_INTEGER* performanceCounter,
+                                                                   XrTime* time) {
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        const std::chrono::nanoseconds sinceEpoch(
+            performanceCounter->QuadPart / frequency.QuadPart * 1'000'000'000 +
+            performanceCounter->QuadPart % frequency.QuadPart * 1'000'000'000 / frequency.QuadPart);
+
+        std::unique_lock lock(g_state.mutex);
+
+        *time = ToXrTime(std::chrono::steady_clock::time_point(sinceEpoch));
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrGetSystem(XrInstance instance, const XrSystemGetInfo* getInfo, XrSystemId* systemId) {
+        *systemId = SystemId;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrGetSystemProperties(XrInstance instance,
+                                              XrSystemId systemId,
+                                              XrSystemProperties* properties) {
+        properties->systemId = SystemId;
+        strncpy_s(properties->systemName, "VarjoFoveatedReplay", _TRUNCATE);
+
+        auto entry = reinterpret_cast<XrBaseOutStructure*>(properties->next);
+        while (entry) {
+            if (entry->type == XR_TYPE_SYSTEM_FOVEATED_RENDERING_PROPERTIES_VARJO) {
+                reinterpret_cast<XrSystemFoveatedRenderingPropertiesVARJO*>(entry)->supportsFoveatedRendering =
+                    XR_TRUE;
+            }
+            entry = entry->next;
+        }
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrEnumerateViewConfigurationViews(XrInstance instance,
+                                                          XrSystemId systemId,
+                                                          XrViewConfigurationType viewConfigurationType,
+                                                          uint32_t viewCapacityInput,
+                                                          uint32_t* viewCountOutput,
+                                                          XrViewConfigurationView* views) {
+        *viewCountOutput = viewConfigurationType == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO ? 4 : 2;
+        if (viewCapacityInput) {
+            if (viewCapacityInput < *viewCountOutput) {
+                return XR_ERROR_SIZE_INSUFFICIENT;
+            }
+            for (uint32_t i = 0; i < *viewCountOutput; i++) {
+                const uint32_t size = i < 2 ? PeripheralViewSize : FocusViewSize;
+                views[i].recommendedImageRectWidth = views[i].maxImageRectWidth = size;
+                views[i].recommendedImageRectHeight = views[i].maxImageRectHeight = size;
+                views[i].recommendedSwapchainSampleCount = 1;
+                views[i].maxSwapchainSampleCount = 8;
+            }
+        }
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrGetViewConfigurationProperties(XrInstance instance,
+                                                         XrSystemId systemId,
+                                                         XrViewConfigurationType viewConfigurationType,
+                                                         XrViewConfigurationProperties* configurationProperties) {
+        configurationProperties->viewConfigurationType = viewConfigurationType;
+        configurationProperties->fovMutable = XR_TRUE;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrCreateSession(XrInstance instance,
+                                        const XrSessionCreateInfo* createInfo,
+                                        XrSession* session) {
+        std::unique_lock lock(g_state.mutex);
+
+        // Each session gets a new handle, so that the layer cannot mix up the state of successive sessions.
+        *session = reinterpret_cast<XrSession>(g_state.nextHandle++);
+        g_state.stats.liveSessionCount++;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrDestroySession(XrSession session) {
+        std::unique_lock lock(g_state.mutex);
+
+        g_state.stats.liveSessionCount--;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrBeginSession(XrSession session, const XrSessionBeginInfo* beginInfo) {
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrEndSession(XrSession session) {
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrCreateReferenceSpace(XrSession session,
+                                               const XrReferenceSpaceCreateInfo* createInfo,
+                                               XrSpace* space) {
+        std::unique_lock lock(g_state.mutex);
+
+        *space = reinterpret_cast<XrSpace>(g_state.nextHandle++);
+        g_state.stats.liveSpaceCount++;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrDestroySpace(XrSpace space) {
+        std::unique_lock lock(g_state.mutex);
+
+        g_state.stats.liveSpaceCount--;
+        return XR_SUCCESS;
+    }
+
+    // The layer only locates the gaze.
+    XrResult XRAPI_CALL xrLocateSpace(XrSpace space, XrSpace baseSpace, XrTime time, XrSpaceLocation* location) {
+        std::unique_lock lock(g_state.mutex);
+
+        location->locationFlags = g_state.locateViews.gazeLocationFlags;
+        location->pose = g_state.locateViews.gazePose;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrLocateViews(XrSession session,
+                                      const XrViewLocateInfo* viewLocateInfo,
+                                      XrViewState* viewState,
+                                      uint32_t viewCapacityInput,
+                                      uint32_t* viewCountOutput,
+                                      XrView* views) {
+        std::unique_lock lock(g_state.mutex);
+
+        *viewCountOutput = g_state.locateViews.viewCount;
+        if (viewCapacityInput) {
+            if (viewCapacityInput < *viewCountOutput) {
+                return XR_ERROR_SIZE_INSUFFICIENT;
+            }
+            viewState->viewStateFlags = g_state.locateViews.viewStateFlags;
+            for (uint32_t i = 0; i < *viewCountOutput; i++) {
+                views[i].pose = g_state.locateViews.views[i].pose;
+                views[i].fov = g_state.locateViews.views[i].fov;
+            }
+        }
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrWaitFrame(XrSession session, const XrFrameWaitInfo* frameWaitInfo, XrFrameState* frameState) {
+        if (g_state.simulating) {
+            return SimulateWaitFrame(frameState);
+        }
+
+        std::chrono::steady_clock::time_point wakeTime;
+        XrResult result = XR_SUCCESS;
+        {
+            std::unique_lock lock(g_state.mutex);
+
+            g_state.stats.waitFrameCount++;
+            if (!g_state.waitFrameResults.empty()) {
+                const auto& next = g_state.waitFrameResults.front();
+                wakeTime = g_state.startTime + g_state.timelineOffset +
+                           std::chrono::nanoseconds(next.header.timestamp + next.header.duration);
+                result = static_cast<XrResult>(next.header.result);
+                g_state.lastPredictedDisplayTime = next.record.predictedDisplayTime;
+                if (next.record.predictedDisplayPeriod) {
+                    g_state.lastPredictedDisplayPeriod = next.record.predictedDisplayPeriod;
+                }
+                frameState->shouldRender = next.record.shouldRender;
+                g_state.waitFrameResults.pop_front();
+            } else {
+                // Keep going at the last known refresh rate.
+                g_state.stats.synthesizedWaitFrameCount++;
+                wakeTime = g_state.lastWakeTime + std::chrono::nanoseconds(g_state.lastPredictedDisplayPeriod);
+                g_state.lastPredictedDisplayTime += g_state.lastPredictedDisplayPeriod;
+                frameState->shouldRender = XR_TRUE;
+            }
+
+            // Like a compositor, we can only wake up on a vsync boundary. Once a vsync is missed, the rest of the
+            // recorded timeline is shifted.
+            const auto now = std::chrono::steady_clock::now();
+            while (wakeTime < now) {
+                wakeTime += std::chrono::nanoseconds(g_state.lastPredictedDisplayPeriod);
+                g_state.timelineOffset += std::chrono::nanoseconds(g_state.lastPredictedDisplayPeriod);
+                g_state.stats.missedVsyncCount++;
+            }
+            g_state.lastWakeTime = wakeTime;
+
+            frameState->predictedDisplayTime = g_state.lastPredictedDisplayTime;
+            frameState->predictedDisplayPeriod = g_state.lastPredictedDisplayPeriod;
+        }
+
+        SleepUntil(wakeTime);
+
+        return result;
+    }
+
+    XrResult XRAPI_CALL xrBeginFrame(XrSession session, const XrFrameBeginInfo* frameBeginInfo) {
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrEndFrame(XrSession session, const XrFrameEndInfo* frameEndInfo) {
+        std::chrono::nanoseconds duration;
+        {
+            std::unique_lock lock(g_state.mutex);
+
+            duration = g_state.simulating ? g_state.endFrameTime : std::chrono::nanoseconds(0);
+        }
+        SleepFor(duration);
+
+        std::unique_lock lock(g_state.mutex);
+
+        g_state.stats.endFrameCount++;
+        if (g_state.simulating) {
+            SimulateEndFrame(frameEndInfo);
+        }
+
+        g_state.lastSubmittedFrame.displayTime = frameEndInfo->displayTime;
+        g_state.lastSubmittedFrame.fovs.clear();
+        for (uint32_t i = 0; i < frameEndInfo->layerCount; i++) {
+            if (frameEndInfo->layers[i]->type == XR_TYPE_COMPOSITION_LAYER_PROJECTION) {
+                const auto proj = reinterpret_cast<const XrCompositionLayerProjection*>(frameEndInfo->layers[i]);
+                for (uint32_t eye = 0; eye < proj->viewCount; eye++) {
+                    g_state.lastSubmittedFrame.fovs.push_back(proj->views[eye].fov);
+                }
+            }
+        }
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrCreateSwapchain(XrSession session,
+                                          const XrSwapchainCreateInfo* createInfo,
+                                          XrSwapchain* swapchain) {
+        std::unique_lock lock(g_state.mutex);
+
+        *swapchain = reinterpret_cast<XrSwapchain>(g_state.nextHandle++);
+        g_state.stats.liveSwapchainCount++;
+        g_state.swapchainPixelCounts[*swapchain] = static_cast<uint64_t>(createInfo->width) * createInfo->height;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrDestroySwapchain(XrSwapchain swapchain) {
+        std::unique_lock lock(g_state.mutex);
+
+        g_state.stats.liveSwapchainCount--;
+        g_state.swapchainPixelCounts.erase(swapchain);
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrAcquireSwapchainImage(XrSwapchain swapchain,
+                                                const XrSwapchainImageAcquireInfo* acquireInfo,
+                                                uint32_t* index) {
+        std::unique_lock lock(g_state.mutex);
+
+        *index = g_state.swapchainImage.index;
+        return static_cast<XrResult>(g_state.swapchainImageHeader.result);
+    }
+
+    // Stands for the wait on the GPU: block for as long as the recorded call did.
+    XrResult XRAPI_CALL xrWaitSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageWaitInfo* waitInfo) {
+        std::chrono::nanoseconds duration;
+        XrResult result;
+        {
+            std::unique_lock lock(g_state.mutex);
+
+            if (g_state.simulating) {
+                duration = g_state.imageWaitTime;
+                result = XR_SUCCESS;
+            } else {
+                duration = std::chrono::nanoseconds(g_state.swapchainImageHeader.duration);
+                result = static_cast<XrResult>(g_state.swapchainImageHeader.result);
+            }
+        }
+
+        SleepFor(duration);
+
+        return result;
+    }
+
+    XrResult XRAPI_CALL xrReleaseSwapchainImage(XrSwapchain swapchain,
+                                                const XrSwapchainImageReleaseInfo* releaseInfo) {
+        std::unique_lock lock(g_state.mutex);
+
+        return static_cast<XrResult>(g_state.swapchainImageHeader.result);
+    }
+
+} // namespace
+
+namespace varjo_foveated::replay::runtime {
+
+    void Reset(std::chrono::steady_clock::time_point startTime) {
+        std::unique_lock lock(g_state.mutex);
+
+        g_state.startTime = startTime;
+        g_state.waitFrameResults.clear();
+        g_state.timelineOffset = {};
+        g_state.lastPredictedDisplayTime = 0;
+        g_state.lastPredictedDisplayPeriod = DefaultDisplayPeriod;
+        g_state.lastWakeTime = startTime;
+        g_state.locateViews = {};
+        g_state.swapchainImageHeader = {};
+        g_state.swapchainImage = {};
+        g_state.simulating = false;
+        g_state.lastSimulatedWakeTime = 0;
+        g_state.gpuIdleTime = 0;
+        g_state.nextFrameGpuTime = {};
+        g_state.imageWaitTime = {};
+        g_state.endFrameTime = {};
+        g_state.resolutionScaledGpuTime = false;
+        g_state.swapchainPixelCounts.clear();
+        g_state.simulatedDisplayTimes.clear();
+        g_state.stats = {};
+        g_state.lastSubmittedFrame = {};
+    }
+
+    void QueueWaitFrame(const capture::RecordHeader& header, const capture::WaitFrameRecord& record) {
+        std::unique_lock lock(g_state.mutex);
+
+        g_state.waitFrameResults.push_back({header, record});
+    }
+
+    void SetLocateViews(const capture::LocateViewsRecord& record) {
+        std::unique_lock lock(g_state.mutex);
+
+        g_state.locateViews = record;
+    }
+
+    void SetSwapchainImage(const capture::RecordHeader& header, const capture::SwapchainImageRecord& record) {
+        std::unique_lock lock(g_state.mutex);
+
+        g_state.swapchainImageHeader = header;
+        g_state.swapchainImage = record;
+    }
+
+    void StartSimulation(XrDuration displayPeriod) {
+        std::unique_lock lock(g_state.mutex);
+
+        g_state.simulating = true;
+        g_state.lastPredictedDisplayPeriod = displayPeriod;
+
+        // A tracked gaze, and the views of a Varjo Aero.
+        g_state.locateViews = {};
+        g_state.locateViews.gazeLocationFlags =
+            XR_SPACE_LOCATION_ORIENTATION_VALID_BIT | XR_SPACE_LOCATION_ORIENTATION_TRACKED_BIT;
+        g_state.locateViews.gazePose.orientation.w = 1.f;
+        g_state.locateViews.viewStateFlags =
+            XR_VIEW_STATE_ORIENTATION_VALID_BIT | XR_VIEW_STATE_ORIENTATION_TRACKED_BIT;
+        g_state.locateViews.viewCount = 4;
+        for (uint32_t i = 0; i < 4; i++) {
+            const float angle = i < 2 ? PeripheralViewAngle : FocusViewAngle;
+            g_state.locateViews.views[i].pose.orientation.w = 1.f;
+            g_state.locateViews.views[i].fov = {-angle, angle, angle, -angle};
+        }
+    }
+
+    void SetSimulatedGaze(float horizontalAngle, float verticalAngle) {
+        std::unique_lock lock(g_state.mutex);
+
+        // A rotation around +Y turns the gaze left, then a rotation around +X turns it up.
+        const float sinYaw = std::sin(-horizontalAngle / 2), cosYaw = std::cos(-horizontalAngle / 2);
+        const float sinPitch = std::sin(verticalAngle / 2), cosPitch = std::cos(verticalAngle / 2);
+        g_state.locateViews.gazePose.orientation = {
+            cosYaw * sinPitch, sinYaw * cosPitch, -sinYaw * sinPitch, cosYaw * cosPitch};
+
+        for (uint32_t i = 2; i < 4; i++) {
+            g_state.locateViews.views[i].fov = {-FocusViewAngle + horizontalAngle,
+                                                FocusViewAngle + horizontalAngle,
+                                                FocusViewAngle + verticalAngle,
+                                                -FocusViewAngle + verticalAngle};
+        }
+    }
+
+    void SetSimulatedImageWaitTime(std::chrono::nanoseconds waitTime) {
+        std::unique_lock lock(g_state.mutex);
+
+        g_state.imageWaitTime = waitTime;
+    }
+
+    void SetSimulatedEndFrameTime(std::chrono::nanoseconds endFrameTime) {
+        std::unique_lock lock(g_state.mutex);
+
+        g_state.endFrameTime = endFrameTime;
+    }
+
+    void SetResolutionScaledGpuTime(bool enabled) {
+        std::unique_lock lock(g_state.mutex);
+
+        g_state.resolutionScaledGpuTime = enabled;
+    }
+
+    void SetNextFrameGpuTime(std::chrono::nanoseconds gpuTime) {
+        std::unique_lock lock(g_state.mutex);
+
+        g_state.nextFrameGpuTime = gpuTime;
+    }
+
+    XrTime GetSimulatedTime() {
+        std::unique_lock lock(g_state.mutex);
+
+        return ToXrTime(std::chrono::steady_clock::now());
+    }
+
+    std::vector<XrTime> GetSimulatedDisplayTimes() {
+        std::unique_lock lock(g_state.mutex);
+
+        return g_state.simulatedDisplayTimes;
+    }
+
+    void ClearSimulatedDisplayTimes() {
+        std::unique_lock lock(g_state.mutex);
+
+        g_state.simulatedDisplayTimes.clear();
+    }
+
+    Stats GetStats() {
+        std::unique_lock lock(g_state.mutex);
+
+        return g_state.stats;
+    }
+
+    SubmittedFrame GetLastSubmittedFrame() {
+        std::unique_lock lock(g_state.mutex);
+
+        return g_state.lastSubmittedFrame;
+    }
+
+    XrResult XRAPI_CALL xrGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function) {
+#define RESOLVE(api)                                                                                                   \
+    if (std::string_view(name) == #api) {                                                                              \
+        *function = reinterpret_cast<PFN_xrVoidFunction>(::api);                                                       \
+        return XR_SUCCESS;                                                                                             \
+    }
+
+        RESOLVE(xrEnumerateInstanceExtensionProperties);
+        RESOLVE(xrDestroyInstance);
+        RESOLVE(xrGetInstanceProperties);
+        RESOLVE(xrConvertWin32PerformanceCounterToTimeKHR);
+        RESOLVE(xrGetSystem);
+        RESOLVE(xrGetSystemProperties);
+        RESOLVE(xrEnumerateViewConfigurationViews);
+        RESOLVE(xrGetViewConfigurationProperties);
+        RESOLVE(xrCreateSession);
+        RESOLVE(xrDestroySession);
+        RESOLVE(xrBeginSession);
+        RESOLVE(xrEndSession);
+        RESOLVE(xrCreateReferenceSpace);
+        RESOLVE(xrDestroySpace);
+        RESOLVE(xrLocateSpace);
+        RESOLVE(xrLocateViews);
+        RESOLVE(xrWaitFrame);
+        RESOLVE(xrBeginFrame);
+        RESOLVE(xrEndFrame);
+        RESOLVE(xrCreateSwapchain);
+        RESOLVE(xrDestroySwapchain);
+        RESOLVE(xrAcquireSwapchainImage);
+        RESOLVE(xrWaitSwapchainImage);
+        RESOLVE(xrReleaseSwapchainImage);
+
+#undef RESOLVE
+
+        *function = nullptr;
+        return XR_ERROR_FUNCTION_UNSUPPORTED;
+    }
+
+    XrResult XRAPI_CALL xrCreateApiLayerInstance(const XrInstanceCreateInfo* info,
+                                                 const XrApiLayerCreateInfo* apiLayerInfo,
+                                                 XrInstance* instance) {
+        *instance = Instance;
+        return XR_SUCCESS;
+    }
+
+} // namespace varjo_foveated::replay::runtime
@@ -0,0 +1,103 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+// A stand-in for the OpenXR runtime, placed under the layer in the replay. It implements just enough of OpenXR for the
+// layer and the replay to run, and returns the results recorded in the capture instead of talking to a headset. It can
+// also simulate a compositor, for benchmarking.
+namespace varjo_foveated::replay::runtime {
+
+    struct Stats {
+        uint64_t waitFrameCount;
+        // xrWaitFrame() calls for which there was no recorded result left.
+        uint64_t synthesizedWaitFrameCount;
+        // Number of times xrWaitFrame() was called too late to return at its recorded time.
+        uint64_t missedVsyncCount;
+        uint64_t endFrameCount;
+        // Handles created and not destroyed yet. Destroying a session does not destroy its spaces and swapchains here,
+        // so that the handles leaked by the layer remain visible.
+        int64_t liveSessionCount;
+        int64_t liveSpaceCount;
+        int64_t liveSwapchainCount;
+    };
+
+    // The views submitted to the runtime with the last xrEndFrame().
+    struct SubmittedFrame {
+        XrTime displayTime;
+        std::vector<XrFovf> fovs;
+    };
+
+    // Reset the runtime state. Recorded timestamps are relative to the given start time.
+    void Reset(std::chrono::steady_clock::time_point startTime);
+
+    // Queue the result of a runtime xrWaitFrame(). Results are returned in order.
+    void QueueWaitFrame(const capture::RecordHeader& header, const capture::WaitFrameRecord& record);
+
+    // Set the results of the next xrLocateSpace() and xrLocateViews().
+    void SetLocateViews(const capture::LocateViewsRecord& record);
+
+    // Set the results of the next swapchain image call.
+    void SetSwapchainImage(const capture::RecordHeader& header, const capture::SwapchainImageRecord& record);
+
+    // Replace the recorded results with a compositor running at the given display period. xrWaitFrame() throttles the
+    // application to one frame per vsync, and to at most one frame of GPU work queued. The GPU work of a frame starts
+    // when the frame is submitted, and the frame is displayed at the first vsync after it completes.
+    void StartSimulation(XrDuration displayPeriod);
+
+    // Move the gaze of the simulated compositor, and its focus views with it. Angles are in radians, right and up from
+    // the center of the views.
+    void SetSimulatedGaze(float horizontalAngle, float verticalAngle);
+
+    // Set how long xrWaitSwapchainImage() blocks in the simulated compositor, standing for the compositor still reading
+    // the image.
+    void SetSimulatedImageWaitTime(std::chrono::nanoseconds waitTime);
+
+    // Set how long xrEndFrame() blocks in the simulated compositor, standing for the submission work of the runtime.
+    void SetSimulatedEndFrameTime(std::chrono::nanoseconds endFrameTime);
+
+    // Scale the GPU time of each frame by the pixels of the live swapchains, the GPU time being given for the
+    // recommended resolution.
+    void SetResolutionScaledGpuTime(bool enabled);
+
+    // Set the GPU time of the next frame submitted to the simulated compositor.
+    void SetNextFrameGpuTime(std::chrono::nanoseconds gpuTime);
+
+    // The current XrTime of the simulated compositor.
+    XrTime GetSimulatedTime();
+
+    // The vsync when each frame submitted to the simulated compositor was displayed, in submission order.
+    std::vector<XrTime> GetSimulatedDisplayTimes();
+
+    // Forget the display times of the frames submitted so far, so that a long simulation does not grow the memory.
+    void ClearSimulatedDisplayTimes();
+
+    Stats GetStats();
+    SubmittedFrame GetLastSubmittedFrame();
+
+    // Entry points for the layer.
+    XrResult XRAPI_CALL xrGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function);
+    XrResult XRAPI_CALL xrCreateApiLayerInstance(const XrInstanceCreateInfo* info,
+                                                 const XrApiLayerCreateInfo* apiLayerInfo,
+                                                 XrInstance* instance);
+
+} // namespace varjo_foveated::replay::runtime
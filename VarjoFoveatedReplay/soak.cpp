@@ -0,0 +1,246 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "api.h"
+#include "runtime.h"
+#include "soak.h"
+
+namespace {
+
+    using namespace varjo_foveated;
+    using namespace varjo_foveated::replay;
+
+    // A short display period, so that the sessions cycle quickly.
+    constexpr XrDuration SoakDisplayPeriod = 1'000'000;
+
+    // Growth tolerated between the end of the warmup and the last cycle. The handles of the runtime must not grow at
+    // all, while the process may keep a few handles and some heap around (thread pools, heap fragmentation).
+    constexpr int64_t ProcessHandleGrowthTolerance = 16;
+    constexpr int64_t PrivateBytesGrowthTolerance = 1024 * 1024;
+
+    // The resources held at one point of the soak.
+    struct Footprint {
+        int64_t runtimeHandleCount;
+        int64_t processHandleCount;
+        int64_t privateBytes;
+    };
+
+    Footprint Measure() {
+        const runtime::Stats stats = runtime::GetStats();
+
+        Footprint footprint{};
+        footprint.runtimeHandleCount = stats.liveSessionCount + stats.liveSpaceCount + stats.liveSwapchainCount;
+
+        DWORD handleCount = 0;
+        if (GetProcessHandleCount(GetCurrentProcess(), &handleCount)) {
+            footprint.processHandleCount = handleCount;
+        }
+
+        PROCESS_MEMORY_COUNTERS_EX counters{};
+        if (GetProcessMemoryInfo(
+                GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters), sizeof(counters))) {
+            footprint.privateBytes = static_cast<int64_t>(counters.PrivateUsage);
+        }
+        return footprint;
+    }
+
+    void PrintFootprint(uint32_t cycle, const Footprint& footprint) {
+        printf("Cycle %6u: %lld runtime handles, %lld process handles, %.1f MB private\n",
+               cycle,
+               static_cast<long long>(footprint.runtimeHandleCount),
+               static_cast<long long>(footprint.processHandleCount),
+               footprint.privateBytes / (1024.0 * 1024.0));
+    }
+
+    // Create a session, run a few frames in Quad Views, then tear it all down like a well-behaved application.
+    void RunSession(const Api& api,
+                    XrInstance instance,
+                    const std::vector<XrViewConfigurationView>& configurationViews,
+                    uint32_t frameCount) {
+        const uint32_t viewCount = static_cast<uint32_t>(configurationViews.size());
+
+        XrSession session;
+        XrSessionCreateInfo createInfo{XR_TYPE_SESSION_CREATE_INFO};
+        createInfo.systemId = 1;
+        CheckXrResult(api.xrCreateSession(instance, &createInfo, &session), "xrCreateSession");
+
+        XrSpace localSpace;
+        XrReferenceSpaceCreateInfo spaceInfo{XR_TYPE_REFERENCE_SPACE_CREATE_INFO};
+        spaceInfo.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_LOCAL;
+        spaceInfo.poseInReferenceSpace.orientation.w = 1.f;
+        CheckXrResult(api.xrCreateReferenceSpace(session, &spaceInfo, &localSpace), "xrCreateReferenceSpace");
+
+        std::vector<XrSwapchain> swapchains(viewCount, XR_NULL_HANDLE);
+        for (uint32_t i = 0; i < viewCount; i++) {
+            XrSwapchainCreateInfo swapchainInfo{XR_TYPE_SWAPCHAIN_CREATE_INFO};
+            swapchainInfo.usageFlags = XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
+            swapchainInfo.width = configurationViews[i].recommendedImageRectWidth;
+            swapchainInfo.height = configurationViews[i].recommendedImageRectHeight;
+            swapchainInfo.sampleCount = configurationViews[i].recommendedSwapchainSampleCount;
+            swapchainInfo.arraySize = swapchainInfo.faceCount = swapchainInfo.mipCount = 1;
+            CheckXrResult(api.xrCreateSwapchain(session, &swapchainInfo, &swapchains[i]), "xrCreateSwapchain");
+        }
+
+        XrSessionBeginInfo beginInfo{XR_TYPE_SESSION_BEGIN_INFO};
+        beginInfo.primaryViewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO;
+        CheckXrResult(api.xrBeginSession(session, &beginInfo), "xrBeginSession");
+
+        std::vector<XrView> views(viewCount, {XR_TYPE_VIEW});
+        std::vector<XrCompositionLayerProjectionView> projectionViews(viewCount,
+                                                                      {XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW});
+        for (uint32_t frameIndex = 0; frameIndex < frameCount; frameIndex++) {
+            XrFrameState frameState{XR_TYPE_FRAME_STATE};
+            CheckXrResult(api.xrWaitFrame(session, nullptr, &frameState), "xrWaitFrame");
+            CheckXrResult(api.xrBeginFrame(session, nullptr), "xrBeginFrame");
+
+            XrViewLocateInfo locateInfo{XR_TYPE_VIEW_LOCATE_INFO};
+            locateInfo.viewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO;
+            locateInfo.displayTime = frameState.predictedDisplayTime;
+            locateInfo.space = localSpace;
+            XrViewState viewState{XR_TYPE_VIEW_STATE};
+            uint32_t viewCountOutput = 0;
+            CheckXrResult(
+                api.xrLocateViews(session, &locateInfo, &viewState, viewCount, &viewCountOutput, views.data()),
+                "xrLocateViews");
+
+            for (const XrSwapchain swapchain : swapchains) {
+                uint32_t imageIndex;
+                CheckXrResult(api.xrAcquireSwapchainImage(swapchain, nullptr, &imageIndex), "xrAcquireSwapchainImage");
+                XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+                waitInfo.timeout = XR_INFINITE_DURATION;
+                CheckXrResult(api.xrWaitSwapchainImage(swapchain, &waitInfo), "xrWaitSwapchainImage");
+                CheckXrResult(api.xrReleaseSwapchainImage(swapchain, nullptr), "xrReleaseSwapchainImage");
+            }
+
+            for (uint32_t i = 0; i < viewCount; i++) {
+                projectionViews[i].pose = views[i].pose;
+                projectionViews[i].fov = views[i].fov;
+                projectionViews[i].subImage.swapchain = swapchains[i];
+                projectionViews[i].subImage.imageRect.extent.width = configurationViews[i].recommendedImageRectWidth;
+                projectionViews[i].subImage.imageRect.extent.height =
+                    configurationViews[i].recommendedImageRectHeight;
+            }
+            XrCompositionLayerProjection projectionLayer{XR_TYPE_COMPOSITION_LAYER_PROJECTION};
+            projectionLayer.space = localSpace;
+            projectionLayer.viewCount = viewCount;
+            projectionLayer.views = projectionViews.data();
+            const XrCompositionLayerBaseHeader* layers[] = {
+                reinterpret_cast<const XrCompositionLayerBaseHeader*>(&projectionLayer)};
+
+            XrFrameEndInfo frameEndInfo{XR_TYPE_FRAME_END_INFO};
+            frameEndInfo.displayTime = frameState.predictedDisplayTime;
+            frameEndInfo.environmentBlendMode = XR_ENVIRONMENT_BLEND_MODE_OPAQUE;
+            frameEndInfo.layerCount = 1;
+            frameEndInfo.layers = layers;
+            CheckXrResult(api.xrEndFrame(session, &frameEndInfo), "xrEndFrame");
+        }
+
+        CheckXrResult(api.xrEndSession(session), "xrEndSession");
+        for (const XrSwapchain swapchain : swapchains) {
+            CheckXrResult(api.xrDestroySwapchain(swapchain), "xrDestroySwapchain");
+        }
+        CheckXrResult(api.xrDestroySpace(localSpace), "xrDestroySpace");
+        CheckXrResult(api.xrDestroySession(session), "xrDestroySession");
+    }
+
+} // namespace
+
+namespace varjo_foveated::replay {
+
+    bool RunSoak(Layer& layer, const SoakOptions& options) {
+        runtime::Reset(std::chrono::steady_clock::now());
+        runtime::StartSimulation(SoakDisplayPeriod);
+
+        std::vector<const char*> extensions = {XR_VARJO_QUAD_VIEWS_EXTENSION_NAME};
+        const XrInstance instance = layer.CreateInstance(extensions);
+        const Api api = ResolveApi(layer);
+
+        uint32_t viewCount = 0;
+        CheckXrResult(api.xrEnumerateViewConfigurationViews(
+                          instance, 1, XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO, 0, &viewCount, nullptr),
+                      "xrEnumerateViewConfigurationViews");
+        std::vector<XrViewConfigurationView> configurationViews(viewCount, {XR_TYPE_VIEW_CONFIGURATION_VIEW});
+        CheckXrResult(api.xrEnumerateViewConfigurationViews(instance,
+                                                            1,
+                                                            XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO,
+                                                            viewCount,
+                                                            &viewCount,
+                                                            configurationViews.data()),
+                      "xrEnumerateViewConfigurationViews");
+
+        printf("Soak: %u session cycles of %u frames\n", options.cycleCount, options.framesPerCycle);
+
+        // The first cycles populate the caches of the layer and of the process (lazily created threads, heap).
+        const uint32_t warmupCycleCount = std::max(options.cycleCount / 10, 1u);
+        const uint32_t reportInterval = std::max(options.cycleCount / 10, 1u);
+        Footprint baseline{};
+        Footprint current{};
+        const auto startTime = std::chrono::steady_clock::now();
+        for (uint32_t cycle = 1; cycle <= options.cycleCount; cycle++) {
+            RunSession(api, instance, configurationViews, options.framesPerCycle);
+            runtime::ClearSimulatedDisplayTimes();
+
+            if (cycle == warmupCycleCount || cycle % reportInterval == 0 || cycle == options.cycleCount) {
+                current = Measure();
+                if (cycle == warmupCycleCount) {
+                    baseline = current;
+                }
+                PrintFootprint(cycle, current);
+            }
+        }
+        const double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        layer.DestroyInstance();
+
+        const int64_t runtimeHandleGrowth = current.runtimeHandleCount - baseline.runtimeHandleCount;
+        const int64_t processHandleGrowth = current.processHandleCount - baseline.processHandleCount;
+        const int64_t privateBytesGrowth = current.privateBytes - baseline.privateBytes;
+        const uint32_t measuredCycleCount = options.cycleCount - warmupCycleCount;
+        printf("\n%u cycles in %.1fs. Growth over the last %u cycles: %lld runtime handles, %lld process handles, "
+               "%lld bytes private (%.1f bytes per cycle)\n",
+               options.cycleCount,
+               duration,
+               measuredCycleCount,
+               static_cast<long long>(runtimeHandleGrowth),
+               static_cast<long long>(processHandleGrowth),
+               static_cast<long long>(privateBytesGrowth),
+               measuredCycleCount ? static_cast<double>(privateBytesGrowth) / measuredCycleCount : 0.0);
+
+        bool success = true;
+        if (runtimeHandleGrowth > 0) {
+            fprintf(stderr, "The layer leaked %lld runtime handles\n", static_cast<long long>(runtimeHandleGrowth));
+            success = false;
+        }
+        if (processHandleGrowth > ProcessHandleGrowthTolerance) {
+            fprintf(stderr, "The process handles grew by %lld\n", static_cast<long long>(processHandleGrowth));
+            success = false;
+        }
+        if (privateBytesGrowth > PrivateBytesGrowthTolerance) {
+            fprintf(stderr, "The private memory grew by %lld bytes\n", static_cast<long long>(privateBytesGrowth));
+            success = false;
+        }
+        return success;
+    }
+
+} // namespace varjo_foveated::replay
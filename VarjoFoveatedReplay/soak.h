@@ -0,0 +1,40 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "layer_loader.h"
+
+namespace varjo_foveated::replay {
+
+    struct SoakOptions {
+        uint32_t cycleCount{2000};
+        // Frames submitted by each session before it ends.
+        uint32_t framesPerCycle{3};
+    };
+
+    // Create, begin, run, end and destroy sessions in a loop on a single instance of the layer, and check that the
+    // handles held by the stand-in runtime and the handles and private memory of the process do not grow from one cycle
+    // to the next. Returns false if they did.
+    bool RunSoak(Layer& layer, const SoakOptions& options);
+
+} // namespace varjo_foveated::replay
@@ -0,0 +1,56 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+namespace varjo_foveated::replay {
+
+    struct Distribution {
+        double average;
+        double p50;
+        double p99;
+        double max;
+    };
+
+    inline Distribution Summarize(std::vector<double> samples) {
+        Distribution distribution{};
+        if (samples.empty()) {
+            return distribution;
+        }
+
+        std::sort(samples.begin(), samples.end());
+        double total = 0;
+        for (const double sample : samples) {
+            total += sample;
+        }
+        distribution.average = total / samples.size();
+        distribution.p50 = samples[samples.size() / 2];
+        distribution.p99 = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+        distribution.max = samples.back();
+        return distribution;
+    }
+
+    inline double ToMilliseconds(std::chrono::steady_clock::duration duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+} // namespace varjo_foveated::replay
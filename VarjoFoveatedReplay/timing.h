@@ -0,0 +1,43 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+namespace varjo_foveated::replay {
+
+    // The OS scheduler alone is too coarse to reproduce frame timings: sleep until shortly before the deadline, then
+    // spin.
+    inline void SleepUntil(std::chrono::steady_clock::time_point deadline) {
+        const auto coarseDeadline = deadline - 2ms;
+        if (std::chrono::steady_clock::now() < coarseDeadline) {
+            std::this_thread::sleep_until(coarseDeadline);
+        }
+        while (std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+    }
+
+    inline void SleepFor(std::chrono::nanoseconds duration) {
+        SleepUntil(std::chrono::steady_clock::now() + duration);
+    }
+
+} // namespace varjo_foveated::replay
@@ -0,0 +1,175 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "auto_tune.h"
+
+namespace {
+
+    // A step of the ladder, relative to the configured settings.
+    struct Candidate {
+        float peripheral;
+        float focusRegion;
+        float focus;
+    };
+
+    // From the cheapest to the configured settings. The periphery is reduced first, since it is the least noticeable.
+    // Shrinking the focus region also shrinks its resolution, keeping its pixel density.
+    constexpr Candidate Ladder[] = {{0.5f, 0.8f, 0.7f},
+                                    {0.5f, 0.8f, 0.8f},
+                                    {0.5f, 0.8f, 0.9f},
+                                    {0.5f, 0.8f, 1.f},
+                                    {0.5f, 0.9f, 1.f},
+                                    {0.5f, 1.f, 1.f},
+                                    {0.6f, 1.f, 1.f},
+                                    {0.7f, 1.f, 1.f},
+                                    {0.8f, 1.f, 1.f},
+                                    {0.9f, 1.f, 1.f},
+                                    {1.f, 1.f, 1.f}};
+    constexpr int32_t LevelCount = static_cast<int32_t>(std::size(Ladder));
+
+    openxr_api_layer::FoveationSettings Apply(const Candidate& candidate,
+                                              const openxr_api_layer::FoveationSettings& configured) {
+        openxr_api_layer::FoveationSettings settings = configured;
+        settings.peripheralMultiplier *= candidate.peripheral;
+        settings.peripheralPixelDensity *= candidate.peripheral;
+        settings.focusMultiplier *= candidate.focus;
+        settings.focusPixelDensity *= candidate.focus;
+        settings.horizontalFocusScale *= candidate.focusRegion;
+        settings.verticalFocusScale *= candidate.focusRegion;
+        return settings;
+    }
+
+} // namespace
+
+namespace openxr_api_layer {
+
+    AutoTuner::AutoTuner(XrDuration window, float targetFrameRate)
+        : m_window(window), m_targetFrameRate(targetFrameRate), m_passingLevel(-1), m_failingLevel(LevelCount) {
+    }
+
+    void AutoTuner::SetProgress(const std::string& progress) {
+        std::istringstream value(progress);
+        int32_t passingLevel, failingLevel;
+        char separator;
+        value >> passingLevel >> separator >> failingLevel;
+        if (!value || separator != ',' || passingLevel < -1 || passingLevel >= failingLevel ||
+            failingLevel > LevelCount) {
+            throw std::out_of_range("auto_tune_progress");
+        }
+        m_passingLevel = passingLevel;
+        m_failingLevel = failingLevel;
+    }
+
+    std::string AutoTuner::GetProgress() const {
+        return fmt::format("{},{}", m_passingLevel, m_failingLevel);
+    }
+
+    bool AutoTuner::IsComplete() const {
+        return m_failingLevel - m_passingLevel <= 1;
+    }
+
+    uint32_t AutoTuner::GetCandidateLevel() const {
+        // Start with the configured settings, which are likely good enough. Then bisect.
+        if (m_passingLevel < 0 && m_failingLevel == LevelCount) {
+            return LevelCount - 1;
+        }
+        return std::max((m_passingLevel + m_failingLevel + 1) / 2, 0);
+    }
+
+    FoveationSettings AutoTuner::GetCandidateSettings(const FoveationSettings& configured) const {
+        return Apply(Ladder[GetCandidateLevel()], configured);
+    }
+
+    uint32_t AutoTuner::GetBestLevel() const {
+        return std::max(m_passingLevel, 0);
+    }
+
+    FoveationSettings AutoTuner::GetBestSettings(const FoveationSettings& configured) const {
+        return Apply(Ladder[GetBestLevel()], configured);
+    }
+
+    bool AutoTuner::AddFrame(XrTime displayTime, XrDuration displayPeriod) {
+        // The application may see the same runtime frame several times in Turbo Mode.
+        if (m_judged || IsComplete() || displayPeriod <= 0 || displayTime <= m_lastDisplayTime) {
+            return false;
+        }
+
+        if (!m_firstDisplayTime) {
+            m_firstDisplayTime = m_lastDisplayTime = displayTime;
+            return false;
+        }
+        const XrDuration interval = displayTime - m_lastDisplayTime;
+        m_lastDisplayTime = displayTime;
+        if (displayTime - m_firstDisplayTime < m_window / 4) {
+            return false;
+        }
+
+        const double targetFrameRate = m_targetFrameRate > 0 ? m_targetFrameRate : 1e9 / displayPeriod;
+        m_frameCount++;
+        m_measuredTime += interval;
+        if (interval > MissedFrameInterval * 1e9 / targetFrameRate) {
+            m_missedFrameCount++;
+        }
+        if (m_measuredTime < m_window) {
+            return false;
+        }
+
+        const double frameRate = m_frameCount / (m_measuredTime / 1e9);
+        const bool passed = m_missedFrameCount <= m_frameCount * MaxMissedFrameRatio &&
+                            frameRate >= targetFrameRate * MinFrameRateRatio;
+
+        m_judged = true;
+        m_judgedLevel = GetCandidateLevel();
+        m_judgedPassed = passed;
+        m_judgedFrameRate = frameRate;
+        m_judgedTargetFrameRate = targetFrameRate;
+        m_judgedFrameCount = m_frameCount;
+        m_judgedMissedFrameCount = m_missedFrameCount;
+        if (passed) {
+            m_passingLevel = m_judgedLevel;
+        } else {
+            m_failingLevel = m_judgedLevel;
+        }
+
+        return true;
+    }
+
+    void AutoTuner::RestartWindow() {
+        m_firstDisplayTime = m_lastDisplayTime = 0;
+        m_frameCount = m_missedFrameCount = 0;
+        m_measuredTime = 0;
+    }
+
+    std::string AutoTuner::ToString() const {
+        return fmt::format("level {}/{} {}: {:.1f} fps for a target of {:.1f} fps, {} missed frames out of {}",
+                           m_judgedLevel,
+                           LevelCount - 1,
+                           m_judgedPassed ? "passed" : "failed",
+                           m_judgedFrameRate,
+                           m_judgedTargetFrameRate,
+                           m_judgedMissedFrameCount,
+                           m_judgedFrameCount);
+    }
+
+} // namespace openxr_api_layer
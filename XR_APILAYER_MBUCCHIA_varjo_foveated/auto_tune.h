@@ -0,0 +1,103 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+namespace openxr_api_layer {
+
+    // The settings searched by the auto-tuner. The pixel densities are only used when set in the configuration.
+    struct FoveationSettings {
+        float peripheralMultiplier{1.f};
+        float focusMultiplier{1.f};
+        float horizontalFocusScale{1.f};
+        float verticalFocusScale{1.f};
+        float peripheralPixelDensity{0.f};
+        float focusPixelDensity{0.f};
+    };
+
+    // Searches for the highest quality settings sustaining a target frame rate. The candidates form a ladder, from the
+    // configured settings down to a reduced periphery, then a smaller focus region, then a lower focus resolution. The
+    // application only picks up a new resolution when it creates its swapchains, so each run measures one candidate
+    // over a fixed time window, and the search bisects the ladder over the runs. Called on the application's frame
+    // thread only.
+    class AutoTuner {
+      public:
+        AutoTuner(XrDuration window, float targetFrameRate);
+
+        // Restore the progress of the search, as written by GetProgress(). Throws std::out_of_range if invalid.
+        void SetProgress(const std::string& progress);
+        std::string GetProgress() const;
+
+        bool IsComplete() const;
+
+        // The candidate measured by this run.
+        uint32_t GetCandidateLevel() const;
+        FoveationSettings GetCandidateSettings(const FoveationSettings& configured) const;
+
+        // The highest level that passed so far, or the lowest level if none did.
+        uint32_t GetBestLevel() const;
+        FoveationSettings GetBestSettings(const FoveationSettings& configured) const;
+
+        // Account for a frame of the runtime, with the display period targeted by the application. The runtime's
+        // display times reveal the vsyncs missed, even when Turbo Mode lets the application submit more frames than
+        // displayed. Returns true when this frame completes the window and the candidate was judged. Once judged, the
+        // frames are ignored.
+        bool AddFrame(XrTime displayTime, XrDuration displayPeriod);
+
+        // Drop the frames of the window in progress, eg: while the session is not visible.
+        void RestartWindow();
+
+        // The result of the last judged window.
+        std::string ToString() const;
+
+      private:
+        // Frames displayed further apart than this many target periods are counted as missed.
+        static constexpr double MissedFrameInterval = 1.5;
+        // A candidate passes with at most 2% of missed frames, and at least 97% of the target frame rate.
+        static constexpr double MaxMissedFrameRatio = 0.02;
+        static constexpr double MinFrameRateRatio = 0.97;
+
+        const XrDuration m_window;
+        const float m_targetFrameRate;
+
+        // The highest level known to pass (-1 if none), and the lowest level known to fail (the level count if none).
+        int32_t m_passingLevel;
+        int32_t m_failingLevel;
+
+        // The window in progress. It starts after a warmup of a quarter of the window.
+        bool m_judged{false};
+        XrTime m_firstDisplayTime{0};
+        XrTime m_lastDisplayTime{0};
+        uint64_t m_frameCount{0};
+        uint64_t m_missedFrameCount{0};
+        XrDuration m_measuredTime{0};
+
+        // The last judged window.
+        uint32_t m_judgedLevel{0};
+        bool m_judgedPassed{false};
+        double m_judgedFrameRate{0};
+        double m_judgedTargetFrameRate{0};
+        uint64_t m_judgedFrameCount{0};
+        uint64_t m_judgedMissedFrameCount{0};
+    };
+
+} // namespace openxr_api_layer
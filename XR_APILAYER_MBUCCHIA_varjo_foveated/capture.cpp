@@ -0,0 +1,145 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "capture.h"
+#include <log.h>
+
+namespace {
+
+    // Flush the file about once per second, so that a capture remains usable if the application crashes.
+    constexpr uint32_t FlushInterval = 90;
+
+    template <typename T>
+    void Append(std::vector<uint8_t>& buffer, const T& value) {
+        const auto bytes = reinterpret_cast<const uint8_t*>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(value));
+    }
+
+} // namespace
+
+namespace openxr_api_layer {
+
+    using namespace openxr_api_layer::log;
+    using namespace varjo_foveated::capture;
+
+    CaptureWriter::CaptureWriter(const std::filesystem::path& path, const FileHeader& header)
+        : m_startTime(std::chrono::steady_clock::now()), m_fileBuffer(1024 * 1024) {
+        m_file.rdbuf()->pubsetbuf(m_fileBuffer.data(), m_fileBuffer.size());
+        m_file.open(path, std::ios_base::binary | std::ios_base::trunc);
+        if (!m_file.is_open()) {
+            Log(fmt::format("Failed to open capture file '{}'\n", path.string()));
+            return;
+        }
+
+        m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        Log(fmt::format("Capturing to '{}'\n", path.string()));
+    }
+
+    CaptureWriter::~CaptureWriter() {
+        std::unique_lock lock(m_fileMutex);
+
+        if (m_file.is_open()) {
+            m_file.close();
+        }
+    }
+
+    int64_t CaptureWriter::Now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_startTime)
+            .count();
+    }
+
+    void CaptureWriter::Write(RecordType type, int64_t timestamp, XrResult result, const void* payload, size_t size) {
+        RecordHeader header{};
+        header.type = type;
+        header.size = static_cast<uint32_t>(size);
+        header.timestamp = timestamp;
+        header.duration = Now() - timestamp;
+        header.result = result;
+        header.threadId = GetCurrentThreadId();
+
+        std::unique_lock lock(m_fileMutex);
+
+        if (!m_file.is_open()) {
+            return;
+        }
+
+        m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        m_file.write(reinterpret_cast<const char*>(payload), size);
+
+        if (type == RecordType::EndFrame && ++m_framesSinceFlush >= FlushInterval) {
+            m_file.flush();
+            m_framesSinceFlush = 0;
+        }
+    }
+
+    void CaptureWriter::SerializeEndFrame(XrSession session,
+                                          const XrFrameEndInfo* frameEndInfo,
+                                          std::vector<uint8_t>& buffer) {
+        buffer.clear();
+
+        EndFrameRecord frame{};
+        frame.session = (uint64_t)session;
+        frame.displayTime = frameEndInfo->displayTime;
+        frame.environmentBlendMode = frameEndInfo->environmentBlendMode;
+        // Invalid submissions are recorded with the error they failed validation with, and only what can be read.
+        frame.layerCount = frameEndInfo->layers ? frameEndInfo->layerCount : 0;
+        Append(buffer, frame);
+
+        for (uint32_t i = 0; i < frame.layerCount; i++) {
+            const XrCompositionLayerBaseHeader* baseLayer = frameEndInfo->layers[i];
+
+            CompositionLayerRecord layer{};
+            if (!baseLayer) {
+                // Invalid submission: the call failed validation.
+                Append(buffer, layer);
+                continue;
+            }
+
+            layer.type = baseLayer->type;
+            layer.layerFlags = static_cast<uint32_t>(baseLayer->layerFlags);
+            layer.space = (uint64_t)baseLayer->space;
+            if (baseLayer->type == XR_TYPE_COMPOSITION_LAYER_PROJECTION) {
+                const XrCompositionLayerProjection* proj =
+                    reinterpret_cast<const XrCompositionLayerProjection*>(baseLayer);
+
+                layer.viewCount = proj->views ? proj->viewCount : 0;
+                Append(buffer, layer);
+
+                for (uint32_t eye = 0; eye < layer.viewCount; eye++) {
+                    ProjectionViewRecord view{};
+                    view.pose = proj->views[eye].pose;
+                    view.fov = proj->views[eye].fov;
+                    view.swapchain = (uint64_t)proj->views[eye].subImage.swapchain;
+                    view.imageRect = proj->views[eye].subImage.imageRect;
+                    view.imageArrayIndex = proj->views[eye].subImage.imageArrayIndex;
+                    Append(buffer, view);
+                }
+            } else {
+                Append(buffer, layer);
+            }
+        }
+    }
+
+} // namespace openxr_api_layer
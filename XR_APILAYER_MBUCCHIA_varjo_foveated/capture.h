@@ -0,0 +1,69 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <VarjoFoveatedCapture.h>
+
+namespace openxr_api_layer {
+
+    // Serializes the calls intercepted by the layer into a capture file, for replay with VarjoFoveatedReplay. May be
+    // called from any thread.
+    class CaptureWriter {
+      public:
+        CaptureWriter(const std::filesystem::path& path, const varjo_foveated::capture::FileHeader& header);
+        ~CaptureWriter();
+
+        // The timestamp to pass to Write() (nanoseconds since the beginning of the capture).
+        int64_t Now() const;
+
+        // Write a record for a call that started at the given timestamp and is now completing.
+        void Write(varjo_foveated::capture::RecordType type,
+                   int64_t timestamp,
+                   XrResult result,
+                   const void* payload,
+                   size_t size);
+
+        template <typename Payload>
+        void Write(varjo_foveated::capture::RecordType type,
+                   int64_t timestamp,
+                   XrResult result,
+                   const Payload& payload) {
+            Write(type, timestamp, result, &payload, sizeof(payload));
+        }
+
+        // Serialize the payload of an EndFrame record. This must be done before the layer modifies the submitted
+        // views. The buffer is reused from frame to frame.
+        static void SerializeEndFrame(XrSession session,
+                                      const XrFrameEndInfo* frameEndInfo,
+                                      std::vector<uint8_t>& buffer);
+
+      private:
+        const std::chrono::steady_clock::time_point m_startTime;
+
+        std::mutex m_fileMutex;
+        std::ofstream m_file;
+        std::vector<char> m_fileBuffer;
+        uint32_t m_framesSinceFlush{0};
+    };
+
+} // namespace openxr_api_layer
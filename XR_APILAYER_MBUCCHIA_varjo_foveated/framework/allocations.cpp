@@ -0,0 +1,87 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "allocations.h"
+
+namespace {
+
+    // How many frame loop scopes the thread is in.
+    thread_local uint32_t t_frameLoopDepth{0};
+    std::atomic<uint64_t> g_frameLoopAllocationCount{0};
+
+    void CountAllocation() noexcept {
+        if (t_frameLoopDepth) {
+            g_frameLoopAllocationCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+} // namespace
+
+namespace openxr_api_layer::allocations {
+
+    void EnterFrameLoop() noexcept {
+        t_frameLoopDepth++;
+    }
+
+    void LeaveFrameLoop() noexcept {
+        t_frameLoopDepth--;
+    }
+
+    uint64_t GetFrameLoopAllocationCount() noexcept {
+        return g_frameLoopAllocationCount.load(std::memory_order_relaxed);
+    }
+
+} // namespace openxr_api_layer::allocations
+
+#ifdef _DEBUG
+
+// The array, nothrow and sized forms of the standard library all forward to these.
+
+void* operator new(size_t size) {
+    CountAllocation();
+    void* const pointer = malloc(size ? size : 1);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept {
+    free(pointer);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    CountAllocation();
+    void* const pointer = _aligned_malloc(size ? size : 1, static_cast<size_t>(alignment));
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    _aligned_free(pointer);
+}
+
+#endif
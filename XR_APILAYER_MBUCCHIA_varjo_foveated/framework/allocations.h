@@ -0,0 +1,65 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+namespace openxr_api_layer::allocations {
+
+    // Debug builds replace the global operator new of the layer, and count the heap allocations made by the layer from
+    // within its frame loop: the hot path functions (see layer_apis.py) and the layer threads serving them. The frame
+    // loop is expected to not allocate once warmed up, so that an allocator latency spike can never delay a frame.
+    //
+    // The frame loop is tracked per thread, so that the app and the layer threads may be in it concurrently.
+    //
+    // Release builds do not count anything.
+    constexpr bool IsTrackingEnabled =
+#ifdef _DEBUG
+        true;
+#else
+        false;
+#endif
+
+    void EnterFrameLoop() noexcept;
+    void LeaveFrameLoop() noexcept;
+
+    // Keeps the calling thread in the frame loop for the lifetime of the scope, whichever way it is exited. Scopes may
+    // nest.
+    class FrameLoopScope {
+      public:
+        FrameLoopScope() noexcept {
+            EnterFrameLoop();
+        }
+
+        ~FrameLoopScope() {
+            LeaveFrameLoop();
+        }
+
+        FrameLoopScope(const FrameLoopScope&) = delete;
+        FrameLoopScope& operator=(const FrameLoopScope&) = delete;
+    };
+
+    // Allocations made by any thread of the layer while inside the frame loop, since the layer was loaded.
+    uint64_t GetFrameLoopAllocationCount() noexcept;
+
+} // namespace openxr_api_layer::allocations
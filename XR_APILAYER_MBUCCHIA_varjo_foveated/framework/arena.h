@@ -0,0 +1,85 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+namespace openxr_api_layer {
+
+    // A bump allocator over a fixed buffer, to build rewritten copies of the application's structures (and the next
+    // chain entries we insert) without modifying the application's memory nor touching the heap. Everything is
+    // released at once with Reset(). When the buffer is exhausted, the allocations fall back to the heap, so that a
+    // frame larger than expected is still submitted as-is.
+    template <size_t Capacity>
+    class Arena {
+      public:
+        Arena() = default;
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        // The memory is not initialized. Throws std::bad_alloc if the heap fallback fails.
+        template <typename T>
+        T* Allocate(size_t count = 1) {
+            static_assert(std::is_trivially_copyable_v<T>, "Arena only holds plain OpenXR structures");
+            static_assert(alignof(T) <= alignof(std::max_align_t));
+
+            const size_t offset = (m_offset + alignof(T) - 1) & ~(alignof(T) - 1);
+            if (offset > Capacity || count > (Capacity - offset) / sizeof(T)) {
+                const size_t blockSize = (count * sizeof(T) + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+                m_overflow.push_back(std::make_unique<std::max_align_t[]>(std::max(blockSize, size_t(1))));
+                return reinterpret_cast<T*>(m_overflow.back().get());
+            }
+            m_offset = offset + count * sizeof(T);
+            return reinterpret_cast<T*>(m_buffer + offset);
+        }
+
+        template <typename T>
+        T* Copy(const T* source, size_t count = 1) {
+            T* const copy = Allocate<T>(count);
+            if (count) {
+                std::memcpy(copy, source, count * sizeof(T));
+            }
+            return copy;
+        }
+
+        void Reset() noexcept {
+            m_offset = 0;
+            m_overflow.clear();
+        }
+
+        size_t Used() const noexcept {
+            return m_offset;
+        }
+
+        // Whether allocations fell back to the heap since the last Reset().
+        bool HasOverflowed() const noexcept {
+            return !m_overflow.empty();
+        }
+
+      private:
+        alignas(std::max_align_t) uint8_t m_buffer[Capacity];
+        size_t m_offset{0};
+        std::vector<std::unique_ptr<std::max_align_t[]>> m_overflow;
+    };
+
+} // namespace openxr_api_layer
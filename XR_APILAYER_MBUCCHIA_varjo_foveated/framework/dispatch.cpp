@@ -62,10 +62,14 @@ namespace openxr_api_layer {
         // The list of extensions to block.
         std::vector<std::string> blockedExtensions;
 
+        // The list of extensions implemented by the layer itself. They are not forwarded down the chain.
+        const std::vector<std::string> layerExtensions = {XR_MBUCCHIA_VARJO_FOVEATED_STATS_EXTENSION_NAME};
+
         // Dump the extensions requested by the app.
         std::vector<std::string> newEnabledExtensions;
         std::vector<const char*> newEnabledExtensionNames;
         bool hasVarjoQuad = false;
+        bool hasPerformanceCounterConversion = false;
         for (uint32_t i = 0; i < instanceCreateInfo->enabledExtensionCount; i++) {
             const std::string_view ext(instanceCreateInfo->enabledExtensionNames[i]);
             TraceLoggingWrite(g_traceProvider,
@@ -73,7 +77,11 @@ namespace openxr_api_layer {
                               TLArg(ext.data(), "ExtensionName"),
                               TLArg("App", "Request"));
 
-            if (std::find(blockedExtensions.cbegin(), blockedExtensions.cend(), ext) == blockedExtensions.cend()) {
+            if (std::find(layerExtensions.cbegin(), layerExtensions.cend(), ext) != layerExtensions.cend()) {
+                Log(fmt::format("Requested layer extension: {}\n", ext));
+                newEnabledExtensions.push_back(ext.data());
+            } else if (std::find(blockedExtensions.cbegin(), blockedExtensions.cend(), ext) ==
+                       blockedExtensions.cend()) {
                 Log(fmt::format("Requested extension: {}\n", ext));
                 newEnabledExtensions.push_back(ext.data());
                 newEnabledExtensionNames.push_back(ext.data());
@@ -83,6 +91,8 @@ namespace openxr_api_layer {
 
             if (ext == XR_VARJO_QUAD_VIEWS_EXTENSION_NAME) {
                 hasVarjoQuad = true;
+            } else if (ext == XR_KHR_WIN32_CONVERT_PERFORMANCE_COUNTER_TIME_EXTENSION_NAME) {
+                hasPerformanceCounterConversion = true;
             }
         }
 
@@ -90,6 +100,11 @@ namespace openxr_api_layer {
         std::vector<std::string> implicitExtensions;
         if (hasVarjoQuad) {
             implicitExtensions.push_back(XR_VARJO_FOVEATED_RENDERING_EXTENSION_NAME);
+
+            // To place the layer's own timestamps on the runtime's timeline.
+            if (!hasPerformanceCounterConversion) {
+                implicitExtensions.push_back(XR_KHR_WIN32_CONVERT_PERFORMANCE_COUNTER_TIME_EXTENSION_NAME);
+            }
         }
 
         // Only request implicit extensions that are supported.
@@ -172,7 +187,7 @@ namespace openxr_api_layer {
             // Forward the xrCreateInstance() call to the layer.
             try {
                 result = openxr_api_layer::GetInstance()->xrCreateInstance(instanceCreateInfo);
-            } catch (std::runtime_error exc) {
+            } catch (const std::exception& exc) {
                 TraceLoggingWrite(g_traceProvider, "xrCreateInstance_Error", TLArg(exc.what(), "Error"));
                 ErrorLog(fmt::format("xrCreateInstance: {}\n", exc.what()));
                 result = XR_ERROR_RUNTIME_FAILURE;
@@ -205,8 +220,9 @@ namespace openxr_api_layer {
             result = openxr_api_layer::GetInstance()->xrDestroyInstance(instance);
             if (XR_SUCCEEDED(result)) {
                 openxr_api_layer::ResetInstance();
+                latency::DumpAndReset();
             }
-        } catch (std::runtime_error exc) {
+        } catch (const std::exception& exc) {
             TraceLoggingWrite(g_traceProvider, "xrDestroyInstance_Error", TLArg(exc.what(), "Error"));
             ErrorLog(fmt::format("xrDestroyInstance: {}\n", exc.what()));
             result = XR_ERROR_RUNTIME_FAILURE;
@@ -227,7 +243,7 @@ namespace openxr_api_layer {
         XrResult result;
         try {
             result = openxr_api_layer::GetInstance()->xrGetInstanceProcAddr(instance, name, function);
-        } catch (std::runtime_error exc) {
+        } catch (const std::exception& exc) {
             TraceLoggingWrite(g_traceProvider, "xrGetInstanceProcAddr_Error", TLArg(exc.what(), "Error"));
             ErrorLog(fmt::format("xrGetInstanceProcAddr: {}\n", exc.what()));
             result = XR_ERROR_RUNTIME_FAILURE;
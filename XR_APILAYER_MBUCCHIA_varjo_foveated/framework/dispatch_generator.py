@@ -54,6 +54,18 @@ if 'xrGetInstanceProcAddr' in layer_apis.override_functions:
 if 'xrGetInstanceProcAddr' in layer_apis.requested_functions:
     raise Exception("xrGetInstanceProcAddr() cannot be specified in requested_functions. Use the m_xrGetInstanceProcAddr() class member.")
 
+# Must match latency::MaxApiCount.
+if len(set(layer_apis.override_functions + layer_apis.requested_functions + ['xrDestroyInstance'])) > 64:
+    raise Exception("Too many functions in override_functions and requested_functions to track their latency")
+
+# A baseline build for the microbenchmark of VarjoFoveatedReplay: every hook goes through the generic wrappers.
+if os.environ.get('VARJO_FOVEATED_NO_HOT_PATH') == '1':
+    layer_apis.hot_path_functions = []
+
+for function in layer_apis.hot_path_functions:
+    if function not in layer_apis.override_functions:
+        raise Exception(f"{function}() is specified in hot_path_functions but not in override_functions")
+
 
 class DispatchGenOutputGenerator(AutomaticSourceOutputGenerator):
     '''Common generator utilities and formatting.'''
@@ -128,6 +140,7 @@ namespace openxr_api_layer
         generated_wrappers = self.genWrappers()
         generated_get_instance_proc_addr = self.genGetInstanceProcAddr()
         generated_create_instance = self.genCreateInstance()
+        generated_overridden_functions = self.genOverriddenFunctions()
 
         postamble = '''} // namespace openxr_api_layer
 '''
@@ -142,6 +155,9 @@ namespace openxr_api_layer
 	// Auto-generated create instance handler.
 {generated_create_instance}
 
+	// Auto-generated list of overridden APIs.
+{generated_overridden_functions}
+
 {postamble}'''
 
         write(contents, file=self.outFile)
@@ -155,18 +171,27 @@ namespace openxr_api_layer
                 parameters_list = self.makeParametersList(cur_cmd)
                 arguments_list = self.makeArgumentsList(cur_cmd)
 
-                if cur_cmd.return_type is not None:
+                if cur_cmd.name in layer_apis.hot_path_functions:
+                    return_type = 'XrResult' if cur_cmd.return_type is not None else 'void'
+                    generated += f'''
+	// Implemented in dispatch.hot.gen.h.
+	{return_type} XRAPI_CALL {cur_cmd.name}({parameters_list}) noexcept;
+'''
+                elif cur_cmd.return_type is not None:
                     generated += f'''
 	XrResult XRAPI_CALL {cur_cmd.name}({parameters_list})
 	{{
 		TraceLoggingWrite(g_traceProvider, "{cur_cmd.name}");
 
+		static const uint32_t api = latency::RegisterApi("{cur_cmd.name}");
+		const latency::HookTimer timer(api);
+
 		XrResult result;
 		try
 		{{
 			result = openxr_api_layer::GetInstance()->{cur_cmd.name}({arguments_list});
 		}}
-		catch (std::exception exc)
+		catch (const std::exception& exc)
 		{{
 			TraceLoggingWrite(g_traceProvider, "{cur_cmd.name}_Error", TLArg(exc.what(), "Error"));
 			ErrorLog(fmt::format("{cur_cmd.name}: {{}}\\n", exc.what()));
@@ -176,6 +201,7 @@ namespace openxr_api_layer
 		TraceLoggingWrite(g_traceProvider, "{cur_cmd.name}_Result", TLArg(xr::ToCString(result), "Result"));
 		if (XR_FAILED(result)) {{
 			ErrorLog(fmt::format("{cur_cmd.name} failed with {{}}\\n", xr::ToCString(result)));
+			recorder::RecordError(api, result);
 		}}
 
 		return result;
@@ -187,11 +213,14 @@ namespace openxr_api_layer
 	{{
 		TraceLoggingWrite(g_traceProvider, "{cur_cmd.name}");
 
+		static const uint32_t api = latency::RegisterApi("{cur_cmd.name}");
+		const latency::HookTimer timer(api);
+
 		try
 		{{
 			openxr_api_layer::GetInstance()->{cur_cmd.name}({arguments_list});
 		}}
-		catch (std::runtime_error exc)
+		catch (const std::exception& exc)
 		{{
 			TraceLoggingWrite(g_traceProvider, "{cur_cmd.name}_Error", TLArg(exc.what(), "Error"));
 			ErrorLog(fmt::format("{cur_cmd.name}: {{}}\\n", exc.what()));
@@ -228,6 +257,24 @@ namespace openxr_api_layer
 
         return generated
 
+    def genOverriddenFunctions(self):
+        generated = '''	const std::vector<std::string>& OpenXrApi::GetOverriddenFunctions() const
+	{
+		static const std::vector<std::string> functions = {
+'''
+
+        for cur_cmd in self.core_commands + self.ext_commands:
+            if cur_cmd.name in layer_apis.override_functions:
+                generated += f'''			"{cur_cmd.name}",
+'''
+
+        generated += '''		};
+
+		return functions;
+	}'''
+
+        return generated
+
     def genGetInstanceProcAddr(self):
         generated = '''	XrResult OpenXrApi::xrGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function)
 	{
@@ -276,6 +323,8 @@ class DispatchGenHOutputGenerator(DispatchGenOutputGenerator):
         DispatchGenOutputGenerator.beginFile(self, genOpts)
         preamble = '''#pragma once
 
+#include "latency.h"
+
 namespace openxr_api_layer
 {
 
@@ -320,6 +369,9 @@ namespace openxr_api_layer
 			m_grantedExtensions = grantedExtensions;
 		}
 
+		// The list of APIs listed in override_functions.
+		const std::vector<std::string>& GetOverriddenFunctions() const;
+
 		// Specially-handled by the auto-generated code.
 		virtual XrResult xrGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function);
 		virtual XrResult xrCreateInstance(const XrInstanceCreateInfo* createInfo);
@@ -361,6 +413,9 @@ namespace openxr_api_layer
                     generated += f'''
 		virtual XrResult {cur_cmd.name}({parameters_list})
 		{{
+			static const uint32_t api = latency::RegisterApi("{cur_cmd.name}");
+			const latency::RuntimeTimer timer(api);
+
 			return m_{cur_cmd.name}({arguments_list});
 		}}
 '''
@@ -368,6 +423,9 @@ namespace openxr_api_layer
                     generated += f'''
 		virtual void {cur_cmd.name}({parameters_list})
 		{{
+			static const uint32_t api = latency::RegisterApi("{cur_cmd.name}");
+			const latency::RuntimeTimer timer(api);
+
 			m_{cur_cmd.name}({arguments_list});
 		}}
 '''
@@ -378,6 +436,101 @@ namespace openxr_api_layer
                 
         return generated
 
+class DispatchGenHotOutputGenerator(DispatchGenOutputGenerator):
+    '''Generator for dispatch.hot.gen.h.'''
+    def beginFile(self, genOpts):
+        DispatchGenOutputGenerator.beginFile(self, genOpts)
+        preamble = '''#pragma once
+
+// This file must be included by the layer implementation, after the definition of its g_instance singleton.
+
+namespace openxr_api_layer
+{'''
+        write(preamble, file=self.outFile)
+
+    def endFile(self):
+        generated_wrappers = self.genWrappers()
+
+        postamble = '''} // namespace openxr_api_layer
+'''
+
+        contents = f'''
+	// Auto-generated wrappers for the hot path APIs.
+{generated_wrappers}
+
+{postamble}'''
+
+        write(contents, file=self.outFile)
+        DispatchGenOutputGenerator.endFile(self)
+
+    def genWrappers(self):
+        generated = ''
+
+        for cur_cmd in self.core_commands + self.ext_commands:
+            if cur_cmd.name in layer_apis.hot_path_functions:
+                parameters_list = self.makeParametersList(cur_cmd)
+                arguments_list = self.makeArgumentsList(cur_cmd)
+
+                # Devirtualized call into the final layer class. The hooks report their errors with an error code, but
+                # the exception handler stays as a safety net (it costs nothing until an exception is thrown). The hot
+                # path is the frame loop, whose heap allocations are counted in Debug builds.
+                if cur_cmd.return_type is not None:
+                    generated += f'''
+	XrResult XRAPI_CALL {cur_cmd.name}({parameters_list}) noexcept
+	{{
+		TraceLoggingWrite(g_traceProvider, "{cur_cmd.name}");
+
+		static const uint32_t api = latency::RegisterApi("{cur_cmd.name}");
+		const latency::HookTimer timer(api);
+
+		XrResult result;
+		try
+		{{
+			const allocations::FrameLoopScope frameLoopScope;
+			result = g_instance->{layer_apis.hot_path_class}::{cur_cmd.name}({arguments_list});
+		}}
+		catch (const std::exception& exc)
+		{{
+			TraceLoggingWrite(g_traceProvider, "{cur_cmd.name}_Error", TLArg(exc.what(), "Error"));
+			ErrorLog("{cur_cmd.name}: %s\\n", exc.what());
+			result = XR_ERROR_RUNTIME_FAILURE;
+		}}
+
+		TraceLoggingWrite(g_traceProvider, "{cur_cmd.name}_Result", TLArg(xr::ToCString(result), "Result"));
+		if (XR_FAILED(result)) {{
+			ErrorLog("{cur_cmd.name} failed with %s\\n", xr::ToCString(result));
+			recorder::RecordError(api, result);
+		}}
+
+		return result;
+	}}
+'''
+                else:
+                    generated += f'''
+	void XRAPI_CALL {cur_cmd.name}({parameters_list}) noexcept
+	{{
+		TraceLoggingWrite(g_traceProvider, "{cur_cmd.name}");
+
+		static const uint32_t api = latency::RegisterApi("{cur_cmd.name}");
+		const latency::HookTimer timer(api);
+
+		try
+		{{
+			const allocations::FrameLoopScope frameLoopScope;
+			g_instance->{layer_apis.hot_path_class}::{cur_cmd.name}({arguments_list});
+		}}
+		catch (const std::exception& exc)
+		{{
+			TraceLoggingWrite(g_traceProvider, "{cur_cmd.name}_Error", TLArg(exc.what(), "Error"));
+			ErrorLog("{cur_cmd.name}: %s\\n", exc.what());
+		}}
+
+		TraceLoggingWrite(g_traceProvider, "{cur_cmd.name}_Complete");
+	}}
+'''
+
+        return generated
+
 def makeREstring(strings, default=None):
     """Turn a list of strings into a regexp string matching exactly those strings."""
     if strings or default is None:
@@ -417,3 +570,16 @@ if __name__ == '__main__':
             addExtensions     = None,
             removeExtensions  = None,
             emitExtensions    = extensionsPat))
+
+    registry.setGenerator(DispatchGenHotOutputGenerator(diagFile=None))
+    registry.apiGen(AutomaticSourceGeneratorOptions(conventions       = conventions,
+            filename          = 'dispatch.hot.gen.h',
+            directory         = cur_dir,
+            apiname           = 'openxr',
+            profile           = None,
+            versions          = featuresPat,
+            emitversions      = featuresPat,
+            defaultExtensions = 'openxr',
+            addExtensions     = None,
+            removeExtensions  = None,
+            emitExtensions    = extensionsPat))
@@ -0,0 +1,260 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "latency.h"
+#include "log.h"
+
+namespace {
+
+    using namespace openxr_api_layer::latency;
+    using namespace openxr_api_layer::log;
+
+    struct Histogram {
+        std::atomic<uint64_t> buckets[BucketCount];
+        std::atomic<uint64_t> count;
+        std::atomic<int64_t> totalNs;
+        std::atomic<int64_t> maxNs;
+    };
+
+    // Each thread only writes to its own shard, so there is no contention when recording.
+    struct Shard {
+        Histogram layer[MaxApiCount];
+        Histogram runtime[MaxApiCount];
+        // Cleared when the thread exits, so that the shard (and the timings it holds until the next dump) is reused by
+        // the next new thread instead of running out of shards with each short-lived thread.
+        std::atomic<bool> inUse{true};
+    };
+
+    std::mutex g_apisMutex;
+    const char* g_apiNames[MaxApiCount]{};
+    uint32_t g_apiCount = 0;
+
+    std::atomic<bool> g_enabled{true};
+    std::atomic<Shard*> g_shards[MaxShardCount]{};
+    std::atomic<uint32_t> g_shardCount{0};
+    thread_local Shard* t_shard = nullptr;
+    thread_local bool t_registered = false;
+
+    // Releases the shard of the thread when it exits.
+    struct ShardOwner {
+        ~ShardOwner() {
+            if (t_shard) {
+                t_shard->inUse.store(false, std::memory_order_release);
+            }
+        }
+    };
+    thread_local ShardOwner t_owner;
+
+    Shard* GetShard() noexcept {
+        if (!t_registered) {
+            t_registered = true;
+            (void)t_owner;
+
+            // Reuse the shard of an exited thread. Its timings are kept until the next dump.
+            const uint32_t shardCount = std::min(g_shardCount.load(), MaxShardCount);
+            for (uint32_t i = 0; i < shardCount && !t_shard; i++) {
+                Shard* const shard = g_shards[i].load(std::memory_order_acquire);
+                bool inUse = false;
+                if (shard && shard->inUse.compare_exchange_strong(inUse, true, std::memory_order_acquire)) {
+                    t_shard = shard;
+                }
+            }
+
+            if (!t_shard) {
+                const uint32_t index = g_shardCount.fetch_add(1);
+                if (index < MaxShardCount) {
+                    t_shard = new (std::nothrow) Shard{};
+                    g_shards[index].store(t_shard, std::memory_order_release);
+                }
+            }
+        }
+        return t_shard;
+    }
+
+    uint32_t GetBucket(int64_t durationNs) {
+        uint32_t bucket = 0;
+        uint64_t value = static_cast<uint64_t>(durationNs) >> 7;
+        while (value && bucket < BucketCount - 1) {
+            value >>= 1;
+            bucket++;
+        }
+        return bucket;
+    }
+
+    // Only the owning thread writes, so we can avoid the (more expensive) atomic read-modify-write operations.
+    template <typename T>
+    void Increment(std::atomic<T>& value, T amount) {
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    void Record(Histogram& histogram, int64_t durationNs) {
+        durationNs = std::max(durationNs, int64_t(0));
+        Increment(histogram.buckets[GetBucket(durationNs)], uint64_t(1));
+        Increment(histogram.count, uint64_t(1));
+        Increment(histogram.totalNs, durationNs);
+        if (durationNs > histogram.maxNs.load(std::memory_order_relaxed)) {
+            histogram.maxNs.store(durationNs, std::memory_order_relaxed);
+        }
+    }
+
+    struct MergedHistogram {
+        uint64_t buckets[BucketCount]{};
+        uint64_t count{0};
+        int64_t totalNs{0};
+        int64_t maxNs{0};
+
+        void Merge(Histogram& histogram) {
+            for (uint32_t i = 0; i < BucketCount; i++) {
+                buckets[i] += histogram.buckets[i].exchange(0, std::memory_order_relaxed);
+            }
+            count += histogram.count.exchange(0, std::memory_order_relaxed);
+            totalNs += histogram.totalNs.exchange(0, std::memory_order_relaxed);
+            maxNs = std::max(maxNs, histogram.maxNs.exchange(0, std::memory_order_relaxed));
+        }
+
+        // Returns the upper bound of the bucket containing the requested percentile.
+        double GetPercentileUs(double percentile) const {
+            const uint64_t threshold = static_cast<uint64_t>(std::ceil(count * percentile));
+            uint64_t cumulated = 0;
+            for (uint32_t i = 0; i < BucketCount; i++) {
+                cumulated += buckets[i];
+                if (cumulated >= threshold) {
+                    return (uint64_t(1) << (i + 7)) / 1000.0;
+                }
+            }
+            return maxNs / 1000.0;
+        }
+
+        std::string ToString() const {
+            if (!count) {
+                return "n=0";
+            }
+            return fmt::format("n={} avg={:.1f}us p50<{:.1f}us p90<{:.1f}us p99<{:.1f}us max={:.1f}us",
+                               count,
+                               totalNs / 1000.0 / count,
+                               GetPercentileUs(0.5),
+                               GetPercentileUs(0.9),
+                               GetPercentileUs(0.99),
+                               maxNs / 1000.0);
+        }
+    };
+
+} // namespace
+
+namespace openxr_api_layer::latency {
+
+    thread_local int64_t t_runtimeTimeNs = 0;
+
+    uint32_t RegisterApi(const char* name) {
+        std::unique_lock lock(g_apisMutex);
+
+        for (uint32_t i = 0; i < g_apiCount; i++) {
+            if (!strcmp(g_apiNames[i], name)) {
+                return i;
+            }
+        }
+
+        // The dispatch generator guarantees that we never go over the limit.
+        if (g_apiCount == MaxApiCount) {
+            return MaxApiCount - 1;
+        }
+
+        g_apiNames[g_apiCount] = name;
+        return g_apiCount++;
+    }
+
+    const char* GetApiName(uint32_t api) {
+        std::unique_lock lock(g_apisMutex);
+
+        return api < g_apiCount ? g_apiNames[api] : "?";
+    }
+
+    void SetEnabled(bool enabled) noexcept {
+        g_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    void RecordLayerTime(uint32_t api, int64_t durationNs) noexcept {
+        if (!g_enabled.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        Shard* const shard = GetShard();
+        if (shard) {
+            Record(shard->layer[api], durationNs);
+        }
+    }
+
+    void RecordRuntimeTime(uint32_t api, int64_t durationNs) noexcept {
+        if (!g_enabled.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        Shard* const shard = GetShard();
+        if (shard) {
+            Record(shard->runtime[api], durationNs);
+        }
+    }
+
+    void DumpAndReset() {
+        std::unique_lock lock(g_apisMutex);
+
+        if (!g_enabled.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        const uint32_t shardCount = std::min(g_shardCount.load(), MaxShardCount);
+
+        Log("Latency histograms (layer time excludes calls to the runtime):\n");
+        for (uint32_t api = 0; api < g_apiCount; api++) {
+            MergedHistogram layer;
+            MergedHistogram runtime;
+            for (uint32_t i = 0; i < shardCount; i++) {
+                Shard* const shard = g_shards[i].load(std::memory_order_acquire);
+                if (shard) {
+                    layer.Merge(shard->layer[api]);
+                    runtime.Merge(shard->runtime[api]);
+                }
+            }
+
+            if (!layer.count && !runtime.count) {
+                continue;
+            }
+
+            TraceLoggingWrite(g_traceProvider,
+                              "LatencyHistogram",
+                              TLArg(g_apiNames[api], "Api"),
+                              TLArg(layer.count, "LayerCount"),
+                              TLArg(layer.totalNs, "LayerTotalNs"),
+                              TLArg(layer.maxNs, "LayerMaxNs"),
+                              TLArg(runtime.count, "RuntimeCount"),
+                              TLArg(runtime.totalNs, "RuntimeTotalNs"),
+                              TLArg(runtime.maxNs, "RuntimeMaxNs"));
+            Log(fmt::format("  {}:\n    layer:   {}\n    runtime: {}\n",
+                            g_apiNames[api],
+                            layer.ToString(),
+                            runtime.ToString()));
+        }
+    }
+
+} // namespace openxr_api_layer::latency
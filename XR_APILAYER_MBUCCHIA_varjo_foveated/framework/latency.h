@@ -0,0 +1,103 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+#include "recorder.h"
+
+namespace openxr_api_layer::latency {
+
+    // Histograms use log2 buckets: bucket 0 counts durations below 128ns, and bucket i counts durations within
+    // [2^(i+6), 2^(i+7)) ns. The last bucket also counts anything longer.
+    constexpr uint32_t BucketCount = 32;
+
+    // Upper bound on the number of distinct APIs being timed (checked by the dispatch generator).
+    constexpr uint32_t MaxApiCount = 64;
+
+    // Upper bound on the number of threads recording timings at once. Additional threads are not recorded.
+    constexpr uint32_t MaxShardCount = 64;
+
+    // Return a unique identifier for an API name. Meant to be cached in a function-local static.
+    uint32_t RegisterApi(const char* name);
+
+    // Return the name of an API registered with RegisterApi().
+    const char* GetApiName(uint32_t api);
+
+    // Turn the histograms on or off (on by default). The hooks are still timed for the flight recorder.
+    void SetEnabled(bool enabled) noexcept;
+
+    // Record a duration into the calling thread's shard.
+    void RecordLayerTime(uint32_t api, int64_t durationNs) noexcept;
+    void RecordRuntimeTime(uint32_t api, int64_t durationNs) noexcept;
+
+    // Merge all the shards, log the result, then clear all the histograms.
+    void DumpAndReset();
+
+    // Time spent in runtime calls since the innermost hook was entered, on the current thread.
+    extern thread_local int64_t t_runtimeTimeNs;
+
+    // Measures the time spent in a hook and attributes it to the runtime (see RuntimeTimer) or to the layer.
+    class HookTimer {
+      public:
+        explicit HookTimer(uint32_t api) noexcept
+            : m_api(api), m_outerRuntimeTimeNs(t_runtimeTimeNs), m_start(std::chrono::steady_clock::now()) {
+            t_runtimeTimeNs = 0;
+            recorder::EnterHook(m_api, m_start.time_since_epoch().count());
+        }
+
+        ~HookTimer() {
+            const int64_t totalNs = (std::chrono::steady_clock::now() - m_start).count();
+            RecordLayerTime(m_api, totalNs - t_runtimeTimeNs);
+            recorder::LeaveHook(m_api, m_start.time_since_epoch().count(), totalNs);
+
+            // Whatever our caller is, it is not responsible for the time we spent.
+            t_runtimeTimeNs = m_outerRuntimeTimeNs + totalNs;
+        }
+
+      private:
+        const uint32_t m_api;
+        const int64_t m_outerRuntimeTimeNs;
+        const std::chrono::steady_clock::time_point m_start;
+    };
+
+    // Measures the time spent in a call to the next layer or the runtime.
+    class RuntimeTimer {
+      public:
+        explicit RuntimeTimer(uint32_t api) noexcept : m_api(api), m_start(std::chrono::steady_clock::now()) {
+            recorder::EnterRuntime(m_api, m_start.time_since_epoch().count());
+        }
+
+        ~RuntimeTimer() {
+            const int64_t durationNs = (std::chrono::steady_clock::now() - m_start).count();
+            recorder::LeaveRuntime();
+            RecordRuntimeTime(m_api, durationNs);
+            t_runtimeTimeNs += durationNs;
+        }
+
+      private:
+        const uint32_t m_api;
+        const std::chrono::steady_clock::time_point m_start;
+    };
+
+} // namespace openxr_api_layer::latency
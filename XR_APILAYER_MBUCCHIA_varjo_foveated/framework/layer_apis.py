@@ -4,7 +4,9 @@ override_functions = [
     "xrCreateSwapchain",
     "xrDestroySwapchain",
     "xrBeginSession",
+    "xrEndSession",
     "xrDestroySession",
+    "xrPollEvent",
     "xrLocateViews",
     "xrWaitFrame",
     "xrBeginFrame",
@@ -14,6 +16,23 @@ override_functions = [
     "xrReleaseSwapchainImage"
 ]
 
+# The list of OpenXR functions (from override_functions) that are invoked every frame.
+# Their wrappers are generated in dispatch.hot.gen.h, which must be included by the layer implementation after the
+# definition of the final layer class (hot_path_class) and its g_instance singleton. These wrappers are noexcept and
+# call the layer directly. The corresponding methods should report errors with result codes; an exception that escapes
+# them is still caught and turned into XR_ERROR_RUNTIME_FAILURE, like for the other wrappers.
+hot_path_functions = [
+    "xrPollEvent",
+    "xrLocateViews",
+    "xrWaitFrame",
+    "xrBeginFrame",
+    "xrEndFrame",
+    "xrAcquireSwapchainImage",
+    "xrWaitSwapchainImage",
+    "xrReleaseSwapchainImage"
+]
+hot_path_class = "OpenXrLayer"
+
 # The list of OpenXR functions our layer will use from the runtime.
 # Might repeat entries from override_functions above.
 requested_functions = [
@@ -22,8 +41,10 @@ requested_functions = [
     "xrGetSystemProperties",
     "xrGetViewConfigurationProperties",
     "xrCreateReferenceSpace",
-    "xrLocateSpace"
+    "xrDestroySpace",
+    "xrLocateSpace",
+    "xrConvertWin32PerformanceCounterToTimeKHR"
 ]
 
 # The list of OpenXR extensions our layer will either override or use.
-extensions = []
+extensions = ["XR_KHR_win32_convert_performance_counter_time"]
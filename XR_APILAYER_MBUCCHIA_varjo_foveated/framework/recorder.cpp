@@ -0,0 +1,427 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "latency.h"
+#include "log.h"
+#include "recorder.h"
+#include "ring.h"
+
+namespace {
+
+    using namespace openxr_api_layer;
+    using namespace openxr_api_layer::recorder;
+    using namespace openxr_api_layer::log;
+
+    // An error repeating every frame must not fill up the disk.
+    constexpr auto k_minDumpInterval = 10s;
+    constexpr uint32_t k_maxDumps = 16;
+
+    struct Event {
+        int64_t timestamp;
+        int64_t value;
+        uint32_t api;
+        EventType type;
+    };
+
+    // Each thread only writes to its own state, so there is no contention when recording. The watchdog reads it without
+    // locking.
+    struct ThreadState {
+        Ring<Event, EventCapacity> events;
+        std::atomic<DWORD> threadId{0};
+        // Cleared when the thread exits, so that the state is reused by the next new thread instead of growing the
+        // memory with each short-lived thread (e.g. the gaze sampler of each session).
+        std::atomic<bool> inUse{true};
+
+        // Start (ns) of the outermost hook and of the runtime call currently executing, 0 if none.
+        std::atomic<int64_t> hookStart{0};
+        std::atomic<uint32_t> hookApi{0};
+        std::atomic<int64_t> runtimeStart{0};
+        std::atomic<uint32_t> runtimeApi{0};
+
+        // Only accessed by the owning thread.
+        uint32_t hookDepth{0};
+
+        // Only accessed by the watchdog, so that each stall is reported once.
+        int64_t reportedStart{0};
+    };
+
+    // If the layer is unloaded without xrDestroyInstance(), the process is exiting and the thread is already gone.
+    struct WatchdogThread : std::thread {
+        ~WatchdogThread() {
+            if (joinable()) {
+                detach();
+            }
+        }
+        WatchdogThread& operator=(std::thread&& other) {
+            std::thread::operator=(std::move(other));
+            return *this;
+        }
+    };
+
+    std::atomic<ThreadState*> g_threads[MaxThreadCount]{};
+    std::atomic<uint32_t> g_threadCount{0};
+    thread_local ThreadState* t_state = nullptr;
+    thread_local bool t_registered = false;
+
+    // Releases the state of the thread when it exits.
+    struct ThreadStateOwner {
+        ~ThreadStateOwner() {
+            if (t_state) {
+                t_state->inUse.store(false, std::memory_order_release);
+            }
+        }
+    };
+    thread_local ThreadStateOwner t_owner;
+
+    std::atomic<bool> g_recording{false};
+    std::atomic<XrDuration> g_displayPeriod{0};
+
+    // Error reported by RecordError(), for the watchdog to dump.
+    std::atomic<bool> g_dumpRequested{false};
+    std::atomic<uint32_t> g_errorApi{0};
+    std::atomic<XrResult> g_errorResult{XR_SUCCESS};
+
+    std::mutex g_watchdogMutex;
+    std::condition_variable g_watchdogWakeup;
+    bool g_stopWatchdog{false};
+    WatchdogThread g_watchdog;
+    std::filesystem::path g_directory;
+    uint32_t g_stallPeriods{0};
+
+    int64_t Now() noexcept {
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+
+    ThreadState* GetThreadState() noexcept {
+        if (!t_registered) {
+            t_registered = true;
+            (void)t_owner;
+
+            // Reuse the state of an exited thread, dropping its events.
+            const uint32_t threadCount = std::min(g_threadCount.load(), MaxThreadCount);
+            for (uint32_t i = 0; i < threadCount && !t_state; i++) {
+                ThreadState* const state = g_threads[i].load(std::memory_order_acquire);
+                bool inUse = false;
+                if (state && state->inUse.compare_exchange_strong(inUse, true, std::memory_order_acquire)) {
+                    state->events.Clear();
+                    state->hookDepth = 0;
+                    state->threadId.store(GetCurrentThreadId(), std::memory_order_relaxed);
+                    t_state = state;
+                }
+            }
+
+            if (!t_state) {
+                const uint32_t index = g_threadCount.fetch_add(1);
+                if (index < MaxThreadCount) {
+                    t_state = new (std::nothrow) ThreadState{};
+                    if (t_state) {
+                        t_state->threadId = GetCurrentThreadId();
+                    }
+                    g_threads[index].store(t_state, std::memory_order_release);
+                }
+            }
+        }
+        return t_state;
+    }
+
+    const char* GetTypeName(EventType type) {
+        switch (type) {
+        case EventType::Hook:
+            return "hook";
+        case EventType::Error:
+            return "error";
+        case EventType::WaitedDisplayTime:
+            return "waited_display_time";
+        case EventType::SubmittedDisplayTime:
+            return "submitted_display_time";
+        case EventType::TurboState:
+            return "turbo_state";
+        case EventType::Foveation:
+            return "foveation";
+        case EventType::Stall:
+            return "stall";
+        }
+        return "?";
+    }
+
+    std::string FormatValue(const Event& event) {
+        switch (event.type) {
+        case EventType::Hook:
+        case EventType::Stall:
+            return fmt::format("{:.3f}ms", event.value / 1e6);
+        case EventType::Error:
+            return xr::ToCString(static_cast<XrResult>(event.value));
+        case EventType::TurboState:
+            switch (event.value) {
+            case XR_FOVEATED_TURBO_STATE_DISABLED_MBUCCHIA:
+                return "disabled";
+            case XR_FOVEATED_TURBO_STATE_SYNCHRONOUS_MBUCCHIA:
+                return "synchronous";
+            case XR_FOVEATED_TURBO_STATE_PIPELINED_MBUCCHIA:
+                return "pipelined";
+            }
+            break;
+        case EventType::Foveation:
+            return event.value ? "active" : "inactive";
+        default:
+            break;
+        }
+        return std::to_string(event.value);
+    }
+
+    // Write all the recorded events, oldest first, with their time relative to the dump.
+    void Dump(const std::string& reason, int64_t now) {
+        struct Entry {
+            Event event;
+            DWORD threadId;
+        };
+        std::vector<Entry> entries;
+        std::vector<Event> events(EventCapacity);
+
+        const uint32_t threadCount = std::min(g_threadCount.load(), MaxThreadCount);
+        for (uint32_t i = 0; i < threadCount; i++) {
+            const ThreadState* const state = g_threads[i].load(std::memory_order_acquire);
+            if (!state) {
+                continue;
+            }
+
+            const size_t count = state->events.Recent(events.data(), events.size());
+            for (size_t j = 0; j < count; j++) {
+                entries.push_back({events[j], state->threadId.load(std::memory_order_relaxed)});
+            }
+        }
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+            return a.event.timestamp < b.event.timestamp;
+        });
+
+        const std::time_t wallNow = std::time(nullptr);
+        std::tm localNow;
+        localtime_s(&localNow, &wallNow);
+        std::stringstream filename;
+        filename << "flight_" << std::put_time(&localNow, "%Y%m%d_%H%M%S") << ".log";
+        const std::filesystem::path path = g_directory / filename.str();
+
+        std::ofstream file(path, std::ios_base::trunc);
+        if (!file.is_open()) {
+            ErrorLog(fmt::format("Flight recorder: failed to create {}\n", path.string()));
+            return;
+        }
+
+        file << "# Reason: " << reason << "\n";
+        file << fmt::format("# Display period: {:.3f}ms\n", g_displayPeriod.load() / 1e6);
+        file << "# time_ms thread event api value\n";
+        for (const auto& entry : entries) {
+            const bool hasApi = entry.event.type == EventType::Hook || entry.event.type == EventType::Error ||
+                                entry.event.type == EventType::Stall;
+            file << fmt::format("{:12.3f} {:6} {:<22} {:<34} {}\n",
+                                (entry.event.timestamp - now) / 1e6,
+                                entry.threadId,
+                                GetTypeName(entry.event.type),
+                                hasApi ? latency::GetApiName(entry.event.api) : "-",
+                                FormatValue(entry.event));
+        }
+
+        Log(fmt::format("Flight recorder: {}, dumped {} events to {}\n", reason, entries.size(), path.string()));
+    }
+
+    // Returns a description of the stall on the thread if it was not reported yet.
+    std::string CheckStall(ThreadState& state, int64_t now, XrDuration threshold) {
+        const int64_t hookStart = state.hookStart.load(std::memory_order_acquire);
+        const uint32_t hookApi = state.hookApi.load(std::memory_order_relaxed);
+        const int64_t runtimeStart = state.runtimeStart.load(std::memory_order_acquire);
+        const uint32_t runtimeApi = state.runtimeApi.load(std::memory_order_relaxed);
+
+        // Runtime calls made outside of hooks, such as from the gaze sampler, are watched too.
+        const int64_t start = hookStart ? hookStart : runtimeStart;
+        if (!start || now - start < threshold || start == state.reportedStart) {
+            return {};
+        }
+        state.reportedStart = start;
+
+        const uint32_t api = hookStart ? hookApi : runtimeApi;
+        Record(EventType::Stall, now - start, api);
+
+        std::string description = fmt::format("{} on thread {} stalled for {:.1f}ms",
+                                              latency::GetApiName(api),
+                                              state.threadId.load(std::memory_order_relaxed),
+                                              (now - start) / 1e6);
+        if (hookStart && runtimeStart) {
+            description += fmt::format(
+                " (in {} for {:.1f}ms)", latency::GetApiName(runtimeApi), (now - runtimeStart) / 1e6);
+        }
+        return description;
+    }
+
+    void WatchdogLoop() {
+        int64_t lastDump = 0;
+        uint32_t dumpCount = 0;
+
+        std::unique_lock lock(g_watchdogMutex);
+        while (!g_stopWatchdog) {
+            const XrDuration threshold = g_displayPeriod.load() * g_stallPeriods;
+
+            // Poll a few times per threshold, so stalls are caught shortly after crossing it.
+            const std::chrono::nanoseconds interval =
+                threshold ? std::chrono::nanoseconds(
+                                std::clamp(threshold / 4, XrDuration(1'000'000), XrDuration(100'000'000)))
+                          : 100ms;
+            g_watchdogWakeup.wait_for(lock, interval, [] { return g_stopWatchdog || g_dumpRequested.load(); });
+            if (g_stopWatchdog) {
+                break;
+            }
+
+            const int64_t now = Now();
+            std::string reason;
+            if (g_dumpRequested.exchange(false)) {
+                reason = fmt::format("{} failed with {}",
+                                     latency::GetApiName(g_errorApi.load()),
+                                     xr::ToCString(g_errorResult.load()));
+            }
+
+            if (threshold) {
+                const uint32_t threadCount = std::min(g_threadCount.load(), MaxThreadCount);
+                for (uint32_t i = 0; i < threadCount; i++) {
+                    ThreadState* const state = g_threads[i].load(std::memory_order_acquire);
+                    if (!state) {
+                        continue;
+                    }
+
+                    const std::string stall = CheckStall(*state, now, threshold);
+                    if (!stall.empty()) {
+                        Log(fmt::format("Flight recorder: {}\n", stall));
+                        reason = stall;
+                    }
+                }
+            }
+
+            if (!reason.empty() && dumpCount < k_maxDumps &&
+                (!dumpCount || std::chrono::nanoseconds(now - lastDump) >= k_minDumpInterval)) {
+                Dump(reason, now);
+                lastDump = now;
+                dumpCount++;
+            }
+        }
+    }
+
+} // namespace
+
+namespace openxr_api_layer::recorder {
+
+    void Start(const std::filesystem::path& directory, uint32_t stallPeriods) {
+        Stop();
+
+        g_directory = directory;
+        g_stallPeriods = stallPeriods;
+        g_stopWatchdog = false;
+        g_recording.store(true);
+        g_watchdog = std::thread([] { WatchdogLoop(); });
+    }
+
+    void Stop() {
+        if (g_watchdog.joinable()) {
+            {
+                std::unique_lock lock(g_watchdogMutex);
+                g_stopWatchdog = true;
+            }
+            g_watchdogWakeup.notify_all();
+            g_watchdog.join();
+        }
+        g_recording.store(false);
+    }
+
+    void Record(EventType type, int64_t value, uint32_t api) noexcept {
+        if (!g_recording.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        ThreadState* const state = GetThreadState();
+        if (state) {
+            state->events.Push(Event{Now(), value, api, type});
+        }
+    }
+
+    void RecordError(uint32_t api, XrResult result) noexcept {
+        if (!g_recording.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        Record(EventType::Error, result, api);
+
+        g_errorApi.store(api);
+        g_errorResult.store(result);
+        g_dumpRequested.store(true);
+        g_watchdogWakeup.notify_one();
+    }
+
+    void SetDisplayPeriod(XrDuration period) noexcept {
+        g_displayPeriod.store(period, std::memory_order_relaxed);
+    }
+
+    void EnterHook(uint32_t api, int64_t startNs) noexcept {
+        if (!g_recording.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        ThreadState* const state = GetThreadState();
+        if (state && state->hookDepth++ == 0) {
+            state->hookApi.store(api, std::memory_order_relaxed);
+            state->hookStart.store(startNs, std::memory_order_release);
+        }
+    }
+
+    void LeaveHook(uint32_t api, int64_t startNs, int64_t durationNs) noexcept {
+        // Also when recording just stopped, so that the depth stays balanced.
+        ThreadState* const state = t_state;
+        if (!state || !state->hookDepth) {
+            return;
+        }
+
+        if (--state->hookDepth == 0) {
+            state->hookStart.store(0, std::memory_order_release);
+        }
+        if (g_recording.load(std::memory_order_relaxed)) {
+            state->events.Push(Event{startNs, durationNs, api, EventType::Hook});
+        }
+    }
+
+    void EnterRuntime(uint32_t api, int64_t startNs) noexcept {
+        if (!g_recording.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        ThreadState* const state = GetThreadState();
+        if (state) {
+            state->runtimeApi.store(api, std::memory_order_relaxed);
+            state->runtimeStart.store(startNs, std::memory_order_release);
+        }
+    }
+
+    void LeaveRuntime() noexcept {
+        ThreadState* const state = t_state;
+        if (state) {
+            state->runtimeStart.store(0, std::memory_order_release);
+        }
+    }
+
+} // namespace openxr_api_layer::recorder
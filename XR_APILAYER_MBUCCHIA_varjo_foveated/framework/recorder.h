@@ -0,0 +1,73 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+namespace openxr_api_layer::recorder {
+
+    // Number of events kept for each thread. A frame produces around a dozen events on the app's frame thread, so this
+    // covers the last 7 seconds at 90 Hz. Each event takes 32 bytes in the ring, so 256 KiB for each recorded thread.
+    constexpr uint32_t EventCapacity = 8192;
+
+    // Upper bound on the number of threads being recorded. Additional threads are not recorded.
+    constexpr uint32_t MaxThreadCount = 64;
+
+    enum class EventType : uint32_t {
+        // A hook returned. Value is the duration (ns).
+        Hook,
+        // A hook returned an error. Value is the XrResult.
+        Error,
+        // Value is the predictedDisplayTime returned by xrWaitFrame().
+        WaitedDisplayTime,
+        // Value is the displayTime passed to xrEndFrame().
+        SubmittedDisplayTime,
+        // Value is the new XrFoveatedTurboStateMBUCCHIA.
+        TurboState,
+        // Value is 1 when foveated rendering became active, 0 when it became inactive.
+        Foveation,
+        // The watchdog caught a stall. Value is how long the hook or runtime call had been running (ns).
+        Stall,
+    };
+
+    // Start recording events, and watch for hooks or runtime calls running longer than stallPeriods display periods (0
+    // disables the watchdog). The recorded events are dumped into the directory upon a stall or an error.
+    void Start(const std::filesystem::path& directory, uint32_t stallPeriods);
+    void Stop();
+
+    void Record(EventType type, int64_t value, uint32_t api = 0) noexcept;
+
+    // Record the error and request a dump.
+    void RecordError(uint32_t api, XrResult result) noexcept;
+
+    // The watchdog only runs with a known display period, from xrWaitFrame() or from the display times submitted to
+    // xrEndFrame(). Set to 0 while the runtime may legitimately block the app, such as when the session is not visible.
+    void SetDisplayPeriod(XrDuration period) noexcept;
+
+    // Called by latency::HookTimer and latency::RuntimeTimer, to track what each thread is currently blocked on.
+    void EnterHook(uint32_t api, int64_t startNs) noexcept;
+    void LeaveHook(uint32_t api, int64_t startNs, int64_t durationNs) noexcept;
+    void EnterRuntime(uint32_t api, int64_t startNs) noexcept;
+    void LeaveRuntime() noexcept;
+
+} // namespace openxr_api_layer::recorder
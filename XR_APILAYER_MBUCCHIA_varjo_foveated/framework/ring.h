@@ -0,0 +1,104 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+namespace openxr_api_layer {
+
+    // A ring of the most recent samples, written by a single thread and read without locking by any thread. Readers
+    // never block the writer: a sample overwritten while being read is detected and skipped (each slot is a seqlock).
+    template <typename T, size_t Capacity>
+    class Ring {
+        static_assert(std::is_trivially_copyable_v<T>, "Ring only holds plain structures");
+
+      public:
+        Ring() = default;
+        Ring(const Ring&) = delete;
+        Ring& operator=(const Ring&) = delete;
+
+        // Only from the writer thread.
+        void Push(const T& sample) noexcept {
+            const uint64_t index = m_count.load(std::memory_order_relaxed);
+            Slot& slot = m_slots[index % Capacity];
+
+            slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            std::memcpy(&slot.value, &sample, sizeof(T));
+            slot.sequence.store(2 * index + 2, std::memory_order_release);
+
+            m_count.store(index + 1, std::memory_order_release);
+        }
+
+        // Copies up to count of the most recent samples, newest first. Returns the number of samples copied.
+        size_t Recent(T* samples, size_t count) const noexcept {
+            const uint64_t newest = m_count.load(std::memory_order_acquire);
+            size_t copied = 0;
+            for (uint64_t index = newest; index > 0 && copied < std::min(count, Capacity); index--) {
+                if (!Read(index - 1, samples[copied])) {
+                    // Overwritten by the writer, anything older is gone too.
+                    break;
+                }
+                copied++;
+            }
+            return copied;
+        }
+
+        bool Latest(T& sample) const noexcept {
+            return Recent(&sample, 1) == 1;
+        }
+
+        // Total number of samples pushed.
+        uint64_t Count() const noexcept {
+            return m_count.load(std::memory_order_acquire);
+        }
+
+        void Clear() noexcept {
+            m_count.store(0, std::memory_order_release);
+            for (auto& slot : m_slots) {
+                slot.sequence.store(0, std::memory_order_relaxed);
+            }
+        }
+
+      private:
+        struct Slot {
+            std::atomic<uint64_t> sequence{0};
+            T value;
+        };
+
+        bool Read(uint64_t index, T& sample) const noexcept {
+            const Slot& slot = m_slots[index % Capacity];
+            const uint64_t expected = 2 * index + 2;
+            if (slot.sequence.load(std::memory_order_acquire) != expected) {
+                return false;
+            }
+            std::memcpy(&sample, &slot.value, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return slot.sequence.load(std::memory_order_relaxed) == expected;
+        }
+
+        Slot m_slots[Capacity]{};
+        std::atomic<uint64_t> m_count{0};
+    };
+
+} // namespace openxr_api_layer
@@ -24,6 +24,18 @@
 
 #include "pch.h"
 
+#include "log.h"
+
+// Error-code based alternative to CHECK_XRCMD(), for code called from the noexcept hot path wrappers.
+#define CHECK_XRCMD_RETURN(cmd)                                                                                        \
+    do {                                                                                                               \
+        const XrResult _result = (cmd);                                                                                \
+        if (XR_FAILED(_result)) {                                                                                      \
+            openxr_api_layer::log::ErrorLog("%s failed with %s\n", #cmd, xr::ToCString(_result));                      \
+            return _result;                                                                                            \
+        }                                                                                                              \
+    } while (0)
+
 namespace xr {
 
     static inline std::string ToString(XrVersion version) {
@@ -0,0 +1,115 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+namespace openxr_api_layer {
+
+    // A long-lived thread running the same job on demand. This replaces std::async() on the frame loop: the thread and
+    // its synchronization objects are created once, so kicking off and completing a job never touches the heap.
+    //
+    // The job must not throw. A started job must complete (Wait()) before the next Start().
+    class Worker {
+      public:
+        explicit Worker(std::function<void()> job) : m_job(std::move(job)), m_thread([this] { Run(); }) {
+        }
+
+        ~Worker() {
+            {
+                std::unique_lock lock(m_mutex);
+                m_exit = true;
+            }
+            m_wakeUp.notify_all();
+            m_thread.join();
+        }
+
+        Worker(const Worker&) = delete;
+        Worker& operator=(const Worker&) = delete;
+
+        void Start() noexcept {
+            {
+                std::unique_lock lock(m_mutex);
+                m_state = State::Pending;
+            }
+            m_wakeUp.notify_all();
+        }
+
+        // Whether a job was started and not yet reset, like std::future::valid().
+        bool IsValid() const noexcept {
+            std::unique_lock lock(m_mutex);
+            return m_state != State::Idle;
+        }
+
+        void Wait() const noexcept {
+            std::unique_lock lock(m_mutex);
+            m_completed.wait(lock, [&] { return m_state != State::Pending; });
+        }
+
+        // Returns whether the job has completed.
+        template <class Rep, class Period>
+        bool WaitFor(const std::chrono::duration<Rep, Period>& timeout) const noexcept {
+            std::unique_lock lock(m_mutex);
+            return m_completed.wait_for(lock, timeout, [&] { return m_state != State::Pending; });
+        }
+
+        // Waits for any job in progress, then marks the worker as available for the next Start().
+        void Reset() noexcept {
+            std::unique_lock lock(m_mutex);
+            m_completed.wait(lock, [&] { return m_state != State::Pending; });
+            m_state = State::Idle;
+        }
+
+      private:
+        enum class State { Idle, Pending, Completed };
+
+        void Run() {
+            std::unique_lock lock(m_mutex);
+            while (true) {
+                m_wakeUp.wait(lock, [&] { return m_exit || m_state == State::Pending; });
+                if (m_exit) {
+                    break;
+                }
+
+                lock.unlock();
+                m_job();
+                lock.lock();
+
+                m_state = State::Completed;
+                m_completed.notify_all();
+            }
+        }
+
+        const std::function<void()> m_job;
+
+        mutable std::mutex m_mutex;
+        mutable std::condition_variable m_completed;
+        std::condition_variable m_wakeUp;
+        State m_state{State::Idle};
+        bool m_exit{false};
+
+        // Must be last, so the state above is ready before the thread starts.
+        std::thread m_thread;
+    };
+
+} // namespace openxr_api_layer
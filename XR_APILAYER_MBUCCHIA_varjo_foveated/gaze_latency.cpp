@@ -0,0 +1,115 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "gaze_latency.h"
+
+namespace openxr_api_layer {
+
+    using namespace varjo_foveated::telemetry;
+
+    void GazeLatencyMonitor::Reset() {
+        std::unique_lock lock(m_mutex);
+
+        m_frameCount = m_unmatchedCount = 0;
+        m_maxAge = 0;
+        std::fill(std::begin(m_ageHistogram), std::end(m_ageHistogram), 0);
+        std::fill(std::begin(m_slipHistogram), std::end(m_slipHistogram), 0);
+    }
+
+    void GazeLatencyMonitor::AddFrame(XrTime gazeTime, XrTime submittedDisplayTime, XrTime displayTime) {
+        std::unique_lock lock(m_mutex);
+
+        const XrDuration age = displayTime - gazeTime;
+        AddDuration(m_ageHistogram, age);
+        AddDuration(m_slipHistogram, displayTime - submittedDisplayTime);
+        m_maxAge = m_frameCount ? std::max(m_maxAge, age) : age;
+        m_frameCount++;
+    }
+
+    void GazeLatencyMonitor::AddUnmatchedFrame() {
+        std::unique_lock lock(m_mutex);
+
+        m_unmatchedCount++;
+    }
+
+    uint64_t GazeLatencyMonitor::GetFrameCount() const {
+        std::unique_lock lock(m_mutex);
+
+        return m_frameCount;
+    }
+
+    void GazeLatencyMonitor::GetSnapshot(FrameSnapshot& frame) const {
+        std::unique_lock lock(m_mutex);
+
+        frame.gazeAgeFrameCount = static_cast<uint32_t>(m_frameCount);
+        frame.gazeAgeUnmatchedCount = static_cast<uint32_t>(m_unmatchedCount);
+        frame.gazeAgeP50Ms = GetPercentileMs(m_ageHistogram, m_frameCount, 0.5);
+        frame.gazeAgeP95Ms = GetPercentileMs(m_ageHistogram, m_frameCount, 0.95);
+        frame.gazeAgeP99Ms = GetPercentileMs(m_ageHistogram, m_frameCount, 0.99);
+        frame.gazeAgeMaxMs = m_maxAge / 1e6f;
+        frame.displayTimeSlipP50Ms = GetPercentileMs(m_slipHistogram, m_frameCount, 0.5);
+        frame.displayTimeSlipP95Ms = GetPercentileMs(m_slipHistogram, m_frameCount, 0.95);
+    }
+
+    std::string GazeLatencyMonitor::ToString() const {
+        FrameSnapshot frame{};
+        GetSnapshot(frame);
+
+        return fmt::format("{} frames ({} unmatched), age p50 {:.1f}ms p95 {:.1f}ms p99 {:.1f}ms max {:.1f}ms, "
+                           "display time slip p50 {:.1f}ms p95 {:.1f}ms",
+                           frame.gazeAgeFrameCount,
+                           frame.gazeAgeUnmatchedCount,
+                           frame.gazeAgeP50Ms,
+                           frame.gazeAgeP95Ms,
+                           frame.gazeAgeP99Ms,
+                           frame.gazeAgeMaxMs,
+                           frame.displayTimeSlipP50Ms,
+                           frame.displayTimeSlipP95Ms);
+    }
+
+    void GazeLatencyMonitor::AddDuration(uint64_t (&histogram)[BucketCount], XrDuration duration) {
+        const XrDuration bucket = (std::max(duration, MinDuration) - MinDuration + BucketDuration / 2) / BucketDuration;
+        histogram[std::min(bucket, static_cast<XrDuration>(BucketCount - 1))]++;
+    }
+
+    float GazeLatencyMonitor::GetPercentileMs(const uint64_t (&histogram)[BucketCount],
+                                              uint64_t count,
+                                              double percentile) {
+        if (!count) {
+            return 0.f;
+        }
+
+        const uint64_t threshold = static_cast<uint64_t>(std::ceil(count * percentile));
+        uint64_t cumulated = 0;
+        uint32_t i = 0;
+        for (; i < BucketCount - 1; i++) {
+            cumulated += histogram[i];
+            if (cumulated >= threshold) {
+                break;
+            }
+        }
+        return (MinDuration + i * BucketDuration) / 1e6f;
+    }
+
+} // namespace openxr_api_layer
@@ -0,0 +1,71 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <VarjoFoveatedTelemetry.h>
+
+namespace openxr_api_layer {
+
+    // Distributions of the age of the gaze behind the focus views, when the frame is displayed. This is the error
+    // the focus region must absorb, and it sets how small the region can be. May be called from any thread.
+    class GazeLatencyMonitor {
+      public:
+        // Forget the frames of the previous session.
+        void Reset();
+
+        // A frame submitted with focus views following the gaze acquired at gazeTime. The application rendered it for
+        // submittedDisplayTime, and the runtime predicted it for displayTime.
+        void AddFrame(XrTime gazeTime, XrTime submittedDisplayTime, XrTime displayTime);
+
+        // A frame submitted while the gaze is tracked, without a matching xrLocateViews() call.
+        void AddUnmatchedFrame();
+
+        uint64_t GetFrameCount() const;
+
+        // Fill the gaze age fields of the telemetry snapshot.
+        void GetSnapshot(varjo_foveated::telemetry::FrameSnapshot& frame) const;
+
+        std::string ToString() const;
+
+      private:
+        // Durations rounded to the nearest 0.5ms, from -20ms to 80ms. The first and last buckets also count anything
+        // beyond.
+        static constexpr XrDuration BucketDuration = 500'000;
+        static constexpr XrDuration MinDuration = -20'000'000;
+        static constexpr uint32_t BucketCount = 200;
+
+        static void AddDuration(uint64_t (&histogram)[BucketCount], XrDuration duration);
+
+        // Returns the value of the bucket containing the requested percentile, in milliseconds.
+        static float GetPercentileMs(const uint64_t (&histogram)[BucketCount], uint64_t count, double percentile);
+
+        mutable std::mutex m_mutex;
+
+        uint64_t m_frameCount{0};
+        uint64_t m_unmatchedCount{0};
+        XrDuration m_maxAge{0};
+        uint64_t m_ageHistogram[BucketCount]{};
+        uint64_t m_slipHistogram[BucketCount]{};
+    };
+
+} // namespace openxr_api_layer
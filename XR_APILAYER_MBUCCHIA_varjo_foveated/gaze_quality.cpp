@@ -0,0 +1,177 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "gaze_quality.h"
+#include <VarjoFoveatedScaling.h>
+
+namespace {
+
+    using namespace varjo_foveated::telemetry;
+    using varjo_foveated::scaling::DegreesPerRadian;
+
+    // Consecutive samples further apart than this are not used for the jitter, the gaze may have moved in between.
+    constexpr XrDuration MaxJitterInterval = 50'000'000;
+
+    // The gaze direction is the forward (-Z) axis of the gaze pose.
+    XrVector3f GetGazeDirection(const XrQuaternionf& q) {
+        return {-2.f * (q.w * q.y + q.x * q.z), 2.f * (q.w * q.x - q.y * q.z), -(1.f - 2.f * (q.x * q.x + q.y * q.y))};
+    }
+
+    // Accurate for small angles, unlike acos() of the dot product.
+    double GetAngleDeg(const XrVector3f& a, const XrVector3f& b) {
+        const double crossX = (double)a.y * b.z - (double)a.z * b.y;
+        const double crossY = (double)a.z * b.x - (double)a.x * b.z;
+        const double crossZ = (double)a.x * b.y - (double)a.y * b.x;
+        const double dot = (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z;
+        return std::atan2(std::sqrt(crossX * crossX + crossY * crossY + crossZ * crossZ), dot) * DegreesPerRadian;
+    }
+
+} // namespace
+
+namespace openxr_api_layer {
+
+    void GazeQualityMonitor::Reset() {
+        std::unique_lock lock(m_mutex);
+
+        m_sampleCount = m_trackedCount = 0;
+        m_lastTime = 0;
+        m_lastTracked = false;
+        m_dropoutStart = 0;
+        m_dropoutCount = m_blinkCount = 0;
+        std::fill(std::begin(m_dropoutHistogram), std::end(m_dropoutHistogram), 0);
+        m_longestDropout = 0;
+        std::fill(std::begin(m_jitterHistogram), std::end(m_jitterHistogram), 0);
+        m_jitterCount = 0;
+    }
+
+    void GazeQualityMonitor::AddSample(XrTime time, XrSpaceLocationFlags flags, const XrPosef& pose) {
+        std::unique_lock lock(m_mutex);
+
+        if (time <= m_lastTime) {
+            return;
+        }
+
+        const bool isTracked = flags & XR_SPACE_LOCATION_ORIENTATION_TRACKED_BIT;
+        m_sampleCount++;
+        if (isTracked) {
+            m_trackedCount++;
+
+            const XrVector3f direction = GetGazeDirection(pose.orientation);
+            if (m_lastTracked && time - m_lastTime <= MaxJitterInterval) {
+                const double angle = GetAngleDeg(m_lastDirection, direction);
+                const uint32_t bucket = static_cast<uint32_t>(angle / JitterBucketDeg);
+                m_jitterHistogram[std::min(bucket, JitterBucketCount - 1)]++;
+                m_jitterCount++;
+            }
+            m_lastDirection = direction;
+
+            if (m_dropoutStart) {
+                const XrDuration duration = time - m_dropoutStart;
+                const uint32_t durationMs = static_cast<uint32_t>(duration / 1'000'000);
+
+                uint32_t bucket = 0;
+                while (bucket < std::size(GazeDropoutBucketLimitsMs) &&
+                       durationMs >= GazeDropoutBucketLimitsMs[bucket]) {
+                    bucket++;
+                }
+                m_dropoutHistogram[bucket]++;
+                m_dropoutCount++;
+                if (durationMs >= GazeBlinkMinMs && durationMs < GazeBlinkMaxMs) {
+                    m_blinkCount++;
+                }
+                m_longestDropout = std::max(m_longestDropout, duration);
+                m_dropoutStart = 0;
+            }
+        } else if (m_lastTracked) {
+            // Losing the gaze before it was ever tracked (eg: headset not worn yet) is not a dropout.
+            m_dropoutStart = time;
+        }
+
+        m_lastTime = time;
+        m_lastTracked = isTracked;
+    }
+
+    uint64_t GazeQualityMonitor::GetSampleCount() const {
+        std::unique_lock lock(m_mutex);
+
+        return m_sampleCount;
+    }
+
+    void GazeQualityMonitor::GetSnapshot(FrameSnapshot& frame) const {
+        std::unique_lock lock(m_mutex);
+
+        frame.gazeSampleCount = static_cast<uint32_t>(m_sampleCount);
+        frame.gazeSampleTrackedRatio = m_sampleCount ? (float)m_trackedCount / m_sampleCount : 0.f;
+        frame.gazeDropoutCount = m_dropoutCount;
+        std::copy(std::begin(m_dropoutHistogram), std::end(m_dropoutHistogram), frame.gazeDropoutHistogram);
+        frame.gazeBlinkCount = m_blinkCount;
+        frame.gazeLongestDropoutMs = m_longestDropout / 1e6f;
+        frame.gazeJitterP50Deg = GetJitterPercentileDeg(0.5);
+        frame.gazeJitterP95Deg = GetJitterPercentileDeg(0.95);
+    }
+
+    std::string GazeQualityMonitor::ToString() const {
+        FrameSnapshot frame{};
+        GetSnapshot(frame);
+
+        std::string histogram;
+        for (uint32_t i = 0; i < GazeDropoutBucketCount; i++) {
+            if (i < std::size(GazeDropoutBucketLimitsMs)) {
+                histogram += fmt::format(
+                    "{}<{}ms: {}", i ? " " : "", GazeDropoutBucketLimitsMs[i], frame.gazeDropoutHistogram[i]);
+            } else {
+                histogram += fmt::format(" longer: {}", frame.gazeDropoutHistogram[i]);
+            }
+        }
+
+        return fmt::format("{} samples, {:.1f}% tracked, {} dropouts ({}), {} blinks, longest dropout {:.0f}ms, "
+                           "jitter p50 {:.2f}deg p95 {:.2f}deg",
+                           frame.gazeSampleCount,
+                           frame.gazeSampleTrackedRatio * 100.f,
+                           frame.gazeDropoutCount,
+                           histogram,
+                           frame.gazeBlinkCount,
+                           frame.gazeLongestDropoutMs,
+                           frame.gazeJitterP50Deg,
+                           frame.gazeJitterP95Deg);
+    }
+
+    // Returns the upper bound of the bucket containing the requested percentile.
+    float GazeQualityMonitor::GetJitterPercentileDeg(double percentile) const {
+        if (!m_jitterCount) {
+            return 0.f;
+        }
+
+        const uint64_t threshold = static_cast<uint64_t>(std::ceil(m_jitterCount * percentile));
+        uint64_t cumulated = 0;
+        for (uint32_t i = 0; i < JitterBucketCount; i++) {
+            cumulated += m_jitterHistogram[i];
+            if (cumulated >= threshold) {
+                return (i + 1) * JitterBucketDeg;
+            }
+        }
+        return JitterBucketCount * JitterBucketDeg;
+    }
+
+} // namespace openxr_api_layer
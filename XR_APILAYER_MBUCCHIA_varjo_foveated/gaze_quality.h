@@ -0,0 +1,74 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <VarjoFoveatedTelemetry.h>
+
+namespace openxr_api_layer {
+
+    // Running statistics on the gaze samples located by the layer, to tell eye tracking issues apart from rendering
+    // issues. May be called from any thread.
+    class GazeQualityMonitor {
+      public:
+        // Forget the samples of the previous session.
+        void Reset();
+
+        // Samples that are not newer than the previous one are ignored, such as when the application locates the views
+        // several times for the same frame.
+        void AddSample(XrTime time, XrSpaceLocationFlags flags, const XrPosef& pose);
+
+        uint64_t GetSampleCount() const;
+
+        // Fill the eye tracking quality fields of the telemetry snapshot.
+        void GetSnapshot(varjo_foveated::telemetry::FrameSnapshot& frame) const;
+
+        std::string ToString() const;
+
+      private:
+        // Steps between consecutive tracked samples, in 0.05 degree buckets. The last bucket counts the larger steps.
+        static constexpr float JitterBucketDeg = 0.05f;
+        static constexpr uint32_t JitterBucketCount = 200;
+
+        // Must be called with m_mutex held.
+        float GetJitterPercentileDeg(double percentile) const;
+
+        mutable std::mutex m_mutex;
+
+        uint64_t m_sampleCount{0};
+        uint64_t m_trackedCount{0};
+        XrTime m_lastTime{0};
+        bool m_lastTracked{false};
+        XrVector3f m_lastDirection{};
+
+        // Time of the first untracked sample of the ongoing dropout, 0 if none.
+        XrTime m_dropoutStart{0};
+        uint32_t m_dropoutCount{0};
+        uint32_t m_dropoutHistogram[varjo_foveated::telemetry::GazeDropoutBucketCount]{};
+        uint32_t m_blinkCount{0};
+        XrDuration m_longestDropout{0};
+
+        uint64_t m_jitterHistogram[JitterBucketCount]{};
+        uint64_t m_jitterCount{0};
+    };
+
+} // namespace openxr_api_layer
@@ -23,21 +23,165 @@
 #include "pch.h"
 
 #include "layer.h"
+#include "auto_tune.h"
+#include "capture.h"
+#include "gaze_latency.h"
+#include "gaze_quality.h"
+#include "telemetry.h"
+#include <VarjoFoveatedScaling.h>
+#include <allocations.h>
+#include <arena.h>
+#include <latency.h>
 #include <log.h>
+#include <recorder.h>
+#include <ring.h>
 #include <util.h>
+#include <worker.h>
+
+namespace openxr_api_layer {
+
+    // XR_MBUCCHIA_varjo_foveated_stats entry point.
+    XrResult XRAPI_CALL xrGetFoveatedStatsMBUCCHIA(XrSession session, XrFoveatedStatsMBUCCHIA* stats) noexcept;
+
+} // namespace openxr_api_layer
 
 namespace {
 
     using namespace openxr_api_layer;
     using namespace openxr_api_layer::log;
+    using varjo_foveated::capture::RecordType;
+    namespace scaling = varjo_foveated::scaling;
+
+    // Counters updated by the hooks every frame, and read without locking by the XR_MBUCCHIA_varjo_foveated_stats
+    // query.
+    struct LiveStats {
+        std::atomic<bool> foveationActive{false};
+        std::atomic<uint64_t> locateViewsCount{0};
+        std::atomic<uint64_t> foveatedLocateViewsCount{0};
+        std::atomic<XrFoveatedTurboStateMBUCCHIA> turboState{XR_FOVEATED_TURBO_STATE_DISABLED_MBUCCHIA};
+        std::atomic<uint64_t> frameCount{0};
+        std::atomic<uint64_t> madeUpFrameCount{0};
+        std::atomic<XrTime> runtimePredictedDisplayTime{0};
+        std::atomic<XrTime> predictedDisplayTime{0};
+        std::atomic<XrDuration> predictedDisplayPeriod{0};
+    };
+
+    // The focus views FOV returned by xrLocateViews(), to correct the FOV submitted for the same display time.
+    struct FocusFovEntry {
+        XrTime displayTime{0};
+        std::pair<XrFovf, XrFovf> fovs;
+        // The time the gaze followed by the focus views was acquired, 0 if it was not tracked.
+        XrTime gazeTime{0};
+    };
+
+    // The last quantized FOV of a focus view (focus_quantization), kept until the gaze moves to another grid point.
+    struct QuantizedFov {
+        bool valid{false};
+        int32_t horizontal{0};
+        int32_t vertical{0};
+        XrFovf fov{};
+    };
+
+    // The state of the layer for one XrSession, from its first xrBeginSession() to xrDestroySession().
+    //
+    // The slot is looked up by handle without locking: the application may not use a session while it is being
+    // destroyed, and the handle is published last when the slot is claimed.
+    struct SessionState {
+        std::atomic<XrSession> session{XR_NULL_HANDLE};
+
+        // The gaze spaces, created when the session begins with Quad Views and destroyed with the session.
+        XrSpace viewSpace{XR_NULL_HANDLE};
+        XrSpace renderGazeSpace{XR_NULL_HANDLE};
+
+        // FOV submission correction.
+        std::mutex focusFovMutex;
+        FocusFovEntry focusFovHistory[16]{};
+        size_t nextFocusFovEntry{0};
+
+        // Focus views FOV quantization, also under focusFovMutex.
+        QuantizedFov quantizedFocusFovs[2]{};
+    };
 
-    class OpenXrLayer : public openxr_api_layer::OpenXrApi {
+    // A location of the combined-eye gaze in the view space, taken by the gaze sampler.
+    struct GazeSample {
+        // When the sample was acquired.
+        XrTime time{0};
+        XrSpaceLocationFlags flags{0};
+        XrPosef pose{};
+        // When the sampler pushed the sample, to reject the stale ones.
+        std::chrono::time_point<std::chrono::steady_clock> timestamp{};
+    };
+
+    // The sample count recommended for a class of views (peripheral or focus).
+    struct ViewClass {
+        const char* name;
+        uint32_t sampleCount;
+        uint32_t runtimeSampleCount;
+    };
+
+    // A color swapchain created by the application, for the report of the sample count policy.
+    struct SwapchainSamples {
+        uint32_t width;
+        uint32_t height;
+        uint32_t sampleCount;
+        int64_t pixelCount;
+        // The class of the views it was first submitted for, nullptr until then.
+        const ViewClass* viewClass{nullptr};
+        int64_t savedSamples{0};
+    };
+
+    // The next image of a swapchain, acquired and waited by the layer ahead of the application (acquire_ahead).
+    //
+    // Ordering rules: only one image is staged per swapchain. Staging starts when the application releases its last
+    // acquired image, so the runtime sees the same acquire/wait/release sequence as without staging, and the staged
+    // image is always the oldest acquired image. The application's next acquire completes the staging and returns the
+    // staged image, and its next wait returns immediately if the staged wait succeeded.
+    struct StagedSwapchain {
+        XrSwapchain swapchain{XR_NULL_HANDLE};
+        // Images acquired by the application and not released yet.
+        uint32_t acquiredImageCount{0};
+        XrResult acquireResult{XR_ERROR_CALL_ORDER_INVALID};
+        XrResult waitResult{XR_ERROR_CALL_ORDER_INVALID};
+        uint32_t index{0};
+        // The application acquired the staged image, but did not wait it yet.
+        bool waitPending{false};
+        // Must be last, so it stops before the state above is destroyed.
+        std::unique_ptr<Worker> worker;
+    };
+
+    // A frame queued by xrEndFrame() for the submit thread (async_submit). The application's structures are deep-copied
+    // into the arena, since the application may reuse its memory as soon as xrEndFrame() returns.
+    struct QueuedFrame {
+        XrSession session{XR_NULL_HANDLE};
+        XrFrameEndInfo frameEndInfo{XR_TYPE_FRAME_END_INFO};
+        // The runtime submits the last released image of each swapchain, so the application may not release another
+        // image of these swapchains until the frame is submitted.
+        XrSwapchain swapchains[32]{};
+        uint32_t swapchainCount{0};
+        XrTime gazeTime{0};
+        Arena<16384> arena;
+    };
+
+    class OpenXrLayer final : public openxr_api_layer::OpenXrApi {
       public:
         OpenXrLayer() = default;
 
         // Corresponds to xrDestroyInstance().
         // https://www.khronos.org/registry/OpenXR/specs/1.0/html/xrspec.html#xrCreateInstance
-        ~OpenXrLayer() = default;
+        ~OpenXrLayer() {
+            StopSubmitThread();
+            {
+                std::unique_lock lock(m_resourcesMutex);
+                StopGazeSampler();
+            }
+            recorder::Stop();
+
+            // Flush what the writer did not get to.
+            if (m_settingsWriter) {
+                m_settingsWriter->Wait();
+                WriteSettings();
+            }
+        }
 
         // https://www.khronos.org/registry/OpenXR/specs/1.0/html/xrspec.html#xrGetInstanceProcAddr
         XrResult xrGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function) override {
@@ -47,9 +191,23 @@ namespace {
                               TLArg(name, "Name"),
                               TLArg(m_bypassApiLayer, "Bypass"));
 
+            // Entry points for the extensions implemented by the layer, even when it is bypassed.
+            if (m_hasFoveatedStatsExtension && std::string_view(name) == "xrGetFoveatedStatsMBUCCHIA") {
+                *function = reinterpret_cast<PFN_xrVoidFunction>(openxr_api_layer::xrGetFoveatedStatsMBUCCHIA);
+                TraceLoggingWrite(g_traceProvider, "xrGetInstanceProcAddr", TLPArg(*function, "Function"));
+                return XR_SUCCESS;
+            }
+
             XrResult result = m_bypassApiLayer ? m_xrGetInstanceProcAddr(instance, name, function)
                                                : OpenXrApi::xrGetInstanceProcAddr(instance, name, function);
 
+            // Hand out the runtime's entry point for hooks that serve no purpose with the current configuration. The
+            // dispatcher above still recorded the runtime's pointer for our own internal use.
+            if (!m_bypassApiLayer && XR_SUCCEEDED(result) &&
+                std::find(m_bypassedHooks.cbegin(), m_bypassedHooks.cend(), name) != m_bypassedHooks.cend()) {
+                result = m_xrGetInstanceProcAddr(instance, name, function);
+            }
+
             TraceLoggingWrite(g_traceProvider, "xrGetInstanceProcAddr", TLPArg(*function, "Function"));
 
             return result;
@@ -71,6 +229,13 @@ namespace {
                               TLArg(createInfo->createFlags, "CreateFlags"));
             Log(fmt::format("Application: {}\n", createInfo->applicationInfo.applicationName));
 
+            // The extension was enabled successfully, so its entry point must be handed out even if the layer is
+            // bypassed.
+            m_hasFoveatedStatsExtension =
+                std::find(GetGrantedExtensions().cbegin(),
+                          GetGrantedExtensions().cend(),
+                          XR_MBUCCHIA_VARJO_FOVEATED_STATS_EXTENSION_NAME) != GetGrantedExtensions().cend();
+
 #ifndef _DEBUG
             // See if the instance supports quad views to begin with.
             m_bypassApiLayer = std::find(GetGrantedExtensions().cbegin(),
@@ -85,6 +250,12 @@ namespace {
             // Needed to resolve the requested function pointers.
             OpenXrApi::xrCreateInstance(createInfo);
 
+            m_hasPerformanceCounterConversion =
+                std::find(GetGrantedExtensions().cbegin(),
+                          GetGrantedExtensions().cend(),
+                          XR_KHR_WIN32_CONVERT_PERFORMANCE_COUNTER_TIME_EXTENSION_NAME) !=
+                GetGrantedExtensions().cend();
+
             // Dump the application name and OpenXR runtime information to help debugging issues.
             XrInstanceProperties instanceProperties = {XR_TYPE_INSTANCE_PROPERTIES};
             CHECK_XRCMD(OpenXrApi::xrGetInstanceProperties(GetXrInstance(), &instanceProperties));
@@ -116,19 +287,149 @@ namespace {
             // Parse the configuration.
             LoadConfiguration();
 
+            m_systemName = systemProperties.systemName;
+            LoadViewFovs();
+
+            // Settings learnt while the app runs are written from a thread, never from the frame loop.
+            m_settingsWriter = std::make_unique<Worker>([&] { WriteSettings(); });
+
             // Force foveation off if not supported.
             if (!foveatedRenderingProperties.supportsFoveatedRendering) {
                 m_noEyeTracking = true;
             }
 
+            // Without eye tracking, the focus region does not move: it can be sized independently and offset towards
+            // where the user looks most of the time. There is no gaze jitter to quantize away.
+            if (m_noEyeTracking) {
+                m_focusQuantization = 0.f;
+                if (m_fixedHorizontalScale > 0) {
+                    m_focusHorizontalScale = m_fixedHorizontalScale;
+                }
+                if (m_fixedVerticalScale > 0) {
+                    m_focusVerticalScale = m_fixedVerticalScale;
+                }
+                Log(fmt::format("Fixed focus region: {:.2f}x{:.2f} scale, {:.1f}/{:.1f} degrees offset\n",
+                                m_focusHorizontalScale,
+                                m_focusVerticalScale,
+                                m_fixedHorizontalOffset,
+                                m_fixedVerticalOffset));
+            } else if (m_focusQuantization > 0) {
+                Log(fmt::format("Focus views quantization: {:.2f} degrees grid, {:.2f} degrees dead zone\n",
+                                m_focusQuantization,
+                                m_focusDeadZone));
+            }
+
+            // The settings of the application override settings.cfg, and the auto-tuner overrides both.
+            LoadApplicationConfiguration();
+
+            // Frame pacing and low latency mode hold the app in xrWaitFrame(), which Turbo Mode is meant to avoid.
+            if (IsFramePacingEnabled() || m_lowLatency) {
+                if (m_useTurboMode) {
+                    Log(fmt::format("{} is enabled, disabling Turbo Mode\n",
+                                    IsFramePacingEnabled() ? "Frame pacing" : "Low latency mode"));
+                    m_useTurboMode = false;
+                }
+                if (IsFramePacingEnabled()) {
+                    Log(fmt::format(
+                        "Frame pacing: {}/{} of the refresh rate\n", m_pacingNumerator, m_pacingDenominator));
+                }
+                if (m_lowLatency) {
+                    Log(fmt::format("Low latency mode: {:.1f}ms margin\n", m_lowLatencyMargin));
+                }
+
+                m_pacingTimer.reset(CreateWaitableTimerExW(
+                    nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS));
+                if (!m_pacingTimer) {
+                    // High resolution timers require Windows 10 1803.
+                    m_pacingTimer.reset(CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS));
+                }
+            }
+
+            if (m_gazeSamplingRate && !m_noEyeTracking) {
+                Log(fmt::format("Gaze sampling: {} Hz\n", m_gazeSamplingRate));
+
+                m_gazeSamplerTimer.reset(CreateWaitableTimerExW(
+                    nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS));
+                if (!m_gazeSamplerTimer) {
+                    m_gazeSamplerTimer.reset(CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS));
+                }
+            }
+
+            // In Turbo mode, the runtime's xrWaitFrame() runs on a dedicated thread, created once for the instance.
+            if (m_useTurboMode) {
+                m_asyncWaitWorker = std::make_unique<Worker>([&] { AsyncWaitFrame(); });
+            }
+
+            // Asynchronous submission moves the runtime's xrBeginFrame() and xrEndFrame() of Turbo Mode to a thread.
+            if (m_asyncSubmit) {
+                if (m_useTurboMode) {
+                    Log("Asynchronous frame submission: one frame in flight\n");
+                    m_submitThread = std::thread([&] { SubmitThreadLoop(); });
+                } else {
+                    Log("Asynchronous frame submission requires Turbo Mode, disabling it\n");
+                    m_asyncSubmit = false;
+                }
+            }
+
+            m_configSnapshotId = ComputeConfigSnapshotId();
+            Log(fmt::format("Configuration snapshot: {:08x}\n", m_configSnapshotId));
+
             TraceLoggingWrite(g_traceProvider,
                               "xrCreateInstance",
                               TLArg(m_peripheralResolutionFactor, "PeripheralResolutionFactor"),
                               TLArg(m_focusResolutionFactor, "FocusResolutionFactor"),
                               TLArg(m_focusHorizontalScale, "FocusHorizontalScale"),
                               TLArg(m_focusVerticalScale, "FocusVerticalScale"),
+                              TLArg(m_focusQuantization, "FocusQuantization"),
+                              TLArg(m_focusDeadZone, "FocusDeadZone"),
+                              TLArg(m_peripheralPixelDensity, "PeripheralPixelDensity"),
+                              TLArg(m_focusPixelDensity, "FocusPixelDensity"),
+                              TLArg(m_peripheralSampleCount, "PeripheralSampleCount"),
+                              TLArg(m_focusSampleCount, "FocusSampleCount"),
+                              TLArg(m_autoTune, "AutoTune"),
+                              TLArg(m_autoTuneTarget, "AutoTuneTarget"),
+                              TLArg(m_autoTuneWindow, "AutoTuneWindow"),
                               TLArg(m_noEyeTracking, "NoEyeTracking"),
-                              TLArg(m_useTurboMode, "TurboMode"));
+                              TLArg(m_fixedHorizontalOffset, "FixedHorizontalOffset"),
+                              TLArg(m_fixedVerticalOffset, "FixedVerticalOffset"),
+                              TLArg(m_useTurboMode, "TurboMode"),
+                              TLArg(m_pacingNumerator, "PacingNumerator"),
+                              TLArg(m_pacingDenominator, "PacingDenominator"),
+                              TLArg(m_gazeSamplingRate, "GazeSamplingRate"),
+                              TLArg(m_acquireAhead, "AcquireAhead"),
+                              TLArg(m_lowLatency, "LowLatency"),
+                              TLArg(m_lowLatencyMargin, "LowLatencyMargin"),
+                              TLArg(m_asyncSubmit, "AsyncSubmit"),
+                              TLArg(m_publishTelemetry, "Telemetry"),
+                              TLArg(m_captureEnabled, "Capture"),
+                              TLArg(m_latencyHistograms, "LatencyHistograms"),
+                              TLArg(m_flightRecorder, "FlightRecorder"),
+                              TLArg(m_stallWatchdogPeriods, "StallWatchdogPeriods"));
+
+            if (m_publishTelemetry) {
+                m_telemetry = std::make_unique<TelemetryPublisher>(GetApplicationName());
+            }
+
+            if (m_captureEnabled) {
+                StartCapture(runtimeName);
+            }
+
+            if (!m_latencyHistograms) {
+                Log("Latency histograms: disabled\n");
+            }
+            latency::SetEnabled(m_latencyHistograms);
+
+            if (m_flightRecorder) {
+                if (m_stallWatchdogPeriods) {
+                    Log(fmt::format("Flight recorder: dumping on errors and stalls over {} display periods\n",
+                                    m_stallWatchdogPeriods));
+                } else {
+                    Log("Flight recorder: dumping on errors\n");
+                }
+                recorder::Start(localAppData, m_stallWatchdogPeriods);
+            }
+
+            SelectHooks();
 
             return XR_SUCCESS;
         }
@@ -147,22 +448,36 @@ namespace {
                               TLArg(viewCapacityInput, "ViewCapacityInput"),
                               TLArg(xr::ToCString(viewConfigurationType), "ViewConfigurationType"));
 
-            // Insert the foveated configuration flag if needed.
-            std::vector<XrFoveatedViewConfigurationViewVARJO> foveatedView(
-                4, {XR_TYPE_FOVEATED_VIEW_CONFIGURATION_VIEW_VARJO});
-            if (viewConfigurationType == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO) {
+            // Insert the foveated configuration flag if needed, on copies of the app structs.
+            Arena<1024> arena;
+            XrViewConfigurationView* runtimeViews = views;
+            if (viewConfigurationType == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO && viewCapacityInput) {
                 TraceLoggingWrite(g_traceProvider,
                                   "xrEnumerateViewConfigurationViews",
                                   TLArg(!m_noEyeTracking, "FoveatedRenderingActive"));
-                for (uint32_t i = 0; i < std::min((uint32_t)foveatedView.size(), viewCapacityInput); i++) {
-                    foveatedView[i].foveatedRenderingActive = !m_noEyeTracking;
-                    foveatedView[i].next = views[i].next;
-                    views[i].next = &foveatedView[i];
+                XrViewConfigurationView* const viewsCopy = arena.Copy(views, viewCapacityInput);
+                XrFoveatedViewConfigurationViewVARJO* const foveatedViews =
+                    arena.Allocate<XrFoveatedViewConfigurationViewVARJO>(viewCapacityInput);
+                for (uint32_t i = 0; i < viewCapacityInput; i++) {
+                    foveatedViews[i] = {XR_TYPE_FOVEATED_VIEW_CONFIGURATION_VIEW_VARJO};
+                    foveatedViews[i].foveatedRenderingActive = !m_noEyeTracking;
+                    foveatedViews[i].next = views[i].next;
+                    viewsCopy[i].next = &foveatedViews[i];
                 }
+                runtimeViews = viewsCopy;
             }
 
             const XrResult result = OpenXrApi::xrEnumerateViewConfigurationViews(
-                instance, systemId, viewConfigurationType, viewCapacityInput, viewCountOutput, views);
+                instance, systemId, viewConfigurationType, viewCapacityInput, viewCountOutput, runtimeViews);
+
+            // Return the results into the app structs, with their original chain.
+            if (runtimeViews != views && XR_SUCCEEDED(result)) {
+                for (uint32_t i = 0; i < std::min(*viewCountOutput, viewCapacityInput); i++) {
+                    void* const next = views[i].next;
+                    views[i] = runtimeViews[i];
+                    views[i].next = next;
+                }
+            }
 
             if (XR_SUCCEEDED(result)) {
                 TraceLoggingWrite(
@@ -170,28 +485,101 @@ namespace {
 
                 if (viewCapacityInput) {
                     if (viewConfigurationType == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO) {
-                        // Apply resolution scaling.
-#pragma warning(push)
-#pragma warning(disable : 4244)
-                        views[0].recommendedImageRectWidth *= m_peripheralResolutionFactor;
-                        views[0].recommendedImageRectHeight *= m_peripheralResolutionFactor;
-                        views[1].recommendedImageRectWidth *= m_peripheralResolutionFactor;
-                        views[1].recommendedImageRectHeight *= m_peripheralResolutionFactor;
-                        views[2].recommendedImageRectWidth *= m_focusResolutionFactor * m_focusHorizontalScale;
-                        views[2].recommendedImageRectHeight *= m_focusResolutionFactor * m_focusVerticalScale;
-                        views[3].recommendedImageRectWidth *= m_focusResolutionFactor * m_focusHorizontalScale;
-                        views[3].recommendedImageRectHeight *= m_focusResolutionFactor * m_focusVerticalScale;
-#pragma warning(pop)
-
-                        Log(fmt::format("Peripheral resolution: {}x{} (multiplier: {:.3f})\n",
-                                        views[0].recommendedImageRectWidth,
-                                        views[0].recommendedImageRectHeight,
-                                        m_peripheralResolutionFactor));
-                        Log(fmt::format("Focus resolution {}x{} (multiplier: {:.3f}/{:.3f})\n",
-                                        views[2].recommendedImageRectWidth,
-                                        views[2].recommendedImageRectHeight,
-                                        m_focusResolutionFactor * m_focusHorizontalScale,
-                                        m_focusResolutionFactor * m_focusVerticalScale));
+                        // Apply resolution scaling, or target a pixel density once we know the field of view.
+                        XrFovf viewFovs[4];
+                        bool hasViewFovs;
+                        {
+                            std::unique_lock lock(m_viewFovsMutex);
+
+                            hasViewFovs = m_hasViewFovs;
+                            std::copy(std::begin(m_viewFovs), std::end(m_viewFovs), viewFovs);
+                        }
+                        const bool usePeripheralPixelDensity = m_peripheralPixelDensity > 0 && hasViewFovs;
+                        const bool useFocusPixelDensity = m_focusPixelDensity > 0 && hasViewFovs;
+                        if ((m_peripheralPixelDensity > 0 || m_focusPixelDensity > 0) && !hasViewFovs) {
+                            Log("Field of view is not known yet, using the multipliers\n");
+                        }
+
+                        for (uint32_t i = 0; i < 2; i++) {
+                            if (usePeripheralPixelDensity) {
+                                views[i].recommendedImageRectWidth = scaling::ResolutionForPixelDensity(
+                                    viewFovs[i].angleLeft, viewFovs[i].angleRight, 1.f, m_peripheralPixelDensity);
+                                views[i].recommendedImageRectHeight = scaling::ResolutionForPixelDensity(
+                                    viewFovs[i].angleDown, viewFovs[i].angleUp, 1.f, m_peripheralPixelDensity);
+                            } else {
+                                views[i].recommendedImageRectWidth = scaling::ScaleResolution(
+                                    views[i].recommendedImageRectWidth, m_peripheralResolutionFactor);
+                                views[i].recommendedImageRectHeight = scaling::ScaleResolution(
+                                    views[i].recommendedImageRectHeight, m_peripheralResolutionFactor);
+                            }
+                        }
+                        for (uint32_t i = 2; i < 4; i++) {
+                            if (useFocusPixelDensity) {
+                                // Account for the focus region scaling done in xrLocateViews().
+                                views[i].recommendedImageRectWidth =
+                                    scaling::ResolutionForPixelDensity(viewFovs[i].angleLeft,
+                                                                       viewFovs[i].angleRight,
+                                                                       m_focusHorizontalScale,
+                                                                       m_focusPixelDensity);
+                                views[i].recommendedImageRectHeight =
+                                    scaling::ResolutionForPixelDensity(viewFovs[i].angleDown,
+                                                                       viewFovs[i].angleUp,
+                                                                       m_focusVerticalScale,
+                                                                       m_focusPixelDensity);
+                            } else {
+                                views[i].recommendedImageRectWidth =
+                                    scaling::ScaleResolution(views[i].recommendedImageRectWidth,
+                                                             m_focusResolutionFactor * m_focusHorizontalScale);
+                                views[i].recommendedImageRectHeight =
+                                    scaling::ScaleResolution(views[i].recommendedImageRectHeight,
+                                                             m_focusResolutionFactor * m_focusVerticalScale);
+                            }
+                        }
+
+                        if (usePeripheralPixelDensity) {
+                            Log(fmt::format("Peripheral resolution: {}x{} (pixel density: {:.1f} ppd)\n",
+                                            views[0].recommendedImageRectWidth,
+                                            views[0].recommendedImageRectHeight,
+                                            m_peripheralPixelDensity));
+                        } else {
+                            Log(fmt::format("Peripheral resolution: {}x{} (multiplier: {:.3f})\n",
+                                            views[0].recommendedImageRectWidth,
+                                            views[0].recommendedImageRectHeight,
+                                            m_peripheralResolutionFactor));
+                        }
+                        if (useFocusPixelDensity) {
+                            Log(fmt::format("Focus resolution {}x{} (pixel density: {:.1f} ppd)\n",
+                                            views[2].recommendedImageRectWidth,
+                                            views[2].recommendedImageRectHeight,
+                                            m_focusPixelDensity));
+                        } else {
+                            Log(fmt::format("Focus resolution {}x{} (multiplier: {:.3f}/{:.3f})\n",
+                                            views[2].recommendedImageRectWidth,
+                                            views[2].recommendedImageRectHeight,
+                                            m_focusResolutionFactor * m_focusHorizontalScale,
+                                            m_focusResolutionFactor * m_focusVerticalScale));
+                        }
+
+                        // Apply the sample count policy. MSAA is mostly wasted in the low resolution periphery.
+                        {
+                            std::unique_lock lock(m_viewClassesMutex);
+
+                            for (uint32_t i = 0; i < 4; i++) {
+                                ViewClass& viewClass = m_viewClasses[i < 2 ? 0 : 1];
+                                viewClass.runtimeSampleCount = views[i].recommendedSwapchainSampleCount;
+
+                                const uint32_t sampleCount = i < 2 ? m_peripheralSampleCount : m_focusSampleCount;
+                                if (sampleCount) {
+                                    views[i].recommendedSwapchainSampleCount =
+                                        std::min(sampleCount, views[i].maxSwapchainSampleCount);
+                                    views[i].maxSwapchainSampleCount = views[i].recommendedSwapchainSampleCount;
+                                }
+                                viewClass.sampleCount = views[i].recommendedSwapchainSampleCount;
+                            }
+                            Log(fmt::format("Sample count: {} peripheral, {} focus\n",
+                                            m_viewClasses[0].sampleCount,
+                                            m_viewClasses[1].sampleCount));
+                        }
 
                         for (uint32_t i = 0; i < *viewCountOutput; i++) {
                             // Propagate the maximum.
@@ -227,18 +615,13 @@ namespace {
                 }
             }
 
-            // Undo our changes to the app structs.
-            if (viewConfigurationType == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO) {
-                for (uint32_t i = 0; i < std::min((uint32_t)foveatedView.size(), viewCapacityInput); i++) {
-                    views[i].next = foveatedView[i].next;
-                }
-            }
-
             return result;
         }
 
         // https://www.khronos.org/registry/OpenXR/specs/1.0/html/xrspec.html#xrCreateSwapchain
-        XrResult xrCreateSwapchain(XrSession session, const XrSwapchainCreateInfo* createInfo, XrSwapchain* swapchain) {
+        XrResult xrCreateSwapchain(XrSession session,
+                                   const XrSwapchainCreateInfo* createInfo,
+                                   XrSwapchain* swapchain) override {
             if (createInfo->type != XR_TYPE_SWAPCHAIN_CREATE_INFO) {
                 return XR_ERROR_VALIDATION_FAILURE;
             }
@@ -261,6 +644,8 @@ namespace {
 
             if (XR_SUCCEEDED(result)) {
                 TraceLoggingWrite(g_traceProvider, "xrCreateSwapchain", TLXArg(*swapchain, "Swapchain"));
+
+                RegisterSwapchainSamples(*swapchain, *createInfo);
             }
 
             return result;
@@ -271,18 +656,32 @@ namespace {
             TraceLoggingWrite(g_traceProvider, "xrDestroySwapchain", TLXArg(swapchain, "Session"));
 
             // In Turbo Mode, make sure there is no pending frame that may potentially hold onto the swapchain.
+            DrainSubmitQueue();
             {
                 std::unique_lock lock(m_frameMutex);
 
-                if (m_asyncWaitPromise.valid()) {
+                if (m_asyncWaitWorker && m_asyncWaitWorker->IsValid()) {
                     TraceLocalActivity(local);
 
                     TraceLoggingWriteStart(local, "AsyncWaitNow");
-                    m_asyncWaitPromise.wait();
+                    m_asyncWaitWorker->Wait();
                     TraceLoggingWriteStop(local, "AsyncWaitNow");
                 }
             }
 
+            UnregisterSwapchainSamples(swapchain);
+
+            // Destroying the swapchain releases the staged image, if any.
+            {
+                std::unique_lock lock(m_stagedSwapchainsMutex);
+
+                auto it = m_stagedSwapchains.find(swapchain);
+                if (it != m_stagedSwapchains.end()) {
+                    it->second->worker->Reset();
+                    m_stagedSwapchains.erase(it);
+                }
+            }
+
             return OpenXrApi::xrDestroySwapchain(swapchain);
         }
 
@@ -298,8 +697,16 @@ namespace {
                 TLXArg(session, "Session"),
                 TLArg(xr::ToCString(beginInfo->primaryViewConfigurationType), "PrimaryViewConfigurationType"));
 
+            const int64_t captureTimestamp = m_capture ? m_capture->Now() : 0;
             const XrResult result = OpenXrApi::xrBeginSession(session, beginInfo);
 
+            if (m_capture) {
+                varjo_foveated::capture::BeginSessionRecord record{};
+                record.session = (uint64_t)session;
+                record.primaryViewConfigurationType = beginInfo->primaryViewConfigurationType;
+                m_capture->Write(RecordType::BeginSession, captureTimestamp, result, record);
+            }
+
             if (XR_SUCCEEDED(result)) {
                 if (beginInfo->primaryViewConfigurationType == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO) {
                     Log("Application is using Quad Views for this session.\n");
@@ -308,27 +715,115 @@ namespace {
                 }
             }
 
-            m_initialized = false;
+            if (XR_SUCCEEDED(result)) {
+                SessionState* const state = ClaimSession(session);
+                if (state && !m_noEyeTracking &&
+                    beginInfo->primaryViewConfigurationType == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO &&
+                    state->renderGazeSpace == XR_NULL_HANDLE) {
+                    CreateGazeSpaces(session, *state);
+                }
+                if (state) {
+                    ResumeGazeSampler(*state);
+                }
+            }
+            m_gazeQuality.Reset();
+            m_gazeLatency.Reset();
 
             return result;
         }
 
+        // https://www.khronos.org/registry/OpenXR/specs/1.0/html/xrspec.html#xrEndSession
+        XrResult xrEndSession(XrSession session) override {
+            TraceLoggingWrite(g_traceProvider, "xrEndSession", TLXArg(session, "Session"));
+
+            // Nothing may run on behalf of the session past this point.
+            DrainSessionWork();
+            LogGazeQuality();
+            LogGazeLatency();
+
+            return OpenXrApi::xrEndSession(session);
+        }
+
         // https://www.khronos.org/registry/OpenXR/specs/1.0/html/xrspec.html#xrDestroySession
         XrResult xrDestroySession(XrSession session) override {
             TraceLoggingWrite(g_traceProvider, "xrDestroySession", TLXArg(session, "Session"));
 
-            // Wait for deferred frames to finish before teardown.
-            if (m_asyncWaitPromise.valid()) {
+            recorder::SetDisplayPeriod(0);
+
+            // Wait for deferred frames to finish before teardown. This is normally already done by xrEndSession(),
+            // unless the application did not end the session.
+            DrainSubmitQueue();
+            if (m_asyncWaitWorker && m_asyncWaitWorker->IsValid()) {
                 TraceLocalActivity(local);
 
                 TraceLoggingWriteStart(local, "AsyncWaitNow");
-                m_asyncWaitPromise.wait_for(5s);
-                TraceLoggingWriteStop(local, "AsyncWaitNow");
+                const bool ready = m_asyncWaitWorker->WaitFor(5s);
+                TraceLoggingWriteStop(local, "AsyncWaitNow", TLArg(ready, "Ready"));
+
+                if (ready) {
+                    m_asyncWaitWorker->Reset();
+                }
+            }
 
-                m_asyncWaitPromise = {};
+            {
+                std::unique_lock lock(m_resourcesMutex);
+                StopGazeSampler();
+            }
+            LogGazeQuality();
+            LogGazeLatency();
+            m_sessionState.store(XR_SESSION_STATE_UNKNOWN, std::memory_order_relaxed);
+
+            // The sampler is stopped, nothing else uses the session state past this point.
+            if (SessionState* const state = FindSession(session)) {
+                ReleaseSession(*state);
+            }
+
+            const int64_t captureTimestamp = m_capture ? m_capture->Now() : 0;
+            const XrResult result = OpenXrApi::xrDestroySession(session);
+
+            if (m_capture) {
+                varjo_foveated::capture::DestroySessionRecord record{};
+                record.session = (uint64_t)session;
+                m_capture->Write(RecordType::DestroySession, captureTimestamp, result, record);
+            }
+
+            return result;
+        }
+
+        // https://www.khronos.org/registry/OpenXR/specs/1.0/html/xrspec.html#xrPollEvent
+        XrResult xrPollEvent(XrInstance instance, XrEventDataBuffer* eventData) override {
+            const XrResult result = OpenXrApi::xrPollEvent(instance, eventData);
+
+            if (result == XR_SUCCESS && eventData->type == XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED) {
+                const XrEventDataSessionStateChanged* event =
+                    reinterpret_cast<const XrEventDataSessionStateChanged*>(eventData);
+                TraceLoggingWrite(g_traceProvider,
+                                  "xrPollEvent",
+                                  TLXArg(event->session, "Session"),
+                                  TLArg(xr::ToCString(event->state), "State"),
+                                  TLArg(event->time, "Time"));
+
+                const bool wasVisible = IsSessionVisible();
+                m_sessionState.store(event->state, std::memory_order_relaxed);
+                if (wasVisible && !IsSessionVisible()) {
+                    Log(fmt::format("Session is {}, parking the frame work\n", xr::ToCString(event->state)));
+
+                    // The runtime may now hold the app for long, which is not a stall.
+                    recorder::SetDisplayPeriod(0);
+
+                    // Turbo Mode and the swapchain staging stop at the next frame submission.
+                    std::unique_lock lock(m_resourcesMutex);
+                    StopGazeSampler();
+                } else if (!wasVisible && IsSessionVisible()) {
+                    Log(fmt::format("Session is {}, resuming the frame work\n", xr::ToCString(event->state)));
+
+                    if (SessionState* const state = FindSession(event->session)) {
+                        ResumeGazeSampler(*state);
+                    }
+                }
             }
 
-            return OpenXrApi::xrDestroySession(session);
+            return result;
         }
 
         // https://www.khronos.org/registry/OpenXR/specs/1.0/html/xrspec.html#xrLocateViews
@@ -350,46 +845,94 @@ namespace {
                               TLXArg(viewLocateInfo->space, "Space"),
                               TLArg(viewCapacityInput, "ViewCapacityInput"));
 
-            // Insert the foveated location flag if needed.
+            const int64_t captureTimestamp = m_capture ? m_capture->Now() : 0;
+
+            // Insert the foveated location flag if needed, on a copy of the app struct.
+            XrViewLocateInfo runtimeViewLocateInfo = *viewLocateInfo;
             XrViewLocateFoveatedRenderingVARJO viewLocateFoveatedRendering{
                 XR_TYPE_VIEW_LOCATE_FOVEATED_RENDERING_VARJO};
+            XrSpaceLocation renderGazeLocation{XR_TYPE_SPACE_LOCATION};
+            XrTime gazeTime = viewLocateInfo->displayTime;
+            SessionState* const sessionState = FindSession(session);
+            bool foveationLost = false;
             if (viewLocateInfo->viewConfigurationType == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO) {
                 bool foveationActive = false;
-                if (!m_noEyeTracking) {
-                    {
-                        std::unique_lock lock(m_resourcesMutex);
-
-                        if (!m_initialized) {
-                            XrReferenceSpaceCreateInfo spaceInfo{XR_TYPE_REFERENCE_SPACE_CREATE_INFO};
-                            spaceInfo.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_VIEW;
-                            spaceInfo.poseInReferenceSpace = xr::math::Pose::Identity();
-                            CHECK_XRCMD(OpenXrApi::xrCreateReferenceSpace(session, &spaceInfo, &m_viewSpace));
-
-                            spaceInfo.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_COMBINED_EYE_VARJO;
-                            spaceInfo.poseInReferenceSpace = xr::math::Pose::Identity();
-                            CHECK_XRCMD(OpenXrApi::xrCreateReferenceSpace(session, &spaceInfo, &m_renderGazeSpace));
+                if (!m_noEyeTracking && sessionState && sessionState->renderGazeSpace != XR_NULL_HANDLE) {
+                    if (m_gazeSamplingRate) {
+                        // Where the sampler places its samples on the XrTime timeline.
+                        m_gazeSamplerAnchorTimestamp.store(std::chrono::steady_clock::now(), std::memory_order_relaxed);
+                        m_gazeSamplerAnchorTime.store(viewLocateInfo->displayTime, std::memory_order_release);
+                    }
 
-                            m_initialized = true;
+                    // Use the most recent gaze sample when available, rather than waiting on the eye tracker. The
+                    // sampler is stopped while the session is not visible, and it may fall behind when starved of CPU:
+                    // a sample older than 2 sampler periods is not used.
+                    GazeSample gazeSample;
+                    bool useGazeSample = false;
+                    if (m_gazeSamplingRate && m_gazeSamples.Latest(gazeSample)) {
+                        const auto maxAge = std::chrono::nanoseconds(2'000'000'000 / m_gazeSamplingRate);
+                        useGazeSample = std::chrono::steady_clock::now() - gazeSample.timestamp <= maxAge;
+                        if (!useGazeSample) {
+                            TraceLoggingWrite(g_traceProvider,
+                                              "xrLocateViews_StaleGazeSample",
+                                              TLArg(gazeSample.time, "SampleTime"));
                         }
                     }
-
-                    XrSpaceLocation renderGazeLocation{XR_TYPE_SPACE_LOCATION};
-                    CHECK_XRCMD(OpenXrApi::xrLocateSpace(
-                        m_renderGazeSpace, m_viewSpace, viewLocateInfo->displayTime, &renderGazeLocation));
+                    if (useGazeSample) {
+                        renderGazeLocation.locationFlags = gazeSample.flags;
+                        renderGazeLocation.pose = gazeSample.pose;
+                        gazeTime = gazeSample.time;
+                    } else {
+                        CHECK_XRCMD_RETURN(OpenXrApi::xrLocateSpace(sessionState->renderGazeSpace,
+                                                                    sessionState->viewSpace,
+                                                                    viewLocateInfo->displayTime,
+                                                                    &renderGazeLocation));
+                        gazeTime = GetGazeAcquisitionTime(viewLocateInfo->displayTime);
+                        m_gazeQuality.AddSample(gazeTime, renderGazeLocation.locationFlags, renderGazeLocation.pose);
+                    }
                     foveationActive =
                         (renderGazeLocation.locationFlags & XR_SPACE_LOCATION_ORIENTATION_TRACKED_BIT) != 0;
 
                     viewLocateFoveatedRendering.foveatedRenderingActive = foveationActive;
+                    foveationLost = !foveationActive;
                 }
 
                 TraceLoggingWrite(g_traceProvider, "xrLocateViews", TLArg(foveationActive, "FoveationActive"));
 
+                if (m_liveStats.foveationActive.exchange(foveationActive, std::memory_order_relaxed) !=
+                    foveationActive) {
+                    recorder::Record(recorder::EventType::Foveation, foveationActive);
+                }
+                m_liveStats.locateViewsCount.fetch_add(1, std::memory_order_relaxed);
+                if (foveationActive) {
+                    m_liveStats.foveatedLocateViewsCount.fetch_add(1, std::memory_order_relaxed);
+                }
+
                 viewLocateFoveatedRendering.next = viewLocateInfo->next;
-                const_cast<XrViewLocateInfo*>(viewLocateInfo)->next = &viewLocateFoveatedRendering;
+                runtimeViewLocateInfo.next = &viewLocateFoveatedRendering;
             }
 
-            const XrResult result =
-                OpenXrApi::xrLocateViews(session, viewLocateInfo, viewState, viewCapacityInput, viewCountOutput, views);
+            const XrResult result = OpenXrApi::xrLocateViews(
+                session, &runtimeViewLocateInfo, viewState, viewCapacityInput, viewCountOutput, views);
+
+            // Record the views before we modify them.
+            varjo_foveated::capture::LocateViewsRecord captureRecord{};
+            if (m_capture) {
+                captureRecord.session = (uint64_t)session;
+                captureRecord.space = (uint64_t)viewLocateInfo->space;
+                captureRecord.displayTime = viewLocateInfo->displayTime;
+                captureRecord.viewConfigurationType = viewLocateInfo->viewConfigurationType;
+                captureRecord.gazeLocationFlags = static_cast<uint32_t>(renderGazeLocation.locationFlags);
+                captureRecord.gazePose = renderGazeLocation.pose;
+                if (XR_SUCCEEDED(result) && viewCapacityInput) {
+                    captureRecord.viewStateFlags = viewState->viewStateFlags;
+                    captureRecord.viewCount = std::min(*viewCountOutput, varjo_foveated::capture::MaxViewCount);
+                    for (uint32_t i = 0; i < captureRecord.viewCount; i++) {
+                        captureRecord.views[i].pose = views[i].pose;
+                        captureRecord.views[i].fov = views[i].fov;
+                    }
+                }
+            }
 
             if (XR_SUCCEEDED(result)) {
                 TraceLoggingWrite(g_traceProvider,
@@ -399,32 +942,61 @@ namespace {
 
                 if (viewCapacityInput) {
                     if (viewLocateInfo->viewConfigurationType == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO) {
+                        // Without the gaze, the runtime falls back to wider focus views for a few frames (eg: on a
+                        // blink). These are not the views the app renders with, so they are not remembered.
+                        if (!foveationLost) {
+                            UpdateViewFovs(views);
+                        }
+
                         // Apply focus region scaling.
-                        const auto scaleFov = [](float angleLower, float angleUpper, float scale) {
-                            const float angleCenter = (angleLower + angleUpper) / 2;
-                            const float angleSpread = angleUpper - angleLower;
-                            const float angleSpreadScaled = angleSpread * scale;
-                            const float angleLowerScaled = angleCenter - (angleSpreadScaled / 2);
-                            const float angleUpperScaled = angleCenter + (angleSpreadScaled / 2);
-
-                            return std::make_pair(angleLowerScaled, angleUpperScaled);
-                        };
                         std::tie(views[2].fov.angleDown, views[2].fov.angleUp) =
-                            scaleFov(views[2].fov.angleDown, views[2].fov.angleUp, m_focusVerticalScale);
+                            scaling::ScaleFov(views[2].fov.angleDown, views[2].fov.angleUp, m_focusVerticalScale);
                         std::tie(views[2].fov.angleLeft, views[2].fov.angleRight) =
-                            scaleFov(views[2].fov.angleLeft, views[2].fov.angleRight, m_focusHorizontalScale);
+                            scaling::ScaleFov(views[2].fov.angleLeft, views[2].fov.angleRight, m_focusHorizontalScale);
                         std::tie(views[3].fov.angleDown, views[3].fov.angleUp) =
-                            scaleFov(views[3].fov.angleDown, views[3].fov.angleUp, m_focusVerticalScale);
+                            scaling::ScaleFov(views[3].fov.angleDown, views[3].fov.angleUp, m_focusVerticalScale);
                         std::tie(views[3].fov.angleLeft, views[3].fov.angleRight) =
-                            scaleFov(views[3].fov.angleLeft, views[3].fov.angleRight, m_focusHorizontalScale);
-
-                        std::unique_lock lock(m_focusFovMutex);
+                            scaling::ScaleFov(views[3].fov.angleLeft, views[3].fov.angleRight, m_focusHorizontalScale);
+
+                        // Move the fixed focus region, within the peripheral view of the same eye. The angular size
+                        // does not change, so neither does the resolution.
+                        if (m_noEyeTracking && (m_fixedHorizontalOffset || m_fixedVerticalOffset)) {
+                            const float horizontalOffset = m_fixedHorizontalOffset / scaling::DegreesPerRadian;
+                            const float verticalOffset = m_fixedVerticalOffset / scaling::DegreesPerRadian;
+                            for (uint32_t i = 2; i < 4; i++) {
+                                const XrFovf& bounds = views[i - 2].fov;
+                                std::tie(views[i].fov.angleLeft, views[i].fov.angleRight) =
+                                    scaling::OffsetFov(views[i].fov.angleLeft,
+                                                       views[i].fov.angleRight,
+                                                       horizontalOffset,
+                                                       bounds.angleLeft,
+                                                       bounds.angleRight);
+                                std::tie(views[i].fov.angleDown, views[i].fov.angleUp) =
+                                    scaling::OffsetFov(views[i].fov.angleDown,
+                                                       views[i].fov.angleUp,
+                                                       verticalOffset,
+                                                       bounds.angleDown,
+                                                       bounds.angleUp);
+                            }
+                        }
 
-                        m_focusFovForDisplayTime.insert_or_assign(viewLocateInfo->displayTime,
-                                                                  std::make_pair(views[2].fov, views[3].fov));
-                        TraceLoggingWrite(g_traceProvider,
-                                          "xrLocateViews",
-                                          TLArg(m_focusFovForDisplayTime.size(), "FovForDisplayTimeDictionarySize"));
+                        if (sessionState) {
+                            std::unique_lock lock(sessionState->focusFovMutex);
+
+                            if (m_focusQuantization > 0) {
+                                QuantizeFocusFovs(*sessionState, views);
+                            }
+
+                            FocusFovEntry* entry = FindFocusFov(*sessionState, viewLocateInfo->displayTime);
+                            if (!entry) {
+                                entry = &sessionState->focusFovHistory[sessionState->nextFocusFovEntry];
+                                sessionState->nextFocusFovEntry =
+                                    (sessionState->nextFocusFovEntry + 1) % std::size(sessionState->focusFovHistory);
+                            }
+                            entry->displayTime = viewLocateInfo->displayTime;
+                            entry->fovs = std::make_pair(views[2].fov, views[3].fov);
+                            entry->gazeTime = viewLocateFoveatedRendering.foveatedRenderingActive ? gazeTime : 0;
+                        }
                     }
 
                     if (IsTraceEnabled()) {
@@ -438,9 +1010,8 @@ namespace {
                 }
             }
 
-            // Undo our changes to the app structs.
-            if (viewLocateInfo->viewConfigurationType == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO) {
-                const_cast<XrViewLocateInfo*>(viewLocateInfo)->next = viewLocateFoveatedRendering.next;
+            if (m_capture) {
+                m_capture->Write(RecordType::LocateViews, captureTimestamp, result, captureRecord);
             }
 
             return result;
@@ -452,10 +1023,50 @@ namespace {
                                          uint32_t* index) override {
             TraceLoggingWrite(g_traceProvider, "xrAcquireSwapchainImage", TLXArg(swapchain, "Swapchain"));
 
-            const XrResult result = OpenXrApi::xrAcquireSwapchainImage(swapchain, acquireInfo, index);
+            const int64_t captureTimestamp = m_capture ? m_capture->Now() : 0;
+
+            StagedSwapchain* const staged = FindStagedSwapchain(swapchain);
+            XrResult result = XR_ERROR_RUNTIME_FAILURE;
+            bool useStagedImage = false;
+            if (staged && staged->worker->IsValid()) {
+                TraceLocalActivity(local);
+
+                TraceLoggingWriteStart(local, "StagedImageWait");
+                staged->worker->Reset();
+                TraceLoggingWriteStop(local,
+                                      "StagedImageWait",
+                                      TLArg(xr::ToCString(staged->acquireResult), "AcquireResult"),
+                                      TLArg(xr::ToCString(staged->waitResult), "WaitResult"));
+
+                // If the staged acquire failed, nothing was acquired and the application's call is forwarded.
+                useStagedImage = XR_SUCCEEDED(staged->acquireResult);
+            }
+
+            if (useStagedImage) {
+                result = staged->acquireResult;
+                *index = staged->index;
+                staged->waitPending = staged->waitResult == XR_SUCCESS;
+            } else {
+                result = OpenXrApi::xrAcquireSwapchainImage(swapchain, acquireInfo, index);
+            }
 
             if (XR_SUCCEEDED(result)) {
-                TraceLoggingWrite(g_traceProvider, "xrAcquireSwapchainImage", TLArg(*index, "Index"));
+                TraceLoggingWrite(g_traceProvider,
+                                  "xrAcquireSwapchainImage",
+                                  TLArg(*index, "Index"),
+                                  TLArg(useStagedImage, "Staged"));
+
+                if (staged) {
+                    staged->acquiredImageCount++;
+                }
+            }
+
+            if (m_capture) {
+                CaptureSwapchainImage(RecordType::AcquireSwapchainImage,
+                                      captureTimestamp,
+                                      result,
+                                      swapchain,
+                                      XR_SUCCEEDED(result) ? *index : 0);
             }
 
             return result;
@@ -472,7 +1083,23 @@ namespace {
                               TLXArg(swapchain, "Swapchain"),
                               TLArg(waitInfo->timeout, "Timeout"));
 
-            return OpenXrApi::xrWaitSwapchainImage(swapchain, waitInfo);
+            const int64_t captureTimestamp = m_capture ? m_capture->Now() : 0;
+
+            // The staged image was already waited.
+            StagedSwapchain* const staged = FindStagedSwapchain(swapchain);
+            XrResult result = XR_SUCCESS;
+            if (staged && staged->waitPending) {
+                staged->waitPending = false;
+                TraceLoggingWrite(g_traceProvider, "xrWaitSwapchainImage", TLArg(true, "Staged"));
+            } else {
+                result = OpenXrApi::xrWaitSwapchainImage(swapchain, waitInfo);
+            }
+
+            if (m_capture) {
+                CaptureSwapchainImage(RecordType::WaitSwapchainImage, captureTimestamp, result, swapchain);
+            }
+
+            return result;
         }
 
         // https://www.khronos.org/registry/OpenXR/specs/1.0/html/xrspec.html#xrReleaseSwapchainImage
@@ -480,7 +1107,27 @@ namespace {
                                          const XrSwapchainImageReleaseInfo* releaseInfo) override {
             TraceLoggingWrite(g_traceProvider, "xrReleaseSwapchainImage", TLXArg(swapchain, "Swapchain"));
 
-            return OpenXrApi::xrReleaseSwapchainImage(swapchain, releaseInfo);
+            if (m_asyncSubmit) {
+                WaitForSwapchainSubmission(swapchain);
+            }
+
+            const int64_t captureTimestamp = m_capture ? m_capture->Now() : 0;
+            const XrResult result = OpenXrApi::xrReleaseSwapchainImage(swapchain, releaseInfo);
+
+            // Stage the next image once the application holds no more images.
+            StagedSwapchain* const staged = FindStagedSwapchain(swapchain);
+            if (staged && XR_SUCCEEDED(result)) {
+                staged->acquiredImageCount = std::max(staged->acquiredImageCount, 1u) - 1;
+                if (!staged->acquiredImageCount && IsSessionVisible()) {
+                    staged->worker->Start();
+                }
+            }
+
+            if (m_capture) {
+                CaptureSwapchainImage(RecordType::ReleaseSwapchainImage, captureTimestamp, result, swapchain);
+            }
+
+            return result;
         }
 
         // https://www.khronos.org/registry/OpenXR/specs/1.0/html/xrspec.html#xrWaitFrame
@@ -489,14 +1136,17 @@ namespace {
                              XrFrameState* frameState) override {
             TraceLoggingWrite(g_traceProvider, "xrWaitFrame", TLXArg(session, "Session"));
 
+            const int64_t captureTimestamp = m_capture ? m_capture->Now() : 0;
+
             const auto lastFrameWaitTimestamp = m_lastFrameWaitTimestamp;
             m_lastFrameWaitTimestamp = std::chrono::steady_clock::now();
 
             XrResult result = XR_ERROR_RUNTIME_FAILURE;
+            XrDuration pacingDelay = 0;
             {
                 std::unique_lock lock(m_frameMutex);
 
-                if (m_asyncWaitPromise.valid()) {
+                if (IsTurboPipelined()) {
                     TraceLoggingWrite(g_traceProvider, "AsyncWaitMode");
 
                     // In Turbo mode, we accept pipelining of exactly one frame.
@@ -505,7 +1155,8 @@ namespace {
 
                         // On second frame poll, we must wait.
                         TraceLoggingWriteStart(local, "AsyncWaitNow");
-                        m_asyncWaitPromise.wait();
+                        DrainSubmitQueue();
+                        m_asyncWaitWorker->Wait();
                         TraceLoggingWriteStop(local, "AsyncWaitNow");
                     }
                     m_asyncWaitPolled = true;
@@ -514,29 +1165,66 @@ namespace {
                     {
                         std::unique_lock lock(m_asyncWaitMutex);
 
+                        // While a frame is queued, the wait for this frame is not started yet.
+                        const bool completed =
+                            m_asyncWaitCompleted && !m_isFrameQueued.load(std::memory_order_acquire);
                         frameState->predictedDisplayTime =
-                            m_asyncWaitCompleted ? m_lastPredictedDisplayTime
-                                                 : (m_lastPredictedDisplayTime +
-                                                    (m_lastFrameWaitTimestamp - lastFrameWaitTimestamp).count());
+                            completed ? m_lastPredictedDisplayTime
+                                      : (m_lastPredictedDisplayTime +
+                                         (m_lastFrameWaitTimestamp - lastFrameWaitTimestamp).count());
                         frameState->predictedDisplayPeriod = m_lastPredictedDisplayPeriod;
+
+                        if (!completed) {
+                            m_liveStats.madeUpFrameCount.fetch_add(1, std::memory_order_relaxed);
+                        }
+                        m_liveStats.runtimePredictedDisplayTime.store(m_lastPredictedDisplayTime,
+                                                                      std::memory_order_relaxed);
                     }
                     frameState->shouldRender = XR_TRUE;
+                    SetTurboState(XR_FOVEATED_TURBO_STATE_PIPELINED_MBUCCHIA);
 
                     result = XR_SUCCESS;
 
                 } else {
                     lock.unlock();
+                    const int64_t runtimeCaptureTimestamp = m_capture ? m_capture->Now() : 0;
                     result = OpenXrApi::xrWaitFrame(session, frameWaitInfo, frameState);
+                    if (m_capture) {
+                        CaptureWaitFrame(
+                            RecordType::RuntimeWaitFrame, runtimeCaptureTimestamp, result, session, *frameState);
+                    }
                     lock.lock();
 
                     if (XR_SUCCEEDED(result)) {
                         // We must always store those values to properly handle transitions into Turbo Mode.
                         m_lastPredictedDisplayTime = frameState->predictedDisplayTime;
                         m_lastPredictedDisplayPeriod = frameState->predictedDisplayPeriod;
+
+                        m_liveStats.runtimePredictedDisplayTime.store(frameState->predictedDisplayTime,
+                                                                      std::memory_order_relaxed);
+
+                        const XrDuration runtimePeriod = frameState->predictedDisplayPeriod;
+                        if (IsFramePacingEnabled()) {
+                            pacingDelay = PaceFrame(frameState);
+                        }
+                        if (m_lowLatency) {
+                            pacingDelay +=
+                                PaceLowLatency(pacingDelay, frameState->predictedDisplayTime, runtimePeriod);
+                        }
                     }
+                    SetTurboState(m_useTurboMode ? XR_FOVEATED_TURBO_STATE_SYNCHRONOUS_MBUCCHIA
+                                                 : XR_FOVEATED_TURBO_STATE_DISABLED_MBUCCHIA);
                 }
             }
 
+            // Hold the app outside of the lock, so its other threads may submit the previous frame.
+            if (pacingDelay > 0) {
+                WaitForPacing(pacingDelay);
+            }
+            if (m_lowLatency) {
+                m_lowLatencyReleaseTimestamp = std::chrono::steady_clock::now();
+            }
+
             if (XR_SUCCEEDED(result)) {
                 // Per OpenXR spec, the predicted display must increase monotonically.
                 frameState->predictedDisplayTime = std::max(frameState->predictedDisplayTime, m_waitedFrameTime + 1);
@@ -544,6 +1232,14 @@ namespace {
                 // Record the predicted display time.
                 m_waitedFrameTime = frameState->predictedDisplayTime;
 
+                m_liveStats.predictedDisplayTime.store(frameState->predictedDisplayTime, std::memory_order_relaxed);
+                m_liveStats.predictedDisplayPeriod.store(frameState->predictedDisplayPeriod, std::memory_order_relaxed);
+
+                recorder::Record(recorder::EventType::WaitedDisplayTime, frameState->predictedDisplayTime);
+                if (IsSessionVisible()) {
+                    recorder::SetDisplayPeriod(frameState->predictedDisplayPeriod);
+                }
+
                 TraceLoggingWrite(g_traceProvider,
                                   "xrWaitFrame",
                                   TLArg(!!frameState->shouldRender, "ShouldRender"),
@@ -551,6 +1247,10 @@ namespace {
                                   TLArg(frameState->predictedDisplayPeriod, "PredictedDisplayPeriod"));
             }
 
+            if (m_capture) {
+                CaptureWaitFrame(RecordType::WaitFrame, captureTimestamp, result, session, *frameState);
+            }
+
             return result;
         }
 
@@ -558,11 +1258,15 @@ namespace {
         XrResult xrBeginFrame(XrSession session, const XrFrameBeginInfo* frameBeginInfo) override {
             TraceLoggingWrite(g_traceProvider, "xrBeginFrame", TLXArg(session, "Session"));
 
+            const int64_t captureTimestamp = m_capture ? m_capture->Now() : 0;
+
             XrResult result = XR_ERROR_RUNTIME_FAILURE;
             {
                 std::unique_lock lock(m_frameMutex);
 
-                if (m_asyncWaitPromise.valid()) {
+                // The frame is submitted asynchronously only if the runtime's xrBeginFrame() is deferred.
+                m_frameBegunPipelined = IsTurboPipelined();
+                if (m_frameBegunPipelined) {
                     // In turbo mode, we do nothing here.
                     TraceLoggingWrite(g_traceProvider, "AsyncWaitMode");
                     result = XR_SUCCESS;
@@ -571,6 +1275,12 @@ namespace {
                 }
             }
 
+            if (m_capture) {
+                varjo_foveated::capture::BeginFrameRecord record{};
+                record.session = (uint64_t)session;
+                m_capture->Write(RecordType::BeginFrame, captureTimestamp, result, record);
+            }
+
             return result;
         }
 
@@ -587,11 +1297,80 @@ namespace {
                               TLArg(xr::ToCString(frameEndInfo->environmentBlendMode), "EnvironmentBlendMode"),
                               TLArg(frameEndInfo->layerCount, "LayerCount"));
 
-            for (uint32_t i = 0; i < frameEndInfo->layerCount; i++) {
-                if (!frameEndInfo->layers[i]) {
-                    return XR_ERROR_LAYER_INVALID;
+            recorder::Record(recorder::EventType::SubmittedDisplayTime, frameEndInfo->displayTime);
+
+            // Without xrWaitFrame(), the display period for the watchdog and the telemetry is inferred from the
+            // submitted frames. A skipped vsync only makes the watchdog more lenient for one frame.
+            if (m_isWaitFrameBypassed) {
+                const XrDuration displayTimeDelta = frameEndInfo->displayTime - m_lastSubmittedDisplayTime;
+                if (m_lastSubmittedDisplayTime && displayTimeDelta > 0) {
+                    m_liveStats.predictedDisplayPeriod.store(displayTimeDelta, std::memory_order_relaxed);
+                    if (IsSessionVisible()) {
+                        recorder::SetDisplayPeriod(displayTimeDelta);
+                    }
+                }
+                m_lastSubmittedDisplayTime = frameEndInfo->displayTime;
+            }
+
+            const int64_t captureTimestamp = m_capture ? m_capture->Now() : 0;
+
+            // The layers are copied and patched below, so they must be valid.
+            XrResult validationResult = XR_SUCCESS;
+            if (frameEndInfo->layerCount && !frameEndInfo->layers) {
+                validationResult = XR_ERROR_VALIDATION_FAILURE;
+            }
+            for (uint32_t i = 0; XR_SUCCEEDED(validationResult) && i < frameEndInfo->layerCount; i++) {
+                const XrCompositionLayerBaseHeader* const layer = frameEndInfo->layers[i];
+                if (!layer) {
+                    validationResult = XR_ERROR_LAYER_INVALID;
+                } else if (layer->type == XR_TYPE_COMPOSITION_LAYER_PROJECTION) {
+                    const XrCompositionLayerProjection* proj =
+                        reinterpret_cast<const XrCompositionLayerProjection*>(layer);
+                    if (proj->viewCount && !proj->views) {
+                        validationResult = XR_ERROR_VALIDATION_FAILURE;
+                    }
+                }
+            }
+
+            if (m_capture) {
+                CaptureWriter::SerializeEndFrame(session, frameEndInfo, m_captureEndFrameBuffer);
+            }
+
+            if (XR_FAILED(validationResult)) {
+                if (m_capture) {
+                    m_capture->Write(RecordType::EndFrame,
+                                     captureTimestamp,
+                                     validationResult,
+                                     m_captureEndFrameBuffer.data(),
+                                     m_captureEndFrameBuffer.size());
+                }
+                return validationResult;
+            }
+
+            bool patchFocusFov = false;
+            std::pair<XrFovf, XrFovf> focusFov;
+            XrTime gazeTime = 0;
+            if (SessionState* const state = FindSession(session)) {
+                std::unique_lock lock(state->focusFovMutex);
+
+                const FocusFovEntry* const entry = FindFocusFov(*state, frameEndInfo->displayTime);
+                if (entry) {
+                    patchFocusFov = true;
+                    focusFov = entry->fovs;
+                    gazeTime = entry->gazeTime;
+                } else if (state->renderGazeSpace != XR_NULL_HANDLE &&
+                           m_liveStats.foveationActive.load(std::memory_order_relaxed)) {
+                    m_gazeLatency.AddUnmatchedFrame();
                 }
+            }
 
+            // Submit copies of the app structs, built in the frame arena, with the patched FOV.
+            m_frameArena.Reset();
+            XrFrameEndInfo runtimeFrameEndInfo = *frameEndInfo;
+            const XrCompositionLayerBaseHeader** runtimeLayers =
+                m_frameArena.Copy(frameEndInfo->layers, frameEndInfo->layerCount);
+
+            for (uint32_t i = 0; i < frameEndInfo->layerCount; i++) {
                 if (frameEndInfo->layers[i]->type == XR_TYPE_COMPOSITION_LAYER_PROJECTION) {
                     const XrCompositionLayerProjection* proj =
                         reinterpret_cast<const XrCompositionLayerProjection*>(frameEndInfo->layers[i]);
@@ -603,107 +1382,1332 @@ namespace {
                                       TLXArg(proj->space, "Space"),
                                       TLArg(proj->viewCount, "ViewCount"));
 
-                    for (uint32_t eye = 0; eye < proj->viewCount; eye++) {
-                        XrFovf originalFov = proj->views[eye].fov;
+                    if (proj->viewCount >= 4) {
+                        NoteViewSwapchains(proj->views);
+                    }
 
-                        // Patch the FOV for the focus views if possible.
-                        const auto& cit = m_focusFovForDisplayTime.find(frameEndInfo->displayTime);
-                        if (cit != m_focusFovForDisplayTime.cend() && (eye == 2 || eye == 3)) {
-                            ((XrCompositionLayerProjectionView*)proj->views)[eye].fov =
-                                eye == 2 ? cit->second.first : cit->second.second;
-                        }
+                    // Patch the FOV for the focus views if possible.
+                    const XrCompositionLayerProjectionView* views = proj->views;
+                    if (patchFocusFov && proj->viewCount >= 4) {
+                        XrCompositionLayerProjection* const projCopy = m_frameArena.Copy(proj);
+                        XrCompositionLayerProjectionView* const viewsCopy =
+                            m_frameArena.Copy(proj->views, proj->viewCount);
+                        viewsCopy[2].fov = focusFov.first;
+                        viewsCopy[3].fov = focusFov.second;
+                        projCopy->views = viewsCopy;
+                        runtimeLayers[i] = reinterpret_cast<const XrCompositionLayerBaseHeader*>(projCopy);
+                        views = viewsCopy;
+                    }
 
+                    for (uint32_t eye = 0; eye < proj->viewCount; eye++) {
                         TraceLoggingWrite(g_traceProvider,
                                           "xrEndFrame_View",
                                           TLArg("Projection", "Type"),
                                           TLArg(eye, "Index"),
-                                          TLXArg(proj->views[eye].subImage.swapchain, "Swapchain"),
-                                          TLArg(proj->views[eye].subImage.imageArrayIndex, "ImageArrayIndex"),
-                                          TLArg(xr::ToString(proj->views[eye].subImage.imageRect).c_str(), "ImageRect"),
-                                          TLArg(xr::ToString(proj->views[eye].pose).c_str(), "Pose"),
-                                          TLArg(xr::ToString(proj->views[eye].fov).c_str(), "Fov"),
-                                          TLArg(xr::ToString(originalFov).c_str(), "UnpatchedFov"));
+                                          TLXArg(views[eye].subImage.swapchain, "Swapchain"),
+                                          TLArg(views[eye].subImage.imageArrayIndex, "ImageArrayIndex"),
+                                          TLArg(xr::ToString(views[eye].subImage.imageRect).c_str(), "ImageRect"),
+                                          TLArg(xr::ToString(views[eye].pose).c_str(), "Pose"),
+                                          TLArg(xr::ToString(views[eye].fov).c_str(), "Fov"),
+                                          TLArg(xr::ToString(proj->views[eye].fov).c_str(), "UnpatchedFov"));
                     }
                 }
             }
 
+            runtimeFrameEndInfo.layers = runtimeLayers;
+
+            // The frame is still submitted in full, but the heap was used in the frame loop.
+            if (m_frameArena.HasOverflowed()) {
+                TraceLoggingWrite(
+                    g_traceProvider, "FrameArenaExhausted", TLArg(frameEndInfo->layerCount, "LayerCount"));
+                if (!m_frameArenaOverflowLogged) {
+                    Log(fmt::format("Frame arena exhausted by {} layers, using the heap\n", frameEndInfo->layerCount));
+                    m_frameArenaOverflowLogged = true;
+                }
+            }
+
             XrResult result;
             {
                 std::unique_lock lock(m_frameMutex);
 
-                if (m_asyncWaitPromise.valid()) {
-                    TraceLocalActivity(local);
-
-                    // This is the latest point we must have fully waited a frame before proceeding.
-                    //
-                    // Note: we should not wait infinitely here, however certain patterns of engine calls may cause us
-                    // to attempt a "double xrWaitFrame" when turning on Turbo. Use a timeout to detect that, and
-                    // refrain from enqueing a second wait further down. This isn't a pretty solution, but it is simple
-                    // and it seems to work effectively (minus the 1s freeze observed in-game).
-                    TraceLoggingWriteStart(local, "AsyncWaitNow");
-                    const auto ready = m_asyncWaitPromise.wait_for(1s) == std::future_status::ready;
-                    TraceLoggingWriteStop(local, "AsyncWaitNow", TLArg(ready, "Ready"));
-                    if (ready) {
-                        m_asyncWaitPromise = {};
-                    }
-
-                    CHECK_XRCMD(OpenXrApi::xrBeginFrame(session, nullptr));
+                // Hand the frame over to the submit thread, and let the application start the next one. The errors
+                // of the runtime's xrEndFrame() are returned by the next xrEndFrame().
+                if (m_asyncSubmit && m_frameBegunPipelined && QueueFrame(session, runtimeFrameEndInfo, gazeTime)) {
+                    m_asyncWaitPolled = false;
+                    result = m_submitResult.exchange(XR_SUCCESS, std::memory_order_relaxed);
+                } else {
+                    DrainSubmitQueue();
+                    result = SubmitFrame(session, runtimeFrameEndInfo, m_frameBegunPipelined, gazeTime);
+                    m_asyncWaitPolled = false;
                 }
+            }
 
-                result = OpenXrApi::xrEndFrame(session, frameEndInfo);
-
-                if (m_useTurboMode && !m_asyncWaitPromise.valid()) {
-                    m_asyncWaitPolled = false;
-                    m_asyncWaitCompleted = false;
+            if (m_telemetry && XR_SUCCEEDED(result)) {
+                PublishTelemetry(frameEndInfo->displayTime);
+            }
 
-                    // In Turbo mode, we kick off a wait thread immediately.
-                    TraceLoggingWrite(g_traceProvider, "AsyncWaitStart");
-                    m_asyncWaitPromise = std::async(std::launch::async, [&, session] {
-                        TraceLocalActivity(local);
+            if (m_capture) {
+                m_capture->Write(RecordType::EndFrame,
+                                 captureTimestamp,
+                                 result,
+                                 m_captureEndFrameBuffer.data(),
+                                 m_captureEndFrameBuffer.size());
+            }
 
-                        XrFrameState frameState{XR_TYPE_FRAME_STATE};
-                        TraceLoggingWriteStart(local, "AsyncWaitFrame");
-                        CHECK_XRCMD(OpenXrApi::xrWaitFrame(session, nullptr, &frameState));
-                        TraceLoggingWriteStop(local,
-                                              "AsyncWaitFrame",
-                                              TLArg(frameState.predictedDisplayTime, "PredictedDisplayTime"),
-                                              TLArg(frameState.predictedDisplayPeriod, "PredictedDisplayPeriod"));
-                        {
-                            std::unique_lock lock(m_asyncWaitMutex);
+            if (m_lowLatency && XR_SUCCEEDED(result)) {
+                RecordLowLatencyFrame();
+            }
 
-                            m_lastPredictedDisplayTime = frameState.predictedDisplayTime;
-                            m_lastPredictedDisplayPeriod = frameState.predictedDisplayPeriod;
+            if (m_autoTuner && XR_SUCCEEDED(result)) {
+                RecordAutoTuneFrame();
+            }
 
-                            m_asyncWaitCompleted = true;
+            return result;
+        }
+
+        // See include/XR_MBUCCHIA_varjo_foveated_stats.h.
+        XrResult xrGetFoveatedStatsMBUCCHIA(XrSession session, XrFoveatedStatsMBUCCHIA* stats) {
+            if (stats->type != XR_TYPE_FOVEATED_STATS_MBUCCHIA) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+
+            // Without Quad Views, the layer is bypassed: it neither foveates nor paces the frames.
+            if (m_bypassApiLayer) {
+                void* const next = stats->next;
+                *stats = {XR_TYPE_FOVEATED_STATS_MBUCCHIA};
+                stats->next = next;
+                stats->turboState = XR_FOVEATED_TURBO_STATE_DISABLED_MBUCCHIA;
+                stats->peripheralMultiplier = 1.f;
+                stats->focusMultiplier = 1.f;
+                stats->horizontalFocusScale = 1.f;
+                stats->verticalFocusScale = 1.f;
+            } else {
+                stats->eyeTrackingEnabled = !m_noEyeTracking;
+                stats->foveationActive = m_liveStats.foveationActive.load(std::memory_order_relaxed);
+                stats->locateViewsCount = m_liveStats.locateViewsCount.load(std::memory_order_relaxed);
+                stats->foveatedLocateViewsCount =
+                    m_liveStats.foveatedLocateViewsCount.load(std::memory_order_relaxed);
+
+                stats->turboModeEnabled = m_useTurboMode;
+                stats->turboState = m_liveStats.turboState.load(std::memory_order_relaxed);
+                stats->turboDepth = stats->turboState == XR_FOVEATED_TURBO_STATE_PIPELINED_MBUCCHIA ? 1 : 0;
+                stats->frameCount = m_liveStats.frameCount.load(std::memory_order_relaxed);
+                stats->madeUpFrameCount = m_liveStats.madeUpFrameCount.load(std::memory_order_relaxed);
+                stats->runtimePredictedDisplayTime =
+                    m_liveStats.runtimePredictedDisplayTime.load(std::memory_order_relaxed);
+                stats->predictedDisplayTime = m_liveStats.predictedDisplayTime.load(std::memory_order_relaxed);
+                stats->predictedDisplayPeriod = m_liveStats.predictedDisplayPeriod.load(std::memory_order_relaxed);
+
+                stats->peripheralMultiplier = m_peripheralResolutionFactor;
+                stats->focusMultiplier = m_focusResolutionFactor;
+                stats->horizontalFocusScale = m_focusHorizontalScale;
+                stats->verticalFocusScale = m_focusVerticalScale;
+            }
+
+            for (auto entry = reinterpret_cast<XrBaseOutStructure*>(stats->next); entry; entry = entry->next) {
+                if (entry->type == XR_TYPE_FOVEATED_HEAP_STATS_MBUCCHIA) {
+                    auto heapStats = reinterpret_cast<XrFoveatedHeapStatsMBUCCHIA*>(entry);
+                    heapStats->trackingEnabled = allocations::IsTrackingEnabled;
+                    heapStats->frameLoopAllocationCount = allocations::GetFrameLoopAllocationCount();
+                }
+            }
+
+            return XR_SUCCESS;
+        }
+
+      private:
+        void StartCapture(const std::string& runtimeName) {
+            varjo_foveated::capture::FileHeader header{};
+            header.magic = varjo_foveated::capture::Magic;
+            header.version = varjo_foveated::capture::Version;
+            strncpy_s(header.applicationName, GetApplicationName().c_str(), _TRUNCATE);
+            strncpy_s(header.runtimeName, runtimeName.c_str(), _TRUNCATE);
+            header.configSnapshotId = m_configSnapshotId;
+            header.noEyeTracking = m_noEyeTracking;
+            header.turboMode = m_useTurboMode;
+            header.peripheralMultiplier = m_peripheralResolutionFactor;
+            header.focusMultiplier = m_focusResolutionFactor;
+            header.horizontalFocusScale = m_focusHorizontalScale;
+            header.verticalFocusScale = m_focusVerticalScale;
+
+            const std::time_t now = std::time(nullptr);
+            std::tm localNow;
+            localtime_s(&localNow, &now);
+            std::stringstream filename;
+            filename << "capture_" << std::put_time(&localNow, "%Y%m%d_%H%M%S") << ".vfcap";
+
+            m_capture = std::make_unique<CaptureWriter>(localAppData / filename.str(), header);
+        }
+
+        // Snaps the focus views to the quantization grid, within the peripheral view of the same eye. The FOV of a
+        // focus view stays bit-identical while its grid point does not change, so that the application can keep what it
+        // caches per frustum. Both eyes follow the same gaze: they move to another grid point together, on each axis
+        // where either of them left its dead zone, so that the two frustums never disagree. Called with the
+        // focusFovMutex of the session held.
+        void QuantizeFocusFovs(SessionState& state, XrView* views) {
+            // The extent only changes with the settings or the headset, beyond the floating point noise.
+            const auto isSameExtent = [](const XrFovf& a, const XrFovf& b) {
+                return std::abs((a.angleRight - a.angleLeft) - (b.angleRight - b.angleLeft)) < 1e-3f &&
+                       std::abs((a.angleUp - a.angleDown) - (b.angleUp - b.angleDown)) < 1e-3f;
+            };
+
+            const float step = m_focusQuantization / scaling::DegreesPerRadian;
+            const float deadZone = m_focusDeadZone / scaling::DegreesPerRadian;
+
+            float horizontalCenters[2];
+            float verticalCenters[2];
+            bool snapAll = false;
+            bool snapHorizontal = false;
+            bool snapVertical = false;
+            for (uint32_t eye = 0; eye < 2; eye++) {
+                const XrFovf& fov = views[eye + 2].fov;
+                const QuantizedFov& quantized = state.quantizedFocusFovs[eye];
+
+                horizontalCenters[eye] = (fov.angleLeft + fov.angleRight) / 2;
+                verticalCenters[eye] = (fov.angleDown + fov.angleUp) / 2;
+                snapAll = snapAll || !quantized.valid || !isSameExtent(fov, quantized.fov);
+                snapHorizontal = snapHorizontal || !scaling::IsInQuantizationDeadZone(
+                                                       horizontalCenters[eye], step, deadZone, quantized.horizontal);
+                snapVertical = snapVertical || !scaling::IsInQuantizationDeadZone(
+                                                   verticalCenters[eye], step, deadZone, quantized.vertical);
+            }
+
+            for (uint32_t eye = 0; eye < 2; eye++) {
+                XrFovf& fov = views[eye + 2].fov;
+                QuantizedFov& quantized = state.quantizedFocusFovs[eye];
+
+                const int32_t horizontal = snapAll || snapHorizontal
+                                               ? scaling::QuantizeAngle(horizontalCenters[eye], step)
+                                               : quantized.horizontal;
+                const int32_t vertical =
+                    snapAll || snapVertical ? scaling::QuantizeAngle(verticalCenters[eye], step) : quantized.vertical;
+
+                if (snapAll || horizontal != quantized.horizontal || vertical != quantized.vertical) {
+                    const XrFovf& bounds = views[eye].fov;
+                    quantized.fov = fov;
+                    std::tie(quantized.fov.angleLeft, quantized.fov.angleRight) =
+                        scaling::OffsetFov(fov.angleLeft,
+                                           fov.angleRight,
+                                           horizontal * step - horizontalCenters[eye],
+                                           bounds.angleLeft,
+                                           bounds.angleRight);
+                    std::tie(quantized.fov.angleDown, quantized.fov.angleUp) =
+                        scaling::OffsetFov(fov.angleDown,
+                                           fov.angleUp,
+                                           vertical * step - verticalCenters[eye],
+                                           bounds.angleDown,
+                                           bounds.angleUp);
+                    quantized.horizontal = horizontal;
+                    quantized.vertical = vertical;
+                    quantized.valid = true;
+                }
+                fov = quantized.fov;
+            }
+        }
+
+        // Called with the focusFovMutex of the session held. The history covers a few frames in flight, older entries
+        // are overwritten.
+        FocusFovEntry* FindFocusFov(SessionState& state, XrTime displayTime) {
+            for (auto& entry : state.focusFovHistory) {
+                if (entry.displayTime == displayTime) {
+                    return &entry;
+                }
+            }
+            return nullptr;
+        }
+
+        // The runtime calls submitting a frame: in Turbo Mode, the runtime's xrBeginFrame() deferred by the layer,
+        // then xrEndFrame(), then the start of the wait for the next frame. Called by xrEndFrame() with m_frameMutex
+        // held, or by the submit thread. gazeTime is the time of the gaze followed by the focus views, 0 if none.
+        XrResult SubmitFrame(XrSession session, const XrFrameEndInfo& frameEndInfo, bool pipelined, XrTime gazeTime) {
+            // In Turbo Mode, the frame is displayed at the time predicted by the runtime's wait for this frame, not at
+            // the made-up time the application rendered it for.
+            XrTime displayTime = frameEndInfo.displayTime;
+            if (pipelined) {
+                if (m_asyncWaitWorker->IsValid()) {
+                    TraceLocalActivity(local);
+
+                    // This is the latest point we must have fully waited a frame before proceeding.
+                    //
+                    // Note: we should not wait infinitely here, however certain patterns of engine calls may cause us
+                    // to attempt a "double xrWaitFrame" when turning on Turbo. Use a timeout to detect that, and
+                    // refrain from enqueing a second wait further down. This isn't a pretty solution, but it is simple
+                    // and it seems to work effectively (minus the 1s freeze observed in-game).
+                    TraceLoggingWriteStart(local, "AsyncWaitNow");
+                    const bool ready = m_asyncWaitWorker->WaitFor(1s);
+                    TraceLoggingWriteStop(local, "AsyncWaitNow", TLArg(ready, "Ready"));
+                    if (ready) {
+                        m_asyncWaitWorker->Reset();
+
+                        std::unique_lock lock(m_asyncWaitMutex);
+                        displayTime = m_lastPredictedDisplayTime;
+                    }
+                } else {
+                    // The session stopped being visible while the frame was queued, so no wait was started for it.
+                    XrFrameState frameState{XR_TYPE_FRAME_STATE};
+                    CHECK_XRCMD_RETURN(OpenXrApi::xrWaitFrame(session, nullptr, &frameState));
+                    displayTime = frameState.predictedDisplayTime;
+                }
+
+                CHECK_XRCMD_RETURN(OpenXrApi::xrBeginFrame(session, nullptr));
+            }
+
+            const XrResult result = OpenXrApi::xrEndFrame(session, &frameEndInfo);
+            m_liveStats.frameCount.fetch_add(1, std::memory_order_relaxed);
+            if (gazeTime && XR_SUCCEEDED(result)) {
+                m_gazeLatency.AddFrame(gazeTime, frameEndInfo.displayTime, displayTime);
+            }
+
+            // Once the session is no longer visible, the next frames are waited synchronously.
+            if (m_asyncWaitWorker && !m_asyncWaitWorker->IsValid() && IsSessionVisible()) {
+                {
+                    std::unique_lock lock(m_asyncWaitMutex);
+                    m_asyncWaitCompleted = false;
+                }
+
+                // In Turbo mode, we kick off a wait thread immediately.
+                TraceLoggingWrite(g_traceProvider, "AsyncWaitStart");
+                m_asyncWaitSession = session;
+                m_asyncWaitWorker->Start();
+            }
+
+            return result;
+        }
+
+        // Whether the runtime's xrWaitFrame() for the next frame is in flight, or will be started by the submission of
+        // a queued frame. Must be called with m_frameMutex held.
+        bool IsTurboPipelined() const {
+            return m_asyncWaitWorker &&
+                   (m_asyncWaitWorker->IsValid() || m_isFrameQueued.load(std::memory_order_acquire));
+        }
+
+        // Copies a frame for the submit thread, waiting for the previous frame to be submitted. Returns false if the
+        // frame cannot be copied, in which case it must be submitted synchronously.
+        //
+        // Only one frame is ever queued. The application cannot release the next image of a swapchain before the queued
+        // frame showing that swapchain is submitted (see WaitForSwapchainSubmission()), and every frame shows the
+        // swapchains of the views, so a deeper queue would never fill.
+        bool QueueFrame(XrSession session, const XrFrameEndInfo& frameEndInfo, XrTime gazeTime) {
+            {
+                std::unique_lock lock(m_submitMutex);
+
+                if (m_isFrameQueued.load(std::memory_order_relaxed)) {
+                    TraceLocalActivity(local);
+
+                    TraceLoggingWriteStart(local, "AsyncSubmitQueueFull");
+                    m_submitProgress.wait(lock, [&] { return !m_isFrameQueued.load(std::memory_order_relaxed); });
+                    TraceLoggingWriteStop(local, "AsyncSubmitQueueFull");
+                }
+            }
+
+            // The submit thread does not touch the frame until it is queued.
+            QueuedFrame& frame = m_queuedFrame;
+            if (!CopyFrame(frameEndInfo, frame)) {
+                TraceLoggingWrite(g_traceProvider, "AsyncSubmitUnsupportedFrame");
+                return false;
+            }
+            frame.session = session;
+            frame.gazeTime = gazeTime;
+
+            {
+                std::unique_lock lock(m_submitMutex);
+                m_isFrameQueued.store(true, std::memory_order_release);
+            }
+            m_submitWakeUp.notify_all();
+
+            return true;
+        }
+
+        // Deep-copies the frame, for the projection and quad layers and the depth of the projection views. Other
+        // structures are unknown to the layer and cannot be copied.
+        bool CopyFrame(const XrFrameEndInfo& source, QueuedFrame& frame) {
+            frame.arena.Reset();
+            frame.swapchainCount = 0;
+            if (source.next) {
+                return false;
+            }
+
+            const auto addSwapchain = [&](XrSwapchain swapchain) {
+                if (std::find(frame.swapchains, frame.swapchains + frame.swapchainCount, swapchain) !=
+                    frame.swapchains + frame.swapchainCount) {
+                    return true;
+                }
+                if (frame.swapchainCount == std::size(frame.swapchains)) {
+                    return false;
+                }
+                frame.swapchains[frame.swapchainCount++] = swapchain;
+                return true;
+            };
+
+            frame.frameEndInfo = source;
+            const XrCompositionLayerBaseHeader** layers =
+                frame.arena.Allocate<const XrCompositionLayerBaseHeader*>(source.layerCount);
+            for (uint32_t i = 0; i < source.layerCount; i++) {
+                const XrCompositionLayerBaseHeader* const layer = source.layers[i];
+                if (!layer || layer->next) {
+                    return false;
+                }
+
+                if (layer->type == XR_TYPE_COMPOSITION_LAYER_PROJECTION) {
+                    const auto proj = reinterpret_cast<const XrCompositionLayerProjection*>(layer);
+                    XrCompositionLayerProjection* const projCopy = frame.arena.Copy(proj);
+                    XrCompositionLayerProjectionView* const views = frame.arena.Copy(proj->views, proj->viewCount);
+
+                    for (uint32_t eye = 0; eye < proj->viewCount; eye++) {
+                        if (!addSwapchain(views[eye].subImage.swapchain)) {
+                            return false;
+                        }
+                        if (views[eye].next) {
+                            const auto depth = reinterpret_cast<const XrCompositionLayerDepthInfoKHR*>(views[eye].next);
+                            if (depth->type != XR_TYPE_COMPOSITION_LAYER_DEPTH_INFO_KHR || depth->next) {
+                                return false;
+                            }
+                            XrCompositionLayerDepthInfoKHR* const depthCopy = frame.arena.Copy(depth);
+                            if (!addSwapchain(depth->subImage.swapchain)) {
+                                return false;
+                            }
+                            views[eye].next = depthCopy;
                         }
-                    });
+                    }
+                    projCopy->views = views;
+                    layers[i] = reinterpret_cast<const XrCompositionLayerBaseHeader*>(projCopy);
+                } else if (layer->type == XR_TYPE_COMPOSITION_LAYER_QUAD) {
+                    XrCompositionLayerQuad* const quad =
+                        frame.arena.Copy(reinterpret_cast<const XrCompositionLayerQuad*>(layer));
+                    if (!addSwapchain(quad->subImage.swapchain)) {
+                        return false;
+                    }
+                    layers[i] = reinterpret_cast<const XrCompositionLayerBaseHeader*>(quad);
+                } else {
+                    return false;
+                }
+            }
+            frame.frameEndInfo.layers = layers;
+
+            return true;
+        }
+
+        // Submits the queued frames, one at a time.
+        void SubmitThreadLoop() {
+            std::unique_lock lock(m_submitMutex);
+            while (true) {
+                m_submitWakeUp.wait(
+                    lock, [&] { return m_stopSubmitThread || m_isFrameQueued.load(std::memory_order_relaxed); });
+                if (!m_isFrameQueued.load(std::memory_order_relaxed)) {
+                    break;
+                }
+
+                QueuedFrame& frame = m_queuedFrame;
+                lock.unlock();
+
+                allocations::FrameLoopScope frameLoopScope;
+
+                TraceLocalActivity(local);
+                TraceLoggingWriteStart(local, "AsyncSubmit", TLArg(frame.frameEndInfo.displayTime, "DisplayTime"));
+                const XrResult result = SubmitFrame(frame.session, frame.frameEndInfo, true, frame.gazeTime);
+                TraceLoggingWriteStop(local, "AsyncSubmit", TLArg(xr::ToCString(result), "Result"));
+                if (XR_FAILED(result)) {
+                    ErrorLog(fmt::format("Asynchronous xrEndFrame failed with {}\n", xr::ToCString(result)));
+                    m_submitResult.store(result, std::memory_order_relaxed);
                 }
+
+                lock.lock();
+                m_isFrameQueued.store(false, std::memory_order_release);
+                m_submitProgress.notify_all();
             }
+        }
+
+        // Waits for the queued frame to be submitted.
+        void DrainSubmitQueue() {
+            if (!m_isFrameQueued.load(std::memory_order_acquire)) {
+                return;
+            }
+
+            std::unique_lock lock(m_submitMutex);
+            m_submitProgress.wait(lock, [&] { return !m_isFrameQueued.load(std::memory_order_relaxed); });
+        }
+
+        // The runtime submits the last released image of a swapchain, so a new image may only be released once the
+        // queued frame showing the swapchain is submitted.
+        void WaitForSwapchainSubmission(XrSwapchain swapchain) {
+            const auto isQueued = [&] {
+                const QueuedFrame& frame = m_queuedFrame;
+                return m_isFrameQueued.load(std::memory_order_relaxed) &&
+                       std::find(frame.swapchains, frame.swapchains + frame.swapchainCount, swapchain) !=
+                           frame.swapchains + frame.swapchainCount;
+            };
+
+            std::unique_lock lock(m_submitMutex);
+            if (isQueued()) {
+                TraceLocalActivity(local);
+
+                TraceLoggingWriteStart(local, "AsyncSubmitWait", TLXArg(swapchain, "Swapchain"));
+                m_submitProgress.wait(lock, [&] { return !isQueued(); });
+                TraceLoggingWriteStop(local, "AsyncSubmitWait");
+            }
+        }
 
+        // Submits the frame still queued, then stops the submit thread.
+        void StopSubmitThread() {
+            if (!m_submitThread.joinable()) {
+                return;
+            }
+
+            {
+                std::unique_lock lock(m_submitMutex);
+                m_stopSubmitThread = true;
+            }
+            m_submitWakeUp.notify_all();
+            m_submitThread.join();
+        }
+
+        // The Turbo mode job, running on m_asyncWaitWorker.
+        void AsyncWaitFrame() {
+            allocations::FrameLoopScope frameLoopScope;
+
+            TraceLocalActivity(local);
+
+            XrFrameState frameState{XR_TYPE_FRAME_STATE};
+            TraceLoggingWriteStart(local, "AsyncWaitFrame");
+            const int64_t runtimeCaptureTimestamp = m_capture ? m_capture->Now() : 0;
+            const XrResult result = OpenXrApi::xrWaitFrame(m_asyncWaitSession, nullptr, &frameState);
+            if (m_capture) {
+                CaptureWaitFrame(
+                    RecordType::RuntimeWaitFrame, runtimeCaptureTimestamp, result, m_asyncWaitSession, frameState);
+            }
+            if (XR_FAILED(result)) {
+                // Keep the last prediction, the next frame will be made up from it.
+                ErrorLog(fmt::format("Asynchronous xrWaitFrame failed with {}\n", xr::ToCString(result)));
+                TraceLoggingWriteStop(local, "AsyncWaitFrame", TLArg(xr::ToCString(result), "Error"));
+                return;
+            }
+            TraceLoggingWriteStop(local,
+                                  "AsyncWaitFrame",
+                                  TLArg(frameState.predictedDisplayTime, "PredictedDisplayTime"),
+                                  TLArg(frameState.predictedDisplayPeriod, "PredictedDisplayPeriod"));
             {
-                std::unique_lock lock(m_focusFovMutex);
+                std::unique_lock lock(m_asyncWaitMutex);
+
+                m_lastPredictedDisplayTime = frameState.predictedDisplayTime;
+                m_lastPredictedDisplayPeriod = frameState.predictedDisplayPeriod;
+
+                m_asyncWaitCompleted = true;
+            }
+        }
+
+        void CaptureWaitFrame(
+            RecordType type, int64_t timestamp, XrResult result, XrSession session, const XrFrameState& frameState) {
+            varjo_foveated::capture::WaitFrameRecord record{};
+            record.session = (uint64_t)session;
+            if (XR_SUCCEEDED(result)) {
+                record.predictedDisplayTime = frameState.predictedDisplayTime;
+                record.predictedDisplayPeriod = frameState.predictedDisplayPeriod;
+                record.shouldRender = frameState.shouldRender;
+            }
+            m_capture->Write(type, timestamp, result, record);
+        }
+
+        void CaptureSwapchainImage(
+            RecordType type, int64_t timestamp, XrResult result, XrSwapchain swapchain, uint32_t index = 0) {
+            varjo_foveated::capture::SwapchainImageRecord record{};
+            record.swapchain = (uint64_t)swapchain;
+            record.index = index;
+            m_capture->Write(type, timestamp, result, record);
+        }
+
+        void PublishTelemetry(XrTime displayTime) {
+            const auto now = std::chrono::steady_clock::now();
+            const auto toUs = [](std::chrono::steady_clock::duration duration) {
+                return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+            };
+
+            varjo_foveated::telemetry::FrameSnapshot frame{};
+            frame.frameIndex = m_liveStats.frameCount.load(std::memory_order_relaxed);
+            frame.displayTime = displayTime;
+            frame.predictedDisplayPeriod = m_liveStats.predictedDisplayPeriod.load(std::memory_order_relaxed);
+            frame.frameIntervalUs =
+                m_lastFrameEndTimestamp.time_since_epoch().count() ? toUs(now - m_lastFrameEndTimestamp) : 0;
+            frame.waitToEndUs =
+                m_lastFrameWaitTimestamp.time_since_epoch().count() ? toUs(now - m_lastFrameWaitTimestamp) : 0;
+            frame.foveationActive = m_liveStats.foveationActive.load(std::memory_order_relaxed);
+            frame.turboState = m_liveStats.turboState.load(std::memory_order_relaxed);
+            const uint64_t locateViewsCount = m_liveStats.locateViewsCount.load(std::memory_order_relaxed);
+            frame.gazeTrackedRatio =
+                locateViewsCount ? (float)m_liveStats.foveatedLocateViewsCount.load(std::memory_order_relaxed) /
+                                       locateViewsCount
+                                 : 0.f;
+            m_gazeQuality.GetSnapshot(frame);
+            m_gazeLatency.GetSnapshot(frame);
+            frame.configSnapshotId = m_configSnapshotId;
+            frame.peripheralMultiplier = m_peripheralResolutionFactor;
+            frame.focusMultiplier = m_focusResolutionFactor;
+            frame.horizontalFocusScale = m_focusHorizontalScale;
+            frame.verticalFocusScale = m_focusVerticalScale;
+
+            m_telemetry->Publish(frame);
+            m_lastFrameEndTimestamp = now;
+        }
+
+        // Apps size their swapchains before locating the views, so we remember the last field of view reported by the
+        // runtime for the headset. Only the extent of the views matter (the focus views follow the gaze).
+        void UpdateViewFovs(const XrView* views) {
+            const auto isSameExtent = [](const XrFovf& a, const XrFovf& b) {
+                return std::abs((a.angleRight - a.angleLeft) - (b.angleRight - b.angleLeft)) < 1e-3f &&
+                       std::abs((a.angleUp - a.angleDown) - (b.angleUp - b.angleDown)) < 1e-3f;
+            };
+
+            {
+                std::unique_lock lock(m_viewFovsMutex);
+
+                bool changed = !m_hasViewFovs;
+                for (uint32_t i = 0; i < 4 && !changed; i++) {
+                    changed = !isSameExtent(views[i].fov, m_viewFovs[i]);
+                }
+                if (!changed) {
+                    return;
+                }
+
+                for (uint32_t i = 0; i < 4; i++) {
+                    m_viewFovs[i] = views[i].fov;
+                }
+                m_hasViewFovs = true;
+                m_viewFovsDirty = true;
+            }
+
+            TraceLoggingWrite(g_traceProvider, "ViewFovsChanged");
+            StartSettingsWriter();
+        }
+
+        // A write still in progress picks up the new settings, or the next change (or the instance destruction) will.
+        void StartSettingsWriter() {
+            if (m_settingsWriter->WaitFor(0s)) {
+                m_settingsWriter->Start();
+            }
+        }
+
+        // Each headset model has its own file, so that switching between headsets does not invalidate the cache.
+        std::filesystem::path GetViewFovsPath() const {
+            return localAppData / ("fov-" + SanitizeFileName(m_systemName) + ".cfg");
+        }
+
+        // The job of m_settingsWriter.
+        void WriteSettings() noexcept {
+            try {
+                WriteViewFovs();
+            } catch (const std::exception& exc) {
+                ErrorLog(fmt::format("Failed to write the field of view: {}\n", exc.what()));
+            }
+
+            try {
+                if (m_autoTuner && m_autoTuneJudged.exchange(false)) {
+                    SaveAutoTuneResult();
+                }
+            } catch (const std::exception& exc) {
+                ErrorLog(fmt::format("Failed to write the auto-tune result: {}\n", exc.what()));
+            }
+        }
+
+        void WriteViewFovs() {
+            while (true) {
+                XrFovf viewFovs[4];
+                {
+                    std::unique_lock lock(m_viewFovsMutex);
+                    if (!m_viewFovsDirty) {
+                        break;
+                    }
+                    std::copy(std::begin(m_viewFovs), std::end(m_viewFovs), viewFovs);
+                    m_viewFovsDirty = false;
+                }
+
+                std::ofstream file(GetViewFovsPath(), std::ios_base::trunc);
+                file << "system=" << m_systemName << "\n";
+                for (uint32_t i = 0; i < 4; i++) {
+                    file << fmt::format("view{}={},{},{},{}\n",
+                                        i,
+                                        viewFovs[i].angleLeft,
+                                        viewFovs[i].angleRight,
+                                        viewFovs[i].angleUp,
+                                        viewFovs[i].angleDown);
+                }
+                Log(fmt::format(
+                    "Field of view updated: {} {}\n", xr::ToString(viewFovs[0]), xr::ToString(viewFovs[2])));
+            }
+        }
 
-                // Delete all entries older than 1s.
-                while (!m_focusFovForDisplayTime.empty() &&
-                       m_focusFovForDisplayTime.cbegin()->first < frameEndInfo->displayTime - 1'000'000'000) {
-                    m_focusFovForDisplayTime.erase(m_focusFovForDisplayTime.begin());
+        void LoadViewFovs() {
+            std::ifstream file(GetViewFovsPath());
+            if (!file.is_open()) {
+                return;
+            }
+
+            bool isSameSystem = false;
+            uint32_t loadedViews = 0;
+            std::string line;
+            while (std::getline(file, line)) {
+                const auto offset = line.find('=');
+                if (offset == std::string::npos) {
+                    continue;
                 }
+                const std::string name = line.substr(0, offset);
+                std::istringstream value(line.substr(offset + 1));
+
+                if (name == "system") {
+                    isSameSystem = value.str() == m_systemName;
+                } else if (name.size() == 5 && name.compare(0, 4, "view") == 0 && name[4] >= '0' && name[4] < '4') {
+                    const uint32_t i = name[4] - '0';
+                    XrFovf& fov = m_viewFovs[i];
+                    char separator;
+                    value >> fov.angleLeft >> separator >> fov.angleRight >> separator >> fov.angleUp >> separator >>
+                        fov.angleDown;
+                    if (value) {
+                        loadedViews |= 1u << i;
+                    }
+                }
+            }
+
+            m_hasViewFovs = isSameSystem && loadedViews == 0xf;
+            if (m_hasViewFovs) {
+                Log(fmt::format("Field of view: {} {}\n", xr::ToString(m_viewFovs[0]), xr::ToString(m_viewFovs[2])));
+            }
+        }
+
+        // The swapchains for the views are only known once submitted (see NoteViewSwapchains()), since applications may
+        // pad their resolution, or use texture arrays or double-wide swapchains. Depth buffers are not counted.
+        void RegisterSwapchainSamples(XrSwapchain swapchain, const XrSwapchainCreateInfo& createInfo) {
+            if (createInfo.usageFlags & XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+                Log(fmt::format("Swapchain {}x{}: {} samples (depth)\n",
+                                createInfo.width,
+                                createInfo.height,
+                                createInfo.sampleCount));
+                return;
+            }
+            Log(fmt::format(
+                "Swapchain {}x{}: {} samples\n", createInfo.width, createInfo.height, createInfo.sampleCount));
+
+            SwapchainSamples entry{};
+            entry.width = createInfo.width;
+            entry.height = createInfo.height;
+            entry.sampleCount = createInfo.sampleCount;
+            entry.pixelCount = static_cast<int64_t>(createInfo.width) * createInfo.height * createInfo.arraySize *
+                               createInfo.faceCount;
+
+            std::unique_lock lock(m_viewClassesMutex);
+            m_swapchainSamples.insert_or_assign(swapchain, entry);
+        }
+
+        void UnregisterSwapchainSamples(XrSwapchain swapchain) {
+            for (auto& viewSwapchain : m_viewSwapchains) {
+                XrSwapchain expected = swapchain;
+                viewSwapchain.compare_exchange_strong(expected, XR_NULL_HANDLE);
+            }
+
+            std::unique_lock lock(m_viewClassesMutex);
+
+            const auto it = m_swapchainSamples.find(swapchain);
+            if (it != m_swapchainSamples.end()) {
+                m_savedSwapchainSamples -= it->second.savedSamples;
+                m_swapchainSamples.erase(it);
+            }
+        }
+
+        // Learn the swapchains of the quad views from a projection layer submitted by the application. The swapchains
+        // of the previous frame are remembered, so nothing is looked up while the application keeps submitting them.
+        void NoteViewSwapchains(const XrCompositionLayerProjectionView* views) {
+            for (uint32_t i = 0; i < 4; i++) {
+                const XrSwapchain swapchain = views[i].subImage.swapchain;
+                if (m_viewSwapchains[i].exchange(swapchain, std::memory_order_relaxed) == swapchain) {
+                    continue;
+                }
+
+                if (LogSwapchainSampleCount(swapchain, m_viewClasses[i < 2 ? 0 : 1]) && m_acquireAhead) {
+                    StageSwapchain(swapchain);
+                }
+            }
+        }
+
+        // Report the savings from the sample count policy compared to the runtime's recommendation, the first time a
+        // swapchain is submitted for a class of views. Returns false for depth swapchains and swapchains already seen.
+        bool LogSwapchainSampleCount(XrSwapchain swapchain, const ViewClass& viewClass) {
+            std::unique_lock lock(m_viewClassesMutex);
+
+            const auto it = m_swapchainSamples.find(swapchain);
+            if (it == m_swapchainSamples.end() || it->second.viewClass) {
+                return false;
+            }
+            SwapchainSamples& entry = it->second;
+
+            // Memory is estimated for 4 bytes per sample, since the size of the format depends on the graphics API.
+            entry.viewClass = &viewClass;
+            entry.savedSamples =
+                entry.pixelCount * (static_cast<int64_t>(viewClass.runtimeSampleCount) - entry.sampleCount);
+            m_savedSwapchainSamples += entry.savedSamples;
+
+            TraceLoggingWrite(g_traceProvider,
+                              "SwapchainSampleCount",
+                              TLXArg(swapchain, "Swapchain"),
+                              TLArg(viewClass.name, "ViewClass"),
+                              TLArg(entry.sampleCount, "SampleCount"),
+                              TLArg(viewClass.runtimeSampleCount, "RuntimeSampleCount"),
+                              TLArg(entry.savedSamples, "SavedSamples"));
+            Log(fmt::format("Swapchain {}x{} for {} views: {} samples (runtime recommends {}), {:.1f} MB saved per "
+                            "image ({:.1f} MB in total)\n",
+                            entry.width,
+                            entry.height,
+                            viewClass.name,
+                            entry.sampleCount,
+                            viewClass.runtimeSampleCount,
+                            entry.savedSamples * 4 / 1048576.0,
+                            m_savedSwapchainSamples * 4 / 1048576.0));
+
+            return true;
+        }
+
+        bool IsFramePacingEnabled() const {
+            return m_pacingNumerator != m_pacingDenominator;
+        }
+
+        // Release the app just in time for its frame: as late as its recent CPU and submission times allow, keeping
+        // m_lowLatencyMargin for the GPU and the compositor before the predicted display time. Returns how much longer
+        // the app must be held back, on top of the frame pacing delay.
+        XrDuration PaceLowLatency(XrDuration pacingDelay, XrTime predictedDisplayTime, XrDuration period) {
+            const XrDuration margin = static_cast<XrDuration>(m_lowLatencyMargin * 1'000'000);
+            const auto now = std::chrono::steady_clock::now();
+            const XrTime nowTime = GetXrTimeNow();
+
+            // The time left until the frame is displayed. Without the runtime's clock, assume the frame is displayed
+            // one period after the app is released.
+            const XrDuration timeToDisplay = nowTime ? predictedDisplayTime - nowTime : pacingDelay + period;
+
+            // The app must submit before this time, or the frame will likely miss its vsync.
+            const XrDuration timeToDeadline = std::max(timeToDisplay - margin, XrDuration{0});
+            m_lowLatencyDeadline = now + std::chrono::nanoseconds(timeToDeadline);
+
+            XrDuration delay = 0;
+            if (m_frameTimeCount >= std::size(m_frameTimeHistory) / 2 && IsSessionVisible()) {
+                delay = std::max(timeToDeadline - pacingDelay - EstimateFrameTime() - m_lowLatencyBackoff,
+                                 XrDuration{0});
+            }
+            m_lowLatencyDelay = delay;
+            m_lowLatencyBackoff -= m_lowLatencyBackoff / 32;
+
+            TraceLoggingWrite(g_traceProvider,
+                              "PaceLowLatency",
+                              TLArg(timeToDisplay, "TimeToDisplay"),
+                              TLArg(delay, "Delay"),
+                              TLArg(m_lowLatencyBackoff, "Backoff"));
+
+            return delay;
+        }
+
+        // The current time on the runtime's timeline, or 0 if the runtime cannot convert it.
+        XrTime GetXrTimeNow() {
+            LARGE_INTEGER counter;
+            XrTime time = 0;
+            if (!m_hasPerformanceCounterConversion || !QueryPerformanceCounter(&counter) ||
+                XR_FAILED(OpenXrApi::xrConvertWin32PerformanceCounterToTimeKHR(GetXrInstance(), &counter, &time))) {
+                return 0;
+            }
+            return time;
+        }
+
+        // The gaze is located for a display time, but the eye tracker returns its latest sample: the age of the gaze is
+        // measured from when it was located. Without the runtime's clock, fall back to the display time.
+        XrTime GetGazeAcquisitionTime(XrTime locateTime) {
+            const XrTime now = GetXrTimeNow();
+            return now ? now : locateTime;
+        }
+
+        // The time from releasing the app to the end of its xrEndFrame(), for the slowest 10% of the recent frames.
+        XrDuration EstimateFrameTime() const {
+            XrDuration frameTimes[std::size(m_frameTimeHistory)];
+            const size_t count = std::min(m_frameTimeCount, std::size(m_frameTimeHistory));
+            std::copy_n(m_frameTimeHistory, count, frameTimes);
+            const size_t percentile = (count * 9) / 10;
+            std::nth_element(frameTimes, frameTimes + percentile, frameTimes + count);
+            return frameTimes[percentile];
+        }
+
+        void RecordLowLatencyFrame() {
+            const auto now = std::chrono::steady_clock::now();
+            const XrDuration frameTime =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_lowLatencyReleaseTimestamp).count();
+            m_frameTimeHistory[m_frameTimeCount++ % std::size(m_frameTimeHistory)] = frameTime;
+
+            // A late submission means the estimate was too optimistic: back off by the overrun, and slowly return to
+            // the estimate over the next frames.
+            if (now > m_lowLatencyDeadline && m_lowLatencyDelay > 0) {
+                const XrDuration overrun =
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_lowLatencyDeadline).count();
+                m_lowLatencyBackoff += overrun;
                 TraceLoggingWrite(g_traceProvider,
-                                  "xrEndFrame",
-                                  TLArg(m_focusFovForDisplayTime.size(), "FovForDisplayTimeDictionarySize"));
+                                  "LowLatencyLateFrame",
+                                  TLArg(frameTime, "FrameTime"),
+                                  TLArg(overrun, "Overrun"));
             }
+        }
 
-            return result;
+        // Lock the app to m_pacingNumerator frames every m_pacingDenominator vsyncs, on the runtime's vsync grid, and
+        // report a steady period. Returns how long the app must be held back. The app is released early enough to use
+        // all the vsyncs until its target for rendering.
+        XrDuration PaceFrame(XrFrameState* frameState) {
+            const XrTime runtimeDisplayTime = frameState->predictedDisplayTime;
+            const XrDuration period = frameState->predictedDisplayPeriod;
+            if (period <= 0) {
+                return 0;
+            }
+
+            // Spread the frames evenly over the cycle, eg: for 2/3, 1 then 2 vsyncs between frames.
+            const uint32_t phase = m_pacingPhase;
+            const XrDuration interval = ((phase + 1) * m_pacingDenominator) / m_pacingNumerator -
+                                        (phase * m_pacingDenominator) / m_pacingNumerator;
+
+            XrTime displayTime = runtimeDisplayTime;
+            if (m_lastPacedDisplayTime) {
+                const XrDuration offset = m_lastPacedDisplayTime + interval * period - runtimeDisplayTime;
+                const int64_t vsyncs = offset >= 0 ? (offset + period / 2) / period : -((period / 2 - offset) / period);
+                if (vsyncs >= 0) {
+                    displayTime = runtimeDisplayTime + vsyncs * period;
+                    m_pacingPhase = (phase + 1) % m_pacingNumerator;
+                } else {
+                    // The app missed its target, restart the cycle from the runtime's next frame.
+                    m_pacingPhase = 0;
+                }
+            }
+            m_lastPacedDisplayTime = displayTime;
+
+            frameState->predictedDisplayTime = displayTime;
+            frameState->predictedDisplayPeriod = (period * m_pacingDenominator) / m_pacingNumerator;
+
+            TraceLoggingWrite(g_traceProvider,
+                              "PaceFrame",
+                              TLArg(runtimeDisplayTime, "RuntimeDisplayTime"),
+                              TLArg(displayTime, "DisplayTime"),
+                              TLArg(phase, "Phase"));
+
+            return std::max(displayTime - runtimeDisplayTime - (interval - 1) * period, XrDuration{0});
+        }
+
+        void WaitForPacing(XrDuration delay) {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local, "PacingWait", TLArg(delay, "Delay"));
+
+            LARGE_INTEGER dueTime;
+            dueTime.QuadPart = -static_cast<LONGLONG>(delay / 100);
+            if (m_pacingTimer && SetWaitableTimer(m_pacingTimer.get(), &dueTime, 0, nullptr, nullptr, FALSE)) {
+                WaitForSingleObject(m_pacingTimer.get(), INFINITE);
+            } else {
+                Sleep(static_cast<DWORD>(delay / 1'000'000));
+            }
+
+            TraceLoggingWriteStop(local, "PacingWait");
+        }
+
+        void SetTurboState(XrFoveatedTurboStateMBUCCHIA state) {
+            if (m_liveStats.turboState.exchange(state, std::memory_order_relaxed) != state) {
+                recorder::Record(recorder::EventType::TurboState, state);
+            }
+        }
+
+        // Until the layer sees the session state, the session is assumed visible.
+        bool IsSessionVisible() const {
+            const XrSessionState state = m_sessionState.load(std::memory_order_relaxed);
+            return state == XR_SESSION_STATE_UNKNOWN || state == XR_SESSION_STATE_VISIBLE ||
+                   state == XR_SESSION_STATE_FOCUSED;
+        }
+
+        // Complete the Turbo Mode wait and the swapchain staging in progress, and stop the gaze sampler.
+        void DrainSessionWork() {
+            recorder::SetDisplayPeriod(0);
+
+            DrainSubmitQueue();
+
+            {
+                std::unique_lock lock(m_frameMutex);
+
+                if (m_asyncWaitWorker && m_asyncWaitWorker->IsValid()) {
+                    TraceLocalActivity(local);
+
+                    TraceLoggingWriteStart(local, "AsyncWaitNow");
+                    const bool ready = m_asyncWaitWorker->WaitFor(1s);
+                    TraceLoggingWriteStop(local, "AsyncWaitNow", TLArg(ready, "Ready"));
+
+                    if (ready) {
+                        m_asyncWaitWorker->Reset();
+                    }
+                }
+            }
+
+            {
+                std::unique_lock lock(m_stagedSwapchainsMutex);
+
+                for (const auto& [swapchain, staged] : m_stagedSwapchains) {
+                    staged->worker->Wait();
+                }
+            }
+
+            std::unique_lock lock(m_resourcesMutex);
+            StopGazeSampler();
+        }
+
+        // Called from xrEndFrame() the first time a swapchain is submitted for the quad views. The application released
+        // its images before submitting them, so the next image can be staged right away. Creating the worker is a
+        // one-time cost per swapchain.
+        void StageSwapchain(XrSwapchain swapchain) {
+            TraceLoggingWrite(g_traceProvider, "StageSwapchain", TLXArg(swapchain, "Swapchain"));
+
+            auto staged = std::make_unique<StagedSwapchain>();
+            staged->swapchain = swapchain;
+            staged->worker = std::make_unique<Worker>([this, entry = staged.get()] { StageImage(*entry); });
+            if (IsSessionVisible()) {
+                staged->worker->Start();
+            }
+
+            std::unique_lock lock(m_stagedSwapchainsMutex);
+            m_stagedSwapchains.insert_or_assign(swapchain, std::move(staged));
+        }
+
+        StagedSwapchain* FindStagedSwapchain(XrSwapchain swapchain) {
+            if (!m_acquireAhead) {
+                return nullptr;
+            }
+
+            std::unique_lock lock(m_stagedSwapchainsMutex);
+
+            const auto it = m_stagedSwapchains.find(swapchain);
+            return it != m_stagedSwapchains.cend() ? it->second.get() : nullptr;
+        }
+
+        // Runs on the swapchain's worker. The application does not use the swapchain until the staging completes.
+        void StageImage(StagedSwapchain& staged) {
+            allocations::FrameLoopScope frameLoopScope;
+
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local, "StageImage", TLXArg(staged.swapchain, "Swapchain"));
+
+            XrSwapchainImageAcquireInfo acquireInfo{XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO};
+            staged.acquireResult = OpenXrApi::xrAcquireSwapchainImage(staged.swapchain, &acquireInfo, &staged.index);
+            staged.waitResult = XR_ERROR_CALL_ORDER_INVALID;
+            if (XR_SUCCEEDED(staged.acquireResult)) {
+                // On timeout, the image stays acquired and the application's own wait is forwarded.
+                XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+                waitInfo.timeout = 100'000'000;
+                staged.waitResult = OpenXrApi::xrWaitSwapchainImage(staged.swapchain, &waitInfo);
+            }
+
+            TraceLoggingWriteStop(local,
+                                  "StageImage",
+                                  TLArg(staged.index, "Index"),
+                                  TLArg(xr::ToCString(staged.acquireResult), "AcquireResult"),
+                                  TLArg(xr::ToCString(staged.waitResult), "WaitResult"));
+        }
+
+        // Returns the state of a session, or nullptr if the session has not begun.
+        SessionState* FindSession(XrSession session) {
+            for (auto& state : m_sessions) {
+                if (state.session.load(std::memory_order_acquire) == session) {
+                    return &state;
+                }
+            }
+            return nullptr;
+        }
+
+        // Returns the state of a session, claiming a free slot on its first xrBeginSession().
+        SessionState* ClaimSession(XrSession session) {
+            std::unique_lock lock(m_sessionsMutex);
+
+            if (SessionState* const state = FindSession(session)) {
+                return state;
+            }
+            for (auto& state : m_sessions) {
+                if (state.session.load(std::memory_order_relaxed) == XR_NULL_HANDLE) {
+                    state.viewSpace = XR_NULL_HANDLE;
+                    state.renderGazeSpace = XR_NULL_HANDLE;
+                    std::fill(std::begin(state.focusFovHistory), std::end(state.focusFovHistory), FocusFovEntry{});
+                    state.nextFocusFovEntry = 0;
+                    std::fill(std::begin(state.quantizedFocusFovs), std::end(state.quantizedFocusFovs), QuantizedFov{});
+                    state.session.store(session, std::memory_order_release);
+                    return &state;
+                }
+            }
+
+            ErrorLog("Too many sessions, foveation is disabled for this session\n");
+            return nullptr;
+        }
+
+        // Destroys the resources of a session and frees its slot.
+        void ReleaseSession(SessionState& state) {
+            std::unique_lock lock(m_sessionsMutex);
+
+            for (XrSpace* space : {&state.renderGazeSpace, &state.viewSpace}) {
+                if (*space != XR_NULL_HANDLE) {
+                    OpenXrApi::xrDestroySpace(*space);
+                    *space = XR_NULL_HANDLE;
+                }
+            }
+            state.session.store(XR_NULL_HANDLE, std::memory_order_release);
+        }
+
+        // Creates the gaze spaces of a session. Foveation stays inactive if they cannot be created.
+        void CreateGazeSpaces(XrSession session, SessionState& state) {
+            XrReferenceSpaceCreateInfo spaceInfo{XR_TYPE_REFERENCE_SPACE_CREATE_INFO};
+            spaceInfo.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_VIEW;
+            spaceInfo.poseInReferenceSpace = xr::math::Pose::Identity();
+            XrResult result = OpenXrApi::xrCreateReferenceSpace(session, &spaceInfo, &state.viewSpace);
+            if (XR_SUCCEEDED(result)) {
+                spaceInfo.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_COMBINED_EYE_VARJO;
+                result = OpenXrApi::xrCreateReferenceSpace(session, &spaceInfo, &state.renderGazeSpace);
+            }
+
+            if (XR_FAILED(result)) {
+                ErrorLog(fmt::format("Failed to create the gaze spaces: {}\n", xr::ToCString(result)));
+                if (state.viewSpace != XR_NULL_HANDLE) {
+                    OpenXrApi::xrDestroySpace(state.viewSpace);
+                    state.viewSpace = XR_NULL_HANDLE;
+                }
+                state.renderGazeSpace = XR_NULL_HANDLE;
+            }
+        }
+
+        // The gaze sampler runs while the session is visible. It is started from xrBeginSession() (for runtimes that do
+        // not report the session state) and xrPollEvent(), so that the render thread never creates it.
+        void ResumeGazeSampler(const SessionState& state) {
+            if (!m_gazeSamplingRate || m_noEyeTracking || !IsSessionVisible()) {
+                return;
+            }
+
+            std::unique_lock lock(m_resourcesMutex);
+            if (state.renderGazeSpace != XR_NULL_HANDLE) {
+                StartGazeSampler(state);
+            }
+        }
+
+        // Must be called with m_resourcesMutex held.
+        void StartGazeSampler(const SessionState& state) {
+            if (m_gazeSampler.joinable()) {
+                return;
+            }
+
+            m_gazeSamples.Clear();
+            m_gazeTrackedSampleCount = 0;
+            m_gazeSamplerErrorCount = 0;
+            m_gazeSamplerStartTimestamp = std::chrono::steady_clock::now();
+            m_stopGazeSampler.store(false, std::memory_order_relaxed);
+            m_gazeSampler = std::thread([&, renderGazeSpace = state.renderGazeSpace, viewSpace = state.viewSpace] {
+                GazeSamplerLoop(renderGazeSpace, viewSpace);
+            });
+        }
+
+        // Must be called with m_resourcesMutex held.
+        void StopGazeSampler() {
+            if (!m_gazeSampler.joinable()) {
+                return;
+            }
+
+            m_stopGazeSampler.store(true, std::memory_order_relaxed);
+            m_gazeSampler.join();
+
+            const uint64_t sampleCount = m_gazeSamples.Count();
+            const double duration =
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - m_gazeSamplerStartTimestamp).count();
+            TraceLoggingWrite(g_traceProvider,
+                              "GazeSampler",
+                              TLArg(sampleCount, "SampleCount"),
+                              TLArg(m_gazeTrackedSampleCount, "TrackedSampleCount"),
+                              TLArg(m_gazeSamplerErrorCount, "ErrorCount"),
+                              TLArg(duration, "Duration"));
+            Log(fmt::format("Gaze sampler: {} samples over {:.1f}s ({:.0f} Hz), {:.1f}%% tracked, {} errors\n",
+                            sampleCount,
+                            duration,
+                            duration > 0 ? sampleCount / duration : 0.0,
+                            sampleCount ? 100.0 * m_gazeTrackedSampleCount / sampleCount : 0.0,
+                            m_gazeSamplerErrorCount));
+
+            m_gazeSamples.Clear();
+        }
+
+        // Summarize the eye tracking quality of the session, then start over.
+        void LogGazeQuality() {
+            if (!m_gazeQuality.GetSampleCount()) {
+                return;
+            }
+
+            varjo_foveated::telemetry::FrameSnapshot frame{};
+            m_gazeQuality.GetSnapshot(frame);
+            TraceLoggingWrite(g_traceProvider,
+                              "GazeQuality",
+                              TLArg(frame.gazeSampleCount, "SampleCount"),
+                              TLArg(frame.gazeSampleTrackedRatio, "TrackedRatio"),
+                              TLArg(frame.gazeDropoutCount, "DropoutCount"),
+                              TLArg(frame.gazeBlinkCount, "BlinkCount"),
+                              TLArg(frame.gazeLongestDropoutMs, "LongestDropoutMs"),
+                              TLArg(frame.gazeJitterP50Deg, "JitterP50Deg"),
+                              TLArg(frame.gazeJitterP95Deg, "JitterP95Deg"));
+            Log("Gaze quality: %s\n", m_gazeQuality.ToString().c_str());
+
+            m_gazeQuality.Reset();
+        }
+
+        // Summarize the age of the gaze behind the displayed frames, then start over.
+        void LogGazeLatency() {
+            if (!m_gazeLatency.GetFrameCount()) {
+                return;
+            }
+
+            varjo_foveated::telemetry::FrameSnapshot frame{};
+            m_gazeLatency.GetSnapshot(frame);
+            TraceLoggingWrite(g_traceProvider,
+                              "GazeLatency",
+                              TLArg(frame.gazeAgeFrameCount, "FrameCount"),
+                              TLArg(frame.gazeAgeUnmatchedCount, "UnmatchedCount"),
+                              TLArg(frame.gazeAgeP50Ms, "AgeP50Ms"),
+                              TLArg(frame.gazeAgeP95Ms, "AgeP95Ms"),
+                              TLArg(frame.gazeAgeP99Ms, "AgeP99Ms"),
+                              TLArg(frame.gazeAgeMaxMs, "AgeMaxMs"),
+                              TLArg(frame.displayTimeSlipP50Ms, "DisplayTimeSlipP50Ms"),
+                              TLArg(frame.displayTimeSlipP95Ms, "DisplayTimeSlipP95Ms"));
+            Log("Gaze age at display: %s\n", m_gazeLatency.ToString().c_str());
+
+            m_gazeLatency.Reset();
+        }
+
+        // Locates the gaze at the configured rate, so that xrLocateViews() never waits on the eye tracker.
+        void GazeSamplerLoop(XrSpace renderGazeSpace, XrSpace viewSpace) {
+            allocations::FrameLoopScope frameLoopScope;
+
+            const XrDuration period = 1'000'000'000 / m_gazeSamplingRate;
+            while (!m_stopGazeSampler.load(std::memory_order_relaxed)) {
+                // Extrapolate the display time of the last xrLocateViews() call to now, so that the samples follow the
+                // application's frames. The sampler starts with the session visible, possibly before the first
+                // xrLocateViews() call, in which case there is nothing to extrapolate from yet.
+                const XrTime anchorTime = m_gazeSamplerAnchorTime.load(std::memory_order_acquire);
+                const auto now = std::chrono::steady_clock::now();
+                const auto elapsed = now - m_gazeSamplerAnchorTimestamp.load(std::memory_order_relaxed);
+
+                const XrTime locateTime =
+                    anchorTime + std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+                XrSpaceLocation location{XR_TYPE_SPACE_LOCATION};
+                if (!anchorTime) {
+                    // Wait for the first xrLocateViews() call.
+                } else if (XR_SUCCEEDED(OpenXrApi::xrLocateSpace(renderGazeSpace, viewSpace, locateTime, &location))) {
+                    GazeSample sample;
+                    sample.time = GetGazeAcquisitionTime(locateTime);
+                    sample.flags = location.locationFlags;
+                    sample.pose = location.pose;
+                    sample.timestamp = now;
+                    m_gazeSamples.Push(sample);
+                    m_gazeQuality.AddSample(sample.time, sample.flags, sample.pose);
+                    if (sample.flags & XR_SPACE_LOCATION_ORIENTATION_TRACKED_BIT) {
+                        m_gazeTrackedSampleCount++;
+                    }
+                } else {
+                    m_gazeSamplerErrorCount++;
+                }
+
+                LARGE_INTEGER dueTime;
+                dueTime.QuadPart = -static_cast<LONGLONG>(period / 100);
+                if (m_gazeSamplerTimer &&
+                    SetWaitableTimer(m_gazeSamplerTimer.get(), &dueTime, 0, nullptr, nullptr, FALSE)) {
+                    WaitForSingleObject(m_gazeSamplerTimer.get(), INFINITE);
+                } else {
+                    Sleep(std::max(static_cast<DWORD>(period / 1'000'000), DWORD{1}));
+                }
+            }
+        }
+
+        // A stable identifier for the active configuration (FNV-1a of the settings), to correlate telemetry across
+        // runs.
+        uint32_t ComputeConfigSnapshotId() const {
+            uint32_t hash = 2166136261u;
+            const auto accumulate = [&](const auto& value) {
+                const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+                for (size_t i = 0; i < sizeof(value); i++) {
+                    hash = (hash ^ bytes[i]) * 16777619u;
+                }
+            };
+            accumulate(m_noEyeTracking);
+            accumulate(m_fixedHorizontalOffset);
+            accumulate(m_fixedVerticalOffset);
+            accumulate(m_peripheralResolutionFactor);
+            accumulate(m_focusResolutionFactor);
+            accumulate(m_focusHorizontalScale);
+            accumulate(m_focusVerticalScale);
+            accumulate(m_focusQuantization);
+            accumulate(m_focusDeadZone);
+            accumulate(m_peripheralPixelDensity);
+            accumulate(m_focusPixelDensity);
+            accumulate(m_peripheralSampleCount);
+            accumulate(m_focusSampleCount);
+            accumulate(m_autoTune);
+            accumulate(m_autoTuneTarget);
+            accumulate(m_autoTuneWindow);
+            accumulate(m_useTurboMode);
+            accumulate(m_pacingNumerator);
+            accumulate(m_pacingDenominator);
+            accumulate(m_gazeSamplingRate);
+            accumulate(m_acquireAhead);
+            accumulate(m_lowLatency);
+            accumulate(m_lowLatencyMargin);
+            accumulate(m_asyncSubmit);
+            return hash;
+        }
+
+        // Only install the hooks needed by the features that are enabled.
+        void SelectHooks() {
+            m_bypassedHooks.clear();
+            m_isWaitFrameBypassed = false;
+
+            // xrBeginFrame() is only deferred by Turbo Mode. xrWaitFrame() is also intercepted to pace the frames, to
+            // report the runtime's predictions to the stats extension, and for the auto-tuner to measure the frame
+            // time. The telemetry and the stall watchdog infer the display period from xrEndFrame() instead.
+            if (!m_useTurboMode && !m_capture) {
+                if (!m_hasFoveatedStatsExtension && !IsFramePacingEnabled() && !m_lowLatency && !m_autoTuner) {
+                    m_bypassedHooks.push_back("xrWaitFrame");
+                    m_isWaitFrameBypassed = true;
+                }
+                m_bypassedHooks.push_back("xrBeginFrame");
+            }
+
+            // The swapchain image hooks are only used for tracing, capture, acquire-ahead and asynchronous submission.
+            // Tracing must be started before the application.
+            if (!IsTraceEnabled() && !m_capture && !m_acquireAhead && !m_asyncSubmit) {
+                m_bypassedHooks.push_back("xrAcquireSwapchainImage");
+                m_bypassedHooks.push_back("xrWaitSwapchainImage");
+                m_bypassedHooks.push_back("xrReleaseSwapchainImage");
+            }
+
+            std::string installedHooks;
+            for (const auto& hook : GetOverriddenFunctions()) {
+                const bool isBypassed =
+                    std::find(m_bypassedHooks.cbegin(), m_bypassedHooks.cend(), hook) != m_bypassedHooks.cend();
+                TraceLoggingWrite(
+                    g_traceProvider, "SelectHooks", TLArg(hook.c_str(), "Hook"), TLArg(!isBypassed, "Installed"));
+                if (!isBypassed) {
+                    installedHooks += (installedHooks.empty() ? "" : ", ") + hook;
+                }
+            }
+            Log(fmt::format("Installed hooks: {}\n", installedHooks));
         }
 
-      private:
         void LoadConfiguration() {
             std::ifstream configFile;
 
-            // Look in %LocalAppData% first, then fallback to your installation folder.
-            auto configPath = localAppData / "settings.cfg";
-            Log(fmt::format("Trying to locate configuration file at '{}'...\n", configPath.string()));
-            configFile.open(configPath);
+            // Look for an override (eg: from VarjoFoveatedReplay) first, then in %LocalAppData%, then fallback to your
+            // installation folder.
+            std::filesystem::path configPath;
+            const char* configOverride = getenv("VARJO_FOVEATED_CONFIG");
+            if (configOverride) {
+                configPath = configOverride;
+                Log(fmt::format("Trying to locate configuration file at '{}'...\n", configPath.string()));
+                configFile.open(configPath);
+                if (!configFile.is_open()) {
+                    Log("Not found\n");
+                }
+            }
+            if (!configFile.is_open()) {
+                configPath = localAppData / "settings.cfg";
+                Log(fmt::format("Trying to locate configuration file at '{}'...\n", configPath.string()));
+                configFile.open(configPath);
+            }
             if (!configFile.is_open()) {
                 Log("Not found\n");
                 configPath = dllHome / "settings.cfg";
@@ -711,6 +2715,12 @@ namespace {
                 configFile.open(configPath);
             }
 
+            // The settings of the application are written next to settings.cfg, unless it is in the installation
+            // folder.
+            const bool isConfigWritable = configFile.is_open() && configPath != dllHome / "settings.cfg";
+            m_applicationConfigPath = (isConfigWritable ? configPath.parent_path() : localAppData) /
+                                      (SanitizeFileName(GetApplicationName()) + ".cfg");
+
             if (configFile.is_open()) {
                 unsigned int lineNumber = 0;
                 std::string line;
@@ -724,6 +2734,135 @@ namespace {
             }
         }
 
+        // Load the settings written by the auto-tuner for the application, then pick the auto-tuner's candidate for
+        // this run.
+        void LoadApplicationConfiguration() {
+            m_configuredSettings = GetFoveationSettings();
+
+            std::ifstream file(m_applicationConfigPath);
+            if (file.is_open()) {
+                Log(fmt::format("Loading application configuration from '{}'...\n", m_applicationConfigPath.string()));
+                unsigned int lineNumber = 0;
+                std::string line;
+                while (std::getline(file, line)) {
+                    lineNumber++;
+                    ParseConfigurationStatement(line, lineNumber);
+                }
+            }
+
+            if (!m_autoTune) {
+                return;
+            }
+
+            m_autoTuner =
+                std::make_unique<AutoTuner>(static_cast<XrDuration>(m_autoTuneWindow * 1e9), m_autoTuneTarget);
+            if (!m_autoTuneProgress.empty()) {
+                try {
+                    m_autoTuner->SetProgress(m_autoTuneProgress);
+                } catch (std::out_of_range&) {
+                    Log("Invalid auto-tune progress, restarting the search\n");
+                }
+            }
+            if (m_autoTuner->IsComplete()) {
+                Log(fmt::format("Auto-tune: complete, using level {}\n", m_autoTuner->GetBestLevel()));
+                m_autoTuner.reset();
+                return;
+            }
+
+            SetFoveationSettings(m_autoTuner->GetCandidateSettings(m_configuredSettings));
+            Log(fmt::format("Auto-tune: measuring level {} over {:.1f}s ({} target): peripheral multiplier "
+                            "{:.3f}, focus multiplier {:.3f}, focus scale {:.3f}/{:.3f}\n",
+                            m_autoTuner->GetCandidateLevel(),
+                            m_autoTuneWindow,
+                            m_autoTuneTarget > 0 ? fmt::format("{:.1f} fps", m_autoTuneTarget) : "refresh rate",
+                            m_peripheralResolutionFactor,
+                            m_focusResolutionFactor,
+                            m_focusHorizontalScale,
+                            m_focusVerticalScale));
+        }
+
+        // Persist the best settings found so far, and the progress of the search.
+        void SaveApplicationConfiguration() {
+            const FoveationSettings settings = m_autoTuner->GetBestSettings(m_configuredSettings);
+
+            std::ofstream file(m_applicationConfigPath, std::ios_base::trunc);
+            file << fmt::format("peripheral_multiplier={}\n", settings.peripheralMultiplier);
+            file << fmt::format("focus_multiplier={}\n", settings.focusMultiplier);
+            file << fmt::format("horizontal_focus_scale={}\n", settings.horizontalFocusScale);
+            file << fmt::format("vertical_focus_scale={}\n", settings.verticalFocusScale);
+            if (settings.peripheralPixelDensity > 0) {
+                file << fmt::format("peripheral_ppd={}\n", settings.peripheralPixelDensity);
+            }
+            if (settings.focusPixelDensity > 0) {
+                file << fmt::format("focus_ppd={}\n", settings.focusPixelDensity);
+            }
+            file << fmt::format("auto_tune_progress={}\n", m_autoTuner->GetProgress());
+            file.close();
+            if (!file) {
+                ErrorLog(fmt::format("Failed to write '{}'\n", m_applicationConfigPath.string()));
+            }
+        }
+
+        // Measure the frame rate of the auto-tuner's candidate, while the session is visible. A candidate can only be
+        // changed before the application creates its swapchains, so the next candidate is for the next run.
+        void RecordAutoTuneFrame() {
+            if (!IsSessionVisible()) {
+                m_autoTuner->RestartWindow();
+                return;
+            }
+
+            // The judged window is persisted by m_settingsWriter. The auto-tuner ignores the next frames, so it does
+            // not change while being written.
+            if (m_autoTuner->AddFrame(m_liveStats.runtimePredictedDisplayTime.load(std::memory_order_relaxed),
+                                      m_liveStats.predictedDisplayPeriod.load(std::memory_order_relaxed))) {
+                TraceLoggingWrite(g_traceProvider, "AutoTuneJudged");
+                m_autoTuneJudged.store(true);
+                StartSettingsWriter();
+            }
+        }
+
+        void SaveAutoTuneResult() {
+            Log(fmt::format("Auto-tune: {}\n", m_autoTuner->ToString()));
+            SaveApplicationConfiguration();
+            if (m_autoTuner->IsComplete()) {
+                Log(fmt::format("Auto-tune: complete, level {} written to '{}'\n",
+                                m_autoTuner->GetBestLevel(),
+                                m_applicationConfigPath.string()));
+            } else {
+                Log(fmt::format("Auto-tune: level {} will be measured on the next run\n",
+                                m_autoTuner->GetCandidateLevel()));
+            }
+        }
+
+        FoveationSettings GetFoveationSettings() const {
+            return {m_peripheralResolutionFactor,
+                    m_focusResolutionFactor,
+                    m_focusHorizontalScale,
+                    m_focusVerticalScale,
+                    m_peripheralPixelDensity,
+                    m_focusPixelDensity};
+        }
+
+        void SetFoveationSettings(const FoveationSettings& settings) {
+            m_peripheralResolutionFactor = settings.peripheralMultiplier;
+            m_focusResolutionFactor = settings.focusMultiplier;
+            m_focusHorizontalScale = settings.horizontalFocusScale;
+            m_focusVerticalScale = settings.verticalFocusScale;
+            m_peripheralPixelDensity = settings.peripheralPixelDensity;
+            m_focusPixelDensity = settings.focusPixelDensity;
+        }
+
+        // Application names may contain characters that are not valid in a file name.
+        static std::string SanitizeFileName(const std::string& name) {
+            std::string sanitized = name.empty() ? "default" : name;
+            for (char& c : sanitized) {
+                if (!isalnum(static_cast<unsigned char>(c)) && c != ' ' && c != '-' && c != '_' && c != '.') {
+                    c = '_';
+                }
+            }
+            return sanitized;
+        }
+
         void ParseConfigurationStatement(const std::string& line, unsigned int lineNumber) {
             try {
                 const auto offset = line.find('=');
@@ -744,12 +2883,120 @@ namespace {
                     } else if (name == "vertical_focus_scale") {
                         m_focusVerticalScale = std::stof(value);
                         parsed = true;
+                    } else if (name == "focus_quantization") {
+                        const float quantization = std::stof(value);
+                        if (quantization < 0) {
+                            throw std::out_of_range("focus_quantization");
+                        }
+                        m_focusQuantization = quantization;
+                        parsed = true;
+                    } else if (name == "focus_dead_zone") {
+                        const float deadZone = std::stof(value);
+                        if (deadZone < 0) {
+                            throw std::out_of_range("focus_dead_zone");
+                        }
+                        m_focusDeadZone = deadZone;
+                        parsed = true;
                     } else if (name == "no_eye_tracking") {
                         m_noEyeTracking = std::stoi(value);
                         parsed = true;
+                    } else if (name == "fixed_horizontal_offset") {
+                        m_fixedHorizontalOffset = std::stof(value);
+                        parsed = true;
+                    } else if (name == "fixed_vertical_offset") {
+                        m_fixedVerticalOffset = std::stof(value);
+                        parsed = true;
+                    } else if (name == "fixed_horizontal_scale") {
+                        m_fixedHorizontalScale = std::stof(value);
+                        parsed = true;
+                    } else if (name == "fixed_vertical_scale") {
+                        m_fixedVerticalScale = std::stof(value);
+                        parsed = true;
                     } else if (name == "turbo_mode") {
                         m_useTurboMode = std::stoi(value);
                         parsed = true;
+                    } else if (name == "telemetry") {
+                        m_publishTelemetry = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "capture") {
+                        m_captureEnabled = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "latency_histograms") {
+                        m_latencyHistograms = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "flight_recorder") {
+                        m_flightRecorder = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "stall_watchdog") {
+                        m_stallWatchdogPeriods = std::stoul(value);
+                        parsed = true;
+                    } else if (name == "peripheral_ppd") {
+                        m_peripheralPixelDensity = std::stof(value);
+                        parsed = true;
+                    } else if (name == "focus_ppd") {
+                        m_focusPixelDensity = std::stof(value);
+                        parsed = true;
+                    } else if (name == "peripheral_samples") {
+                        m_peripheralSampleCount = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "focus_samples") {
+                        m_focusSampleCount = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "auto_tune") {
+                        m_autoTune = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "auto_tune_target") {
+                        const float target = std::stof(value);
+                        if (target < 0) {
+                            throw std::out_of_range("auto_tune_target");
+                        }
+                        m_autoTuneTarget = target;
+                        parsed = true;
+                    } else if (name == "auto_tune_window") {
+                        const float window = std::stof(value);
+                        if (window <= 0) {
+                            throw std::out_of_range("auto_tune_window");
+                        }
+                        m_autoTuneWindow = window;
+                        parsed = true;
+                    } else if (name == "auto_tune_progress") {
+                        m_autoTuneProgress = value;
+                        parsed = true;
+                    } else if (name == "low_latency") {
+                        m_lowLatency = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "low_latency_margin") {
+                        const float margin = std::stof(value);
+                        if (margin < 0) {
+                            throw std::out_of_range("low_latency_margin");
+                        }
+                        m_lowLatencyMargin = margin;
+                        parsed = true;
+                    } else if (name == "acquire_ahead") {
+                        m_acquireAhead = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "async_submit") {
+                        m_asyncSubmit = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "gaze_sampling_rate") {
+                        const uint32_t rate = std::stoul(value);
+                        if (rate > 1000) {
+                            throw std::out_of_range("gaze_sampling_rate");
+                        }
+                        m_gazeSamplingRate = rate;
+                        parsed = true;
+                    } else if (name == "frame_pacing") {
+                        // A fraction of the display refresh rate, eg: 1/2 or 2/3.
+                        const auto slash = value.find('/');
+                        const uint32_t numerator = std::stoul(value.substr(0, slash));
+                        const uint32_t denominator =
+                            slash != std::string::npos ? std::stoul(value.substr(slash + 1)) : 1;
+                        if (!numerator || !denominator || numerator > denominator) {
+                            throw std::out_of_range("frame_pacing");
+                        }
+                        m_pacingNumerator = numerator;
+                        m_pacingDenominator = denominator;
+                        parsed = true;
                     } else {
                         Log("L%u: Unrecognized option\n", lineNumber);
                     }
@@ -766,6 +3013,31 @@ namespace {
         }
 
         bool m_bypassApiLayer{false};
+        std::vector<std::string> m_bypassedHooks;
+        bool m_isWaitFrameBypassed{false};
+        XrTime m_lastSubmittedDisplayTime{0};
+        bool m_hasFoveatedStatsExtension{false};
+        bool m_hasPerformanceCounterConversion{false};
+        LiveStats m_liveStats;
+
+        // Telemetry.
+        std::unique_ptr<TelemetryPublisher> m_telemetry;
+        std::chrono::time_point<std::chrono::steady_clock> m_lastFrameEndTimestamp{};
+
+        // Auto-tuner. The candidates are relative to the settings from settings.cfg.
+        std::filesystem::path m_applicationConfigPath;
+        FoveationSettings m_configuredSettings;
+        std::unique_ptr<AutoTuner> m_autoTuner;
+        std::atomic<bool> m_autoTuneJudged{false};
+
+        // Capture.
+        std::unique_ptr<CaptureWriter> m_capture;
+        std::vector<uint8_t> m_captureEndFrameBuffer;
+
+        // Copies of the structs submitted with xrEndFrame(), reset every frame. Sized for 16 projection layers of 4
+        // views.
+        Arena<16384> m_frameArena;
+        bool m_frameArenaOverflowLogged{false};
 
         // Configuration.
         bool m_noEyeTracking{false};
@@ -773,34 +3045,150 @@ namespace {
         float m_focusResolutionFactor{1.f};
         float m_focusHorizontalScale{1.f};
         float m_focusVerticalScale{1.f};
+        // Grid of the focus views FOV in degrees, or 0 to follow the gaze continuously. The dead zone in degrees delays
+        // the move to the next grid point.
+        float m_focusQuantization{0.f};
+        float m_focusDeadZone{0.25f};
+        // Fixed focus region without eye tracking. Offsets are in degrees (right and up), a scale of 0 keeps the focus
+        // region scale.
+        float m_fixedHorizontalOffset{0.f};
+        float m_fixedVerticalOffset{0.f};
+        float m_fixedHorizontalScale{0.f};
+        float m_fixedVerticalScale{0.f};
+        // Target pixels per degree, or 0 to use the multipliers.
+        float m_peripheralPixelDensity{0.f};
+        float m_focusPixelDensity{0.f};
+        // MSAA sample counts, or 0 to use the runtime's recommendation.
+        uint32_t m_peripheralSampleCount{0};
+        uint32_t m_focusSampleCount{0};
+        // Search the foveation settings reaching the target frame rate (or the refresh rate if 0), measuring each
+        // candidate over a window in seconds.
+        bool m_autoTune{false};
+        float m_autoTuneTarget{0.f};
+        float m_autoTuneWindow{10.f};
+        std::string m_autoTuneProgress;
         bool m_useTurboMode{true};
+        uint32_t m_pacingNumerator{1};
+        uint32_t m_pacingDenominator{1};
+        // Rate of the background gaze sampler in Hz, or 0 to locate the gaze in xrLocateViews().
+        uint32_t m_gazeSamplingRate{0};
+        bool m_acquireAhead{false};
+        bool m_lowLatency{false};
+        // Time kept for the GPU and the compositor in low latency mode, in milliseconds.
+        float m_lowLatencyMargin{4.f};
+        bool m_asyncSubmit{false};
+        bool m_publishTelemetry{true};
+        bool m_captureEnabled{false};
+        bool m_latencyHistograms{true};
+        bool m_flightRecorder{true};
+        // Hooks running for longer than this many display periods trigger a flight recorder dump, or 0 to disable.
+        uint32_t m_stallWatchdogPeriods{10};
+        uint32_t m_configSnapshotId{0};
+
+        // Session state, from the events polled by the application.
+        std::atomic<XrSessionState> m_sessionState{XR_SESSION_STATE_UNKNOWN};
+
+        // Per-session state. The mutex only serializes claiming and releasing the slots.
+        static constexpr size_t MaxSessionCount = 4;
+        std::mutex m_sessionsMutex;
+        SessionState m_sessions[MaxSessionCount];
 
         // Foveated mode.
         std::mutex m_resourcesMutex;
-        bool m_initialized{false};
-        XrSpace m_viewSpace{XR_NULL_HANDLE};
-        XrSpace m_renderGazeSpace{XR_NULL_HANDLE};
 
-        // FOV submission correction.
-        std::mutex m_focusFovMutex;
-        std::map<XrTime, std::pair<XrFovf, XrFovf>> m_focusFovForDisplayTime;
+        // Gaze sampler.
+        Ring<GazeSample, 256> m_gazeSamples;
+        std::atomic<XrTime> m_gazeSamplerAnchorTime{0};
+        std::atomic<std::chrono::time_point<std::chrono::steady_clock>> m_gazeSamplerAnchorTimestamp{};
+        std::atomic<bool> m_stopGazeSampler{false};
+        uint64_t m_gazeTrackedSampleCount{0};
+        uint64_t m_gazeSamplerErrorCount{0};
+        std::chrono::time_point<std::chrono::steady_clock> m_gazeSamplerStartTimestamp{};
+        wil::unique_handle m_gazeSamplerTimer;
+        std::thread m_gazeSampler;
+
+        // Eye tracking quality, from the samples of the gaze sampler or of xrLocateViews().
+        GazeQualityMonitor m_gazeQuality;
+
+        // Age of the gaze behind the focus views, when the frames are displayed.
+        GazeLatencyMonitor m_gazeLatency;
 
         // Turbo mode.
         std::chrono::time_point<std::chrono::steady_clock> m_lastFrameWaitTimestamp{};
         std::mutex m_frameMutex;
         XrTime m_waitedFrameTime;
         std::mutex m_asyncWaitMutex;
-        std::future<void> m_asyncWaitPromise;
         XrTime m_lastPredictedDisplayTime{0};
         XrTime m_lastPredictedDisplayPeriod{0};
         bool m_asyncWaitPolled{false};
         bool m_asyncWaitCompleted{false};
+        XrSession m_asyncWaitSession{XR_NULL_HANDLE};
+        std::unique_ptr<Worker> m_asyncWaitWorker;
+        // Whether the runtime's xrBeginFrame() was deferred for the current frame.
+        bool m_frameBegunPipelined{false};
+
+        // Asynchronous frame submission, one frame at a time (see QueueFrame()).
+        std::mutex m_submitMutex;
+        std::condition_variable m_submitWakeUp;
+        std::condition_variable m_submitProgress;
+        QueuedFrame m_queuedFrame;
+        std::atomic<bool> m_isFrameQueued{false};
+        bool m_stopSubmitThread{false};
+        // The last error of the runtime's xrEndFrame() on the submit thread, for the next xrEndFrame() to return.
+        std::atomic<XrResult> m_submitResult{XR_SUCCESS};
+        std::thread m_submitThread;
+
+        // What was recommended for the peripheral and focus views, and the swapchains submitted for them.
+        std::mutex m_viewClassesMutex;
+        ViewClass m_viewClasses[2]{{"peripheral"}, {"focus"}};
+        std::map<XrSwapchain, SwapchainSamples> m_swapchainSamples;
+        int64_t m_savedSwapchainSamples{0};
+        // The swapchains of the quad views in the last projection layer, only touched by xrEndFrame() and
+        // xrDestroySwapchain().
+        std::atomic<XrSwapchain> m_viewSwapchains[4]{};
+
+        // Field of view of the views, for pixel density targeting.
+        std::string m_systemName;
+        std::mutex m_viewFovsMutex;
+        bool m_hasViewFovs{false};
+        XrFovf m_viewFovs[4]{};
+        bool m_viewFovsDirty{false};
+        std::unique_ptr<Worker> m_settingsWriter;
+
+        // Swapchain images staged ahead of the application.
+        std::mutex m_stagedSwapchainsMutex;
+        std::map<XrSwapchain, std::unique_ptr<StagedSwapchain>> m_stagedSwapchains;
+
+        // Frame pacing.
+        wil::unique_handle m_pacingTimer;
+        XrTime m_lastPacedDisplayTime{0};
+        uint32_t m_pacingPhase{0};
+
+        // Low latency mode.
+        XrDuration m_frameTimeHistory[64]{};
+        size_t m_frameTimeCount{0};
+        XrDuration m_lowLatencyDelay{0};
+        XrDuration m_lowLatencyBackoff{0};
+        std::chrono::time_point<std::chrono::steady_clock> m_lowLatencyReleaseTimestamp{};
+        std::chrono::time_point<std::chrono::steady_clock> m_lowLatencyDeadline{};
     };
 
     std::unique_ptr<OpenXrLayer> g_instance = nullptr;
 
 } // namespace
 
+// Auto-generated wrappers for the hot path, calling directly into OpenXrLayer.
+#include <dispatch.hot.gen.h>
+
+namespace openxr_api_layer {
+
+    // Must be cheap enough to be called every frame: no tracing, no exception handling.
+    XrResult XRAPI_CALL xrGetFoveatedStatsMBUCCHIA(XrSession session, XrFoveatedStatsMBUCCHIA* stats) noexcept {
+        return g_instance->xrGetFoveatedStatsMBUCCHIA(session, stats);
+    }
+
+} // namespace openxr_api_layer
+
 namespace openxr_api_layer {
     OpenXrApi* GetInstance() {
         if (!g_instance) {
@@ -24,6 +24,7 @@
 
 // Standard library.
 #include <algorithm>
+#include <atomic>
 #include <cstdarg>
 #include <ctime>
 #include <iomanip>
@@ -35,7 +36,10 @@
 #include <memory>
 #include <mutex>
 #include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <future>
+#include <thread>
 #include <vector>
 #include <map>
 
@@ -59,6 +63,9 @@ using Microsoft::WRL::ComPtr;
 #include <openxr/openxr.h>
 #include <openxr/openxr_platform.h>
 
+// Extensions implemented by the layer.
+#include <XR_MBUCCHIA_varjo_foveated_stats.h>
+
 // OpenXR loader interfaces.
 #include <loader_interfaces.h>
 
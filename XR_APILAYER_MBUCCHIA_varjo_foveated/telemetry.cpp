@@ -0,0 +1,115 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "telemetry.h"
+#include <log.h>
+
+namespace openxr_api_layer {
+
+    using namespace openxr_api_layer::log;
+    using namespace varjo_foveated::telemetry;
+
+    // How often a process waiting for the segment checks whether the owner is gone.
+    constexpr auto AcquireInterval = 1s;
+
+    // A process we are not allowed to query is assumed to be alive.
+    bool IsProcessAlive(DWORD processId) {
+        const wil::unique_handle process(OpenProcess(SYNCHRONIZE, FALSE, processId));
+        if (!process) {
+            return GetLastError() == ERROR_ACCESS_DENIED;
+        }
+        return WaitForSingleObject(process.get(), 0) == WAIT_TIMEOUT;
+    }
+
+    TelemetryPublisher::TelemetryPublisher(const std::string& applicationName) : m_applicationName(applicationName) {
+        // The segment may already exist, created by a previous or concurrent application, or kept open by a reader.
+        m_mapping.reset(
+            CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(Segment), SegmentName));
+        if (!m_mapping) {
+            Log(fmt::format("Failed to create telemetry segment: {}\n", GetLastError()));
+            return;
+        }
+
+        m_segment = reinterpret_cast<Segment*>(MapViewOfFile(m_mapping.get(), FILE_MAP_ALL_ACCESS, 0, 0, 0));
+        if (!m_segment) {
+            Log(fmt::format("Failed to map telemetry segment: {}\n", GetLastError()));
+            m_mapping.reset();
+            return;
+        }
+
+        if (TryAcquire()) {
+            Log(fmt::format("Publishing telemetry to {}\n", SegmentName));
+        } else {
+            Log(fmt::format("Telemetry segment is published by process {}, waiting for it to exit\n",
+                            m_segment->owner.load()));
+        }
+    }
+
+    TelemetryPublisher::~TelemetryPublisher() {
+        if (m_segment) {
+            if (m_isOwner) {
+                uint32_t owner = GetCurrentProcessId();
+                m_segment->owner.compare_exchange_strong(owner, 0, std::memory_order_release);
+            }
+            UnmapViewOfFile(m_segment);
+        }
+    }
+
+    void TelemetryPublisher::Publish(const FrameSnapshot& frame) {
+        if (!m_segment) {
+            return;
+        }
+
+        if (!m_isOwner) {
+            const auto now = std::chrono::steady_clock::now();
+            if (now < m_nextAcquireTime) {
+                return;
+            }
+            m_nextAcquireTime = now + AcquireInterval;
+            if (!TryAcquire()) {
+                return;
+            }
+            Log("Took over the telemetry segment\n");
+        }
+
+        WriteSnapshot(*m_segment, frame);
+    }
+
+    bool TelemetryPublisher::TryAcquire() {
+        // The sequence lock only supports one writer. Another instance of the layer in this process counts as alive.
+        const DWORD processId = GetCurrentProcessId();
+        uint32_t owner = m_segment->owner.load(std::memory_order_acquire);
+        if (owner && IsProcessAlive(owner)) {
+            return false;
+        }
+        if (!m_segment->owner.compare_exchange_strong(owner, processId, std::memory_order_acquire)) {
+            return false;
+        }
+
+        WritePublisher(*m_segment, processId, m_applicationName.c_str());
+        m_isOwner = true;
+        return true;
+    }
+
+} // namespace openxr_api_layer
@@ -0,0 +1,50 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <VarjoFoveatedTelemetry.h>
+
+namespace openxr_api_layer {
+
+    // Publishes the per-frame telemetry to a named shared memory segment, for external monitoring tools. Only one
+    // process publishes at a time: the segment is taken over once the process publishing to it is gone.
+    class TelemetryPublisher {
+      public:
+        TelemetryPublisher(const std::string& applicationName);
+        ~TelemetryPublisher();
+
+        // Never blocks, regardless of the readers.
+        void Publish(const varjo_foveated::telemetry::FrameSnapshot& frame);
+
+      private:
+        // Take ownership of the segment if no other live process owns it.
+        bool TryAcquire();
+
+        const std::string m_applicationName;
+        wil::unique_handle m_mapping;
+        varjo_foveated::telemetry::Segment* m_segment{nullptr};
+        bool m_isOwner{false};
+        std::chrono::steady_clock::time_point m_nextAcquireTime;
+    };
+
+} // namespace openxr_api_layer
@@ -0,0 +1,172 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+// Layout of the capture files written by the Varjo Foveated API layer (capture=1 in settings.cfg).
+//
+// A capture file is a FileHeader followed by a stream of records. Each record starts with a RecordHeader, followed by
+// RecordHeader::size bytes of payload, whose layout depends on RecordHeader::type. Records are appended in the order
+// the calls complete, and the file is flushed periodically, so a capture remains readable if the application crashes.
+//
+// Readers must skip records with an unknown type (using RecordHeader::size), and reject files with a different
+// Version. Adding new record types does not require a new Version, changing an existing layout does.
+//
+// Requires <openxr/openxr.h> to be included first.
+
+#include <cstdint>
+
+namespace varjo_foveated::capture {
+
+    constexpr uint32_t Magic = 0x50434656; // 'VFCP'
+    constexpr uint32_t Version = 1;
+
+    // Maximum number of views stored in a LocateViewsRecord.
+    constexpr uint32_t MaxViewCount = 4;
+
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        char applicationName[128];
+        char runtimeName[128];
+
+        // The configuration of the layer at the time of the capture.
+        uint32_t configSnapshotId;
+        uint32_t noEyeTracking;
+        uint32_t turboMode;
+        float peripheralMultiplier;
+        float focusMultiplier;
+        float horizontalFocusScale;
+        float verticalFocusScale;
+        uint32_t reserved;
+    };
+
+    enum class RecordType : uint16_t {
+        // Calls from the application, as seen by the layer.
+        BeginSession = 1,
+        DestroySession,
+        LocateViews,
+        WaitFrame,
+        BeginFrame,
+        EndFrame,
+        AcquireSwapchainImage,
+        WaitSwapchainImage,
+        ReleaseSwapchainImage,
+
+        // Calls from the layer to the runtime.
+        RuntimeWaitFrame = 100,
+    };
+
+    struct RecordHeader {
+        RecordType type;
+        uint16_t reserved;
+        // Size of the payload following this header.
+        uint32_t size;
+        // Time when the call was made, in nanoseconds since the beginning of the capture.
+        int64_t timestamp;
+        // Time spent in the call, in nanoseconds.
+        int64_t duration;
+        // The XrResult returned by the call.
+        int32_t result;
+        // Identifies the calling thread (only meaningful within the capture).
+        uint32_t threadId;
+    };
+
+    struct BeginSessionRecord {
+        uint64_t session;
+        uint32_t primaryViewConfigurationType;
+        uint32_t reserved;
+    };
+
+    struct DestroySessionRecord {
+        uint64_t session;
+    };
+
+    struct LocateViewsRecord {
+        uint64_t session;
+        uint64_t space;
+        XrTime displayTime;
+        uint32_t viewConfigurationType;
+
+        // The location of the gaze (from the COMBINED_EYE_VARJO reference space, in VIEW space).
+        uint32_t gazeLocationFlags;
+        XrPosef gazePose;
+
+        // The views returned by the runtime, before the layer modified them.
+        uint64_t viewStateFlags;
+        uint32_t viewCount;
+        uint32_t reserved;
+        struct {
+            XrPosef pose;
+            XrFovf fov;
+        } views[MaxViewCount];
+    };
+
+    // Used for both WaitFrame and RuntimeWaitFrame.
+    struct WaitFrameRecord {
+        uint64_t session;
+        XrTime predictedDisplayTime;
+        XrDuration predictedDisplayPeriod;
+        uint32_t shouldRender;
+        uint32_t reserved;
+    };
+
+    struct BeginFrameRecord {
+        uint64_t session;
+    };
+
+    // Followed by layerCount CompositionLayerRecord.
+    struct EndFrameRecord {
+        uint64_t session;
+        XrTime displayTime;
+        uint32_t environmentBlendMode;
+        uint32_t layerCount;
+    };
+
+    // Followed by viewCount ProjectionViewRecord. Only projection layers have views.
+    struct CompositionLayerRecord {
+        uint32_t type;
+        uint32_t layerFlags;
+        uint64_t space;
+        uint32_t viewCount;
+        uint32_t reserved;
+    };
+
+    // The view as submitted by the application, before the layer modified it.
+    struct ProjectionViewRecord {
+        XrPosef pose;
+        XrFovf fov;
+        uint64_t swapchain;
+        XrRect2Di imageRect;
+        uint32_t imageArrayIndex;
+        uint32_t reserved;
+    };
+
+    // Used for AcquireSwapchainImage, WaitSwapchainImage and ReleaseSwapchainImage.
+    struct SwapchainImageRecord {
+        uint64_t swapchain;
+        // Only meaningful for AcquireSwapchainImage.
+        uint32_t index;
+        uint32_t reserved;
+    };
+
+} // namespace varjo_foveated::capture
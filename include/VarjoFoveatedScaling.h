@@ -0,0 +1,89 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+// The resolution and field of view scaling done by the Varjo Foveated API layer, shared with the tools that model it
+// offline (VarjoFoveatedPlanner). Angles are in radians, like in XrFovf.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+namespace varjo_foveated::scaling {
+
+    constexpr float DegreesPerRadian = 180.f / 3.14159265f;
+
+    // The resolution recommended in xrEnumerateViewConfigurationViews(), from the runtime's recommendation. For the
+    // focus views, the multiplier includes the focus region scale.
+    inline uint32_t ScaleResolution(uint32_t runtimeResolution, float multiplier) {
+        return static_cast<uint32_t>(runtimeResolution * multiplier);
+    }
+
+    // The resolution recommended in xrEnumerateViewConfigurationViews() to achieve an average pixel density over the
+    // field of view, which is how headsets are usually described.
+    inline uint32_t ResolutionForPixelDensity(float angleLower, float angleUpper, float scale, float pixelsPerDegree) {
+        const float degrees = (angleUpper - angleLower) * scale * DegreesPerRadian;
+        return std::max(static_cast<uint32_t>(std::ceil(degrees * pixelsPerDegree)), 1u);
+    }
+
+    inline float PixelDensity(uint32_t resolution, float angleLower, float angleUpper, float scale = 1.f) {
+        return resolution / ((angleUpper - angleLower) * scale * DegreesPerRadian);
+    }
+
+    // The focus region scaling applied in xrLocateViews(): the field of view grows or shrinks around its center.
+    inline std::pair<float, float> ScaleFov(float angleLower, float angleUpper, float scale) {
+        const float angleCenter = (angleLower + angleUpper) / 2;
+        const float angleSpread = angleUpper - angleLower;
+        const float angleSpreadScaled = angleSpread * scale;
+        const float angleLowerScaled = angleCenter - (angleSpreadScaled / 2);
+        const float angleUpperScaled = angleCenter + (angleSpreadScaled / 2);
+
+        return std::make_pair(angleLowerScaled, angleUpperScaled);
+    }
+
+    // The fixed focus region offset applied in xrLocateViews() without eye tracking: the field of view moves by the
+    // offset, but no further than the bounds (the peripheral field of view).
+    inline std::pair<float, float>
+    OffsetFov(float angleLower, float angleUpper, float offset, float boundLower, float boundUpper) {
+        if (angleUpper - angleLower >= boundUpper - boundLower) {
+            return std::make_pair(angleLower, angleUpper);
+        }
+
+        const float offsetClamped = std::clamp(offset, boundLower - angleLower, boundUpper - angleUpper);
+        return std::make_pair(angleLower + offsetClamped, angleUpper + offsetClamped);
+    }
+
+    // The focus region quantization applied in xrLocateViews(): the center of the field of view snaps to a grid of the
+    // given step. Returns the grid point nearest to the angle, in steps.
+    inline int32_t QuantizeAngle(float angle, float step) {
+        return static_cast<int32_t>(std::lround(angle / step));
+    }
+
+    // Whether the center of the field of view is still held by its current grid point: it moves to another one only
+    // once it is further than half a step plus the dead zone. This absorbs the gaze jitter during fixations.
+    inline bool IsInQuantizationDeadZone(float angle, float step, float deadZone, int32_t current) {
+        return std::abs(angle - current * step) <= step / 2 + deadZone;
+    }
+
+} // namespace varjo_foveated::scaling
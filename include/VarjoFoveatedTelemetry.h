@@ -0,0 +1,185 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+// Layout of the shared memory segment published by the Varjo Foveated API layer.
+//
+// The segment is a named file mapping that any process of the same session can open read-only. The layer updates it
+// once per frame, from xrEndFrame(), and never waits on readers. Readers must use ReadSnapshot() below (or an
+// equivalent sequence lock protocol) to obtain a consistent copy.
+//
+// The segment outlives the application while a reader keeps it open. A layer that finds the segment owned by a process
+// that is gone takes it over, so readers must check the publishing process of each snapshot.
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+namespace varjo_foveated::telemetry {
+
+    constexpr const char* SegmentName = "Local\\VarjoFoveatedTelemetry";
+    constexpr uint32_t Magic = 0x4c545646; // 'VFTL'
+    constexpr uint32_t Version = 4;
+
+    // Values of FrameSnapshot::turboState. Matches XrFoveatedTurboStateMBUCCHIA.
+    enum TurboState : uint32_t {
+        TurboStateDisabled = 0,
+        TurboStateSynchronous = 1,
+        TurboStatePipelined = 2,
+    };
+
+    // Upper bounds (in milliseconds) of the buckets of FrameSnapshot::gazeDropoutHistogram. The last bucket counts the
+    // longer dropouts.
+    constexpr uint32_t GazeDropoutBucketLimitsMs[] = {20, 50, 100, 200, 500};
+    constexpr uint32_t GazeDropoutBucketCount = std::size(GazeDropoutBucketLimitsMs) + 1;
+
+    // Dropouts of a blink-like duration, within [GazeBlinkMinMs, GazeBlinkMaxMs).
+    constexpr uint32_t GazeBlinkMinMs = 50;
+    constexpr uint32_t GazeBlinkMaxMs = 500;
+
+    struct FrameSnapshot {
+        uint64_t frameIndex;
+
+        // Frame timing. Display times are XrTime values (nanoseconds).
+        int64_t displayTime;
+        // Inferred from the submitted display times when the layer does not need to hook xrWaitFrame().
+        int64_t predictedDisplayPeriod;
+        // CPU time between two consecutive xrEndFrame() calls.
+        uint32_t frameIntervalUs;
+        // CPU time between xrWaitFrame() and xrEndFrame(), 0 when the layer does not hook xrWaitFrame().
+        uint32_t waitToEndUs;
+
+        // Foveation.
+        uint32_t foveationActive;
+        uint32_t turboState;
+        // Ratio of the xrLocateViews() calls with a tracked gaze, since the beginning of the session.
+        float gazeTrackedRatio;
+
+        // Eye tracking quality, from all the gaze samples located since the beginning of the session.
+        uint32_t gazeSampleCount;
+        float gazeSampleTrackedRatio;
+        // A dropout starts with the first untracked sample and ends with the next tracked sample.
+        uint32_t gazeDropoutCount;
+        uint32_t gazeDropoutHistogram[GazeDropoutBucketCount];
+        uint32_t gazeBlinkCount;
+        float gazeLongestDropoutMs;
+        // Angle between consecutive tracked samples, in degrees. The median is the jitter during fixations, the 95th
+        // percentile includes the saccades.
+        float gazeJitterP50Deg;
+        float gazeJitterP95Deg;
+
+        // Age of the gaze behind the focus views of the submitted frames, since the beginning of the session: from the
+        // time the gaze was located for, to the runtime's predicted display time of the frame.
+        uint32_t gazeAgeFrameCount;
+        // Frames submitted while the gaze is tracked, that could not be matched to their xrLocateViews() call.
+        uint32_t gazeAgeUnmatchedCount;
+        float gazeAgeP50Ms;
+        float gazeAgeP95Ms;
+        float gazeAgeP99Ms;
+        float gazeAgeMaxMs;
+        // The runtime's predicted display time of the submitted frames, minus the display time the application rendered
+        // them for. Non-zero in Turbo Mode, where the application renders for a made-up display time.
+        float displayTimeSlipP50Ms;
+        float displayTimeSlipP95Ms;
+
+        // Configuration.
+        uint32_t configSnapshotId;
+        float peripheralMultiplier;
+        float focusMultiplier;
+        float horizontalFocusScale;
+        float verticalFocusScale;
+    };
+
+    struct Segment {
+        uint32_t magic;
+        uint32_t version;
+        // The process allowed to write the segment, 0 if none. Only changed with a compare-exchange.
+        std::atomic<uint32_t> owner;
+
+        // Sequence lock: odd while the layer is writing the publisher or the snapshot.
+        std::atomic<uint32_t> sequence;
+        uint32_t processId;
+        char applicationName[128];
+        FrameSnapshot frame;
+    };
+
+    // The process that published a snapshot.
+    struct Publisher {
+        uint32_t processId;
+        char applicationName[sizeof(Segment::applicationName)];
+    };
+
+    // Writer side of the sequence lock, upon taking ownership of the segment. Clears the snapshot of the previous
+    // owner. A previous owner that died while writing left the sequence odd.
+    inline void WritePublisher(Segment& segment, uint32_t processId, const char* applicationName) {
+        const uint32_t sequence = segment.sequence.load(std::memory_order_relaxed) | 1;
+        segment.sequence.store(sequence, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        segment.processId = processId;
+        std::memset(segment.applicationName, 0, sizeof(segment.applicationName));
+        std::strncpy(segment.applicationName, applicationName, sizeof(segment.applicationName) - 1);
+        std::memset(&segment.frame, 0, sizeof(segment.frame));
+        segment.version = Version;
+        segment.magic = Magic;
+
+        segment.sequence.store(sequence + 1, std::memory_order_release);
+    }
+
+    // Writer side of the sequence lock. Only the owner may write, from one thread at a time.
+    inline void WriteSnapshot(Segment& segment, const FrameSnapshot& frame) {
+        const uint32_t sequence = segment.sequence.load(std::memory_order_relaxed);
+        segment.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        std::memcpy(&segment.frame, &frame, sizeof(frame));
+
+        segment.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // Reader side of the sequence lock. Returns false if the writer kept the lock for too long.
+    inline bool ReadSnapshot(const Segment& segment,
+                             FrameSnapshot& frame,
+                             Publisher& publisher,
+                             uint32_t maxAttempts = 1000) {
+        for (uint32_t i = 0; i < maxAttempts; i++) {
+            const uint32_t before = segment.sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                continue;
+            }
+
+            publisher.processId = segment.processId;
+            std::memcpy(publisher.applicationName, segment.applicationName, sizeof(publisher.applicationName));
+            std::memcpy(&frame, &segment.frame, sizeof(frame));
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const uint32_t after = segment.sequence.load(std::memory_order_relaxed);
+            if (before == after) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+} // namespace varjo_foveated::telemetry
@@ -0,0 +1,106 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+// XR_MBUCCHIA_varjo_foveated_stats is an instance extension implemented by the Varjo Foveated API layer.
+//
+// It lets the application query what the layer is doing (foveation, Turbo Mode, frame timing) in order to drive its
+// own quality scaling. The query is lock-free and can be called every frame.
+//
+// Usage:
+// - Check that the extension is listed by xrEnumerateInstanceExtensionProperties() and enable it in xrCreateInstance().
+// - Resolve xrGetFoveatedStatsMBUCCHIA() with xrGetInstanceProcAddr(). This only succeeds when the layer is active,
+//   ie: when the application also enabled XR_VARJO_quad_views.
+// - Future revisions of the extension will add new structures to the next chain of XrFoveatedStatsMBUCCHIA, rather than
+//   modifying its layout.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define XR_MBUCCHIA_varjo_foveated_stats 1
+#define XR_MBUCCHIA_varjo_foveated_stats_SPEC_VERSION 2
+#define XR_MBUCCHIA_VARJO_FOVEATED_STATS_EXTENSION_NAME "XR_MBUCCHIA_varjo_foveated_stats"
+
+// Not a registered value. Chosen to not collide with any existing extension.
+#define XR_TYPE_FOVEATED_STATS_MBUCCHIA ((XrStructureType)1000999000)
+#define XR_TYPE_FOVEATED_HEAP_STATS_MBUCCHIA ((XrStructureType)1000999001)
+
+typedef enum XrFoveatedTurboStateMBUCCHIA {
+    // Turbo Mode is disabled: frames are paced by the runtime.
+    XR_FOVEATED_TURBO_STATE_DISABLED_MBUCCHIA = 0,
+    // Turbo Mode is enabled, but the last frame was paced by the runtime.
+    XR_FOVEATED_TURBO_STATE_SYNCHRONOUS_MBUCCHIA = 1,
+    // Turbo Mode is enabled, and the runtime's wait is running in the background.
+    XR_FOVEATED_TURBO_STATE_PIPELINED_MBUCCHIA = 2,
+    XR_FOVEATED_TURBO_STATE_MAX_ENUM_MBUCCHIA = 0x7FFFFFFF
+} XrFoveatedTurboStateMBUCCHIA;
+
+typedef struct XrFoveatedStatsMBUCCHIA {
+    XrStructureType type;
+    void* XR_MAY_ALIAS next;
+
+    // Foveation.
+    XrBool32 eyeTrackingEnabled;
+    // Whether the gaze was tracked during the last quad views xrLocateViews() call.
+    XrBool32 foveationActive;
+    uint64_t locateViewsCount;
+    uint64_t foveatedLocateViewsCount;
+
+    // Frame pacing.
+    XrBool32 turboModeEnabled;
+    XrFoveatedTurboStateMBUCCHIA turboState;
+    // Number of frames waited in the background, ahead of the application.
+    uint32_t turboDepth;
+    uint64_t frameCount;
+    // Number of frames for which the layer extrapolated the display time instead of using the runtime's prediction.
+    uint64_t madeUpFrameCount;
+    // Last display time predicted by the runtime.
+    XrTime runtimePredictedDisplayTime;
+    // Last display time returned to the application.
+    XrTime predictedDisplayTime;
+    XrDuration predictedDisplayPeriod;
+
+    // Configuration.
+    float peripheralMultiplier;
+    float focusMultiplier;
+    float horizontalFocusScale;
+    float verticalFocusScale;
+} XrFoveatedStatsMBUCCHIA;
+
+// Revision 2. May be chained to XrFoveatedStatsMBUCCHIA.
+typedef struct XrFoveatedHeapStatsMBUCCHIA {
+    XrStructureType type;
+    void* XR_MAY_ALIAS next;
+
+    // Only Debug builds of the layer count their heap allocations.
+    XrBool32 trackingEnabled;
+    // Heap allocations made by the layer between the start of xrWaitFrame() and the end of xrEndFrame().
+    uint64_t frameLoopAllocationCount;
+} XrFoveatedHeapStatsMBUCCHIA;
+
+typedef XrResult(XRAPI_PTR* PFN_xrGetFoveatedStatsMBUCCHIA)(XrSession session, XrFoveatedStatsMBUCCHIA* stats);
+
+#ifdef __cplusplus
+}
+#endif